@@ -0,0 +1,103 @@
+//! Synthetic sources and trees shared by the benches.
+
+#![allow(dead_code)]
+
+use std::fs;
+use std::path::{Path, PathBuf};
+
+/// Languages covered by the per-language benches, by file extension.
+pub const LANGUAGES: &[(&str, &str)] = &[
+    ("rust", "rs"),
+    ("python", "py"),
+    ("typescript", "ts"),
+    ("javascript", "js"),
+    ("go", "go"),
+    ("java", "java"),
+    ("c", "c"),
+    ("cpp", "cpp"),
+];
+
+/// A source in the language of `ext` with `functions` functions, each
+/// preceded by a comment tagged with `tag` (e.g. `REQ`).
+pub fn source(ext: &str, file: usize, functions: usize, tag: &str) -> String {
+    let (open, close, comment) = match ext {
+        "py" => (format!("class Widget{file}:\n"), String::new(), "#"),
+        "go" => (
+            format!("package p{file}\n\ntype Widget{file} struct{{}}\n\n"),
+            String::new(),
+            "//",
+        ),
+        "java" => (
+            format!("public class Widget{file} {{\n"),
+            "}\n".to_string(),
+            "//",
+        ),
+        "c" => (String::new(), String::new(), "//"),
+        "cpp" => (
+            format!("namespace n{file} {{\nclass Widget{file} {{\npublic:\n"),
+            "};\n}\n".to_string(),
+            "//",
+        ),
+        "ts" | "js" => (
+            format!("export class Widget{file} {{\n"),
+            "}\n".to_string(),
+            "//",
+        ),
+        _ => (
+            format!("mod m{file} {{\n    impl Widget{file} {{\n"),
+            "    }\n}\n".to_string(),
+            "//",
+        ),
+    };
+
+    let mut text = open;
+    for f in 0..functions {
+        let id = format!("{tag}-{file}{f:03}");
+        let function = match ext {
+            "py" => format!(
+                "    def run_{f}(self):\n        x = self.step({f})\n        return x + 1\n\n"
+            ),
+            "go" => format!(
+                "func (w *Widget{file}) Run{f}() int {{\n\tx := w.step({f})\n\treturn x + 1\n}}\n\n"
+            ),
+            "java" => format!(
+                "    int run{f}() {{\n        int x = step({f});\n        return x + 1;\n    }}\n"
+            ),
+            "c" => format!(
+                "int widget{file}_run_{f}(struct widget *w) {{\n    int x = step(w, {f});\n    return x + 1;\n}}\n\n"
+            ),
+            "cpp" => format!(
+                "    int run{f}() {{\n        int x = step({f});\n        return x + 1;\n    }}\n"
+            ),
+            "ts" => format!(
+                "  run{f}(): number {{\n    const x = this.step({f});\n    return x + 1;\n  }}\n"
+            ),
+            "js" => {
+                format!("  run{f}() {{\n    const x = this.step({f});\n    return x + 1;\n  }}\n")
+            }
+            _ => format!(
+                "        fn run_{f}(&self) -> u32 {{\n            let x = self.step({f});\n            x + 1\n        }}\n"
+            ),
+        };
+        let indent = function.len() - function.trim_start().len();
+        text.push_str(&format!("{}{comment} {id}\n", &function[..indent]));
+        text.push_str(&function);
+    }
+    text.push_str(&close);
+    text
+}
+
+/// Write a tree of `files` sources, cycling through [`LANGUAGES`], under
+/// `root` in directories of 100 files. Returns the file paths.
+pub fn write_tree(root: &Path, files: usize, functions: usize) -> Vec<PathBuf> {
+    (0..files)
+        .map(|i| {
+            let (_, ext) = LANGUAGES[i % LANGUAGES.len()];
+            let dir = root.join(format!("src/d{}", i / 100));
+            fs::create_dir_all(&dir).expect("create bench dir");
+            let path = dir.join(format!("f{i}.{ext}"));
+            fs::write(&path, source(ext, i, functions, "REQ")).expect("write bench file");
+            path
+        })
+        .collect()
+}
@@ -0,0 +1,375 @@
+//! Context extraction throughput.
+//!
+//! The `context` group scans synthetic sources where every function
+//! carries a requirement comment, so the time is dominated by parsing plus
+//! scope and block context extraction.
+//!
+//! The `rules` groups time only the per-node rule lookup on the same,
+//! already parsed, trees, two ways: `rule table` is the compiled table
+//! extraction uses now, `legacy tables` is the kind-string lists, priority
+//! match and name lookup it replaced, kept below as the reference. The
+//! rule table should be no slower.
+//!
+//! Run with `cargo bench --bench context` before and after changing
+//! `src/scan/context.rs` or `src/scan/rules.rs`.
+
+mod common;
+
+use ast_grep_core::{Doc, Node};
+use ast_grep_language::{LanguageExt, SupportLang};
+use criterion::{Criterion, Throughput, criterion_group, criterion_main};
+use std::hint::black_box;
+use std::path::PathBuf;
+use tracy::bench::{LangRules, builtin_context_rules};
+use tracy::scan::{ScanArgs, Scanner, Source};
+
+const FILES: usize = 64;
+const FUNCTIONS: usize = 50;
+
+/// The languages timed, a subset of [`common::LANGUAGES`].
+const LANGUAGES: [(&str, &str, SupportLang); 3] = [
+    ("rust", "rs", SupportLang::Rust),
+    ("python", "py", SupportLang::Python),
+    ("typescript", "ts", SupportLang::TypeScript),
+];
+
+fn source(ext: &str, file: usize) -> String {
+    common::source(ext, file, FUNCTIONS, "REQ")
+}
+
+fn bench_scan(c: &mut Criterion) {
+    let scanner = Scanner::new(&ScanArgs {
+        slug: vec!["REQ".to_string()],
+        ..Default::default()
+    })
+    .expect("valid scan args");
+
+    let mut group = c.benchmark_group("context");
+    group.throughput(Throughput::Elements(FILES as u64));
+    for (name, ext, _) in LANGUAGES {
+        let files: Vec<(PathBuf, String)> = (0..FILES)
+            .map(|i| (PathBuf::from(format!("src/f{i}.{ext}")), source(ext, i)))
+            .collect();
+        let sources: Vec<Source> = files
+            .iter()
+            .map(|(path, text)| Source::new(path, text.as_bytes()))
+            .collect();
+        // Criterion's warm-up compiles the per-language rule tables
+        group.bench_function(name, |b| {
+            b.iter(|| black_box(scanner.scan_sources(&sources).expect("scan")))
+        });
+    }
+    group.finish();
+}
+
+/// What extraction asks of every node: whether it is context or scope,
+/// its priority and its name. Summed so the work is not optimized away.
+fn lookup_rules<D: Doc>(root: &Node<D>, rules: &LangRules) -> usize {
+    let mut total = 0;
+    for node in root.dfs() {
+        let Some(rule) = rules.get(node.kind_id()) else {
+            continue;
+        };
+        if rule.context {
+            total += rule.priority as usize + rule.name(&node).map_or(0, |n| n.len());
+        }
+        if rule.scope {
+            total += rule.name(&node).map_or(0, |n| n.len());
+        }
+    }
+    total
+}
+
+/// [`lookup_rules`] against the tables the rule set replaced.
+fn lookup_legacy<D: Doc>(root: &Node<D>) -> usize {
+    let mut total = 0;
+    for node in root.dfs() {
+        let kind = node.kind();
+        if legacy::is_interesting_kind(&kind) {
+            total += legacy::kind_priority(&kind) as usize
+                + legacy::extract_name(&node, &kind).map_or(0, |n| n.len());
+        }
+        if legacy::is_scope_kind(&kind) {
+            total += legacy::extract_name(&node, &kind).map_or(0, |n| n.len());
+        }
+    }
+    total
+}
+
+fn bench_rules(c: &mut Criterion) {
+    for (name, ext, lang) in LANGUAGES {
+        let trees: Vec<_> = (0..FILES).map(|i| lang.ast_grep(source(ext, i))).collect();
+        let rules = builtin_context_rules(lang);
+
+        let mut group = c.benchmark_group(format!("rules/{name}"));
+        group.throughput(Throughput::Elements(FILES as u64));
+        group.bench_function("rule table", |b| {
+            b.iter(|| {
+                trees
+                    .iter()
+                    .map(|tree| lookup_rules(&tree.root(), &rules))
+                    .sum::<usize>()
+            })
+        });
+        group.bench_function("legacy tables", |b| {
+            b.iter(|| {
+                trees
+                    .iter()
+                    .map(|tree| lookup_legacy(&tree.root()))
+                    .sum::<usize>()
+            })
+        });
+        group.finish();
+    }
+}
+
+criterion_group!(benches, bench_scan, bench_rules);
+criterion_main!(benches);
+
+/// The kind tables and name lookup of `src/scan/context.rs` before the
+/// rule tables, unchanged apart from dropping what the bench does not call.
+mod legacy {
+    use ast_grep_core::{Doc, Node};
+
+    /// Node kinds that represent "interesting" code constructs.
+    const INTERESTING_KINDS: &[&str] = &[
+        // Functions
+        "function_item",
+        "function_definition",
+        "function_declaration",
+        "method_definition",
+        "method_declaration",
+        "arrow_function",
+        "function_expression",
+        "lambda_expression",
+        // Variables/Constants
+        "let_declaration",
+        "const_declaration",
+        "const_item",
+        "static_item",
+        "variable_declaration",
+        "variable_declarator",
+        "lexical_declaration",
+        "assignment_expression",
+        "assignment_statement",
+        "short_var_declaration",
+        "var_declaration",
+        // Types/Classes/Structs
+        "struct_item",
+        "struct_definition",
+        "class_declaration",
+        "class_definition",
+        "interface_declaration",
+        "type_alias",
+        "type_declaration",
+        "type_item",
+        "enum_item",
+        "enum_declaration",
+        "trait_item",
+        "trait_definition",
+        // Impl/Methods
+        "impl_item",
+        // Calls
+        "call_expression",
+        "method_call_expression",
+        // Macros
+        "macro_invocation",
+        "macro_definition",
+        // Statements
+        "expression_statement",
+        "return_statement",
+        // Module/Package
+        "mod_item",
+        "module_declaration",
+        "package_clause",
+        "namespace_definition",
+        // Use/Import
+        "use_declaration",
+        "import_statement",
+        "import_declaration",
+        // Python specific
+        "assignment",
+        "decorated_definition",
+        // Java specific
+        "field_declaration",
+        "local_variable_declaration",
+        // Python docstrings (string as first statement)
+        "expression_statement",
+    ];
+
+    /// Node kinds that represent scope containers.
+    const SCOPE_KINDS: &[&str] = &[
+        "function_item",
+        "function_definition",
+        "function_declaration",
+        "method_definition",
+        "method_declaration",
+        "arrow_function",
+        "lambda_expression",
+        "closure_expression",
+        "struct_item",
+        "class_declaration",
+        "class_definition",
+        "interface_declaration",
+        "enum_item",
+        "enum_declaration",
+        "trait_item",
+        "impl_item",
+        "mod_item",
+        "module_declaration",
+        "namespace_definition",
+        "decorated_definition",
+    ];
+
+    pub fn is_interesting_kind(kind: &str) -> bool {
+        INTERESTING_KINDS.contains(&kind)
+    }
+
+    pub fn is_scope_kind(kind: &str) -> bool {
+        SCOPE_KINDS.contains(&kind)
+    }
+
+    pub fn kind_priority(kind: &str) -> i32 {
+        match kind {
+            "function_item"
+            | "function_definition"
+            | "function_declaration"
+            | "method_definition"
+            | "method_declaration" => 100,
+
+            "struct_item"
+            | "struct_definition"
+            | "class_declaration"
+            | "class_definition"
+            | "interface_declaration"
+            | "enum_item"
+            | "enum_declaration"
+            | "trait_item"
+            | "type_alias"
+            | "type_item" => 90,
+
+            "impl_item" => 85,
+
+            "let_declaration"
+            | "const_declaration"
+            | "const_item"
+            | "static_item"
+            | "variable_declaration"
+            | "lexical_declaration"
+            | "short_var_declaration"
+            | "var_declaration"
+            | "field_declaration"
+            | "local_variable_declaration" => 80,
+
+            "assignment_expression" | "assignment_statement" | "assignment" => 70,
+
+            "call_expression" | "method_call_expression" | "macro_invocation" => 60,
+
+            "return_statement" => 50,
+
+            "use_declaration" | "import_statement" | "import_declaration" => 45,
+
+            "expression_statement" => 30,
+
+            "decorated_definition" => 25,
+
+            _ => 10,
+        }
+    }
+
+    /// Extract a name from a node based on its kind.
+    pub fn extract_name<D: Doc>(node: &Node<D>, kind: &str) -> Option<String> {
+        match kind {
+            // Rust
+            "function_item" | "struct_item" | "enum_item" | "trait_item" | "mod_item"
+            | "type_alias" | "type_item" | "const_item" | "static_item" | "macro_definition" => {
+                node.field("name").map(|n| n.text().to_string())
+            }
+
+            "impl_item" => node
+                .field("type")
+                .or_else(|| node.field("trait"))
+                .map(|n| first_line(n.text())),
+
+            "let_declaration" => node.field("pattern").map(|n| n.text().to_string()),
+
+            "use_declaration" => node.field("argument").map(|n| first_line(n.text())),
+
+            // JavaScript/TypeScript
+            "function_declaration"
+            | "class_declaration"
+            | "interface_declaration"
+            | "method_definition" => node.field("name").map(|n| n.text().to_string()),
+
+            "variable_declaration" | "lexical_declaration" => {
+                for child in node.children() {
+                    let child_kind: &str = &child.kind();
+                    if child_kind == "variable_declarator"
+                        && let Some(name) = child.field("name")
+                    {
+                        return Some(name.text().to_string());
+                    }
+                }
+                None
+            }
+
+            "variable_declarator" => node.field("name").map(|n| n.text().to_string()),
+
+            // Python
+            "function_definition" | "class_definition" => {
+                node.field("name").map(|n| n.text().to_string())
+            }
+
+            "assignment" => node.field("left").map(|n| first_line(n.text())),
+
+            "decorated_definition" => node
+                .field("definition")
+                .and_then(|def| def.field("name").map(|n| n.text().to_string())),
+
+            // Go
+            "type_declaration" => {
+                for child in node.children() {
+                    let child_kind: &str = &child.kind();
+                    if child_kind == "type_spec"
+                        && let Some(name) = child.field("name")
+                    {
+                        return Some(name.text().to_string());
+                    }
+                }
+                None
+            }
+
+            "short_var_declaration" | "var_declaration" => {
+                node.field("left").map(|n| first_line(n.text()))
+            }
+
+            // Java
+            "method_declaration" => node.field("name").map(|n| n.text().to_string()),
+
+            "field_declaration" | "local_variable_declaration" => node
+                .field("declarator")
+                .and_then(|d| d.field("name").map(|n| n.text().to_string())),
+
+            // Call expressions
+            "call_expression" => node
+                .field("function")
+                .or_else(|| node.field("callee"))
+                .map(|n| first_line(n.text())),
+
+            "method_call_expression" => node.field("name").map(|n| n.text().to_string()),
+
+            "macro_invocation" => node.field("macro").map(|n| n.text().to_string()),
+
+            "import_statement" | "import_declaration" => node
+                .field("source")
+                .or_else(|| node.field("module_name"))
+                .map(|n| n.text().to_string()),
+
+            _ => None,
+        }
+    }
+
+    fn first_line(s: impl AsRef<str>) -> String {
+        s.as_ref().lines().next().unwrap_or("").to_string()
+    }
+}
@@ -0,0 +1,88 @@
+//! End-to-end runs over a synthetic tree, against a plain regex grep.
+//!
+//! `tracy` rows walk the tree, scan every file and format a JSON report,
+//! as the CLI does. `regex grep` walks the same tree and counts
+//! `REQ-\d+` matches in every file on the same number of threads, without
+//! parsing; it is the floor tracy's cost should be read against. The warm
+//! cache row reruns the scan against a filled `--cache-dir`; Criterion's
+//! warm-up fills it.
+//!
+//! The three rows share one group, so Criterion's report shows them side
+//! by side. Run with `cargo bench --bench pipeline`.
+
+mod common;
+
+use common::write_tree;
+use criterion::{Criterion, Throughput, criterion_group, criterion_main};
+use regex::Regex;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
+use tracy::filter::{FilterArgs, collect_files};
+use tracy::output::{OutputFormat, Report, format_output};
+use tracy::scan::{ScanArgs, Scanner};
+
+const FILES: usize = 4_000;
+const FUNCTIONS: usize = 20;
+
+fn tracy(root: &Path, scanner: &Scanner) -> usize {
+    let files = collect_files(root, &FilterArgs::default()).expect("walk");
+    let results = scanner.scan_paths(root, &files).expect("scan");
+    format_output(OutputFormat::Json, &Report::new(&results))
+        .expect("format")
+        .len()
+}
+
+fn grep(root: &Path, pattern: &Regex) -> usize {
+    let files = collect_files(root, &FilterArgs::default()).expect("walk");
+    let next = AtomicUsize::new(0);
+    let found = AtomicUsize::new(0);
+    let workers = thread::available_parallelism().map_or(1, |n| n.get());
+    thread::scope(|scope| {
+        for _ in 0..workers {
+            scope.spawn(|| {
+                loop {
+                    let index = next.fetch_add(1, Ordering::Relaxed);
+                    let Some(path) = files.get(index) else { break };
+                    let text = fs::read_to_string(path).expect("read");
+                    found.fetch_add(pattern.find_iter(&text).count(), Ordering::Relaxed);
+                }
+            });
+        }
+    });
+    found.into_inner()
+}
+
+fn scanner(cache_dir: Option<PathBuf>) -> Scanner {
+    Scanner::new(&ScanArgs {
+        slug: vec!["REQ".to_string()],
+        cache_dir,
+        ..Default::default()
+    })
+    .expect("valid scan args")
+}
+
+fn bench_pipeline(c: &mut Criterion) {
+    let dir = tempfile::tempdir().expect("temp dir");
+    let root = dir.path().join("tree");
+    write_tree(&root, FILES, FUNCTIONS);
+
+    let mut group = c.benchmark_group("pipeline");
+    group
+        .sample_size(10)
+        .throughput(Throughput::Elements(FILES as u64));
+
+    let pattern = Regex::new(r"REQ-\d+").expect("valid regex");
+    group.bench_function("regex grep", |b| b.iter(|| grep(&root, &pattern)));
+
+    let cold = scanner(None);
+    group.bench_function("tracy walk+scan+json", |b| b.iter(|| tracy(&root, &cold)));
+
+    let warm = scanner(Some(dir.path().join("cache")));
+    group.bench_function("tracy warm cache", |b| b.iter(|| tracy(&root, &warm)));
+    group.finish();
+}
+
+criterion_group!(benches, bench_pipeline);
+criterion_main!(benches);
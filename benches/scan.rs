@@ -0,0 +1,106 @@
+//! Per-file scan cost, per language and per pipeline stage.
+//!
+//! `scan_file` rows time one thread scanning files read from disk, so they
+//! include the read, the prefilter, the parse and context extraction. The
+//! stage rows scan the same Rust sources in memory three ways, each adding
+//! one stage on top of the previous:
+//!
+//! - `parse+walk`: ids only in a string literal, so the source passes the
+//!   prefilter and is parsed and walked but no comment matches
+//! - `+hierarchy`: every function's comment matches, but a scope predicate
+//!   rejects each hit right after `extract_hierarchy`
+//! - `+block context`: the full scan, adding `extract_block_context`
+//!
+//! Throughput is per file. Run with `cargo bench --bench scan`.
+
+mod common;
+
+use common::{LANGUAGES, source};
+use criterion::{Criterion, Throughput, criterion_group, criterion_main};
+use std::fs;
+use std::hint::black_box;
+use std::path::PathBuf;
+use tracy::scan::{ScanArgs, Scanner, Source};
+
+const FILES: usize = 32;
+const FUNCTIONS: usize = 50;
+
+fn scanner(scope_kind: &[&str]) -> Scanner {
+    Scanner::new(&ScanArgs {
+        slug: vec!["REQ".to_string()],
+        scope_kind: scope_kind.iter().map(|k| k.to_string()).collect(),
+        ..Default::default()
+    })
+    .expect("valid scan args")
+}
+
+fn bench_scan_file(c: &mut Criterion) {
+    let dir = tempfile::tempdir().expect("temp dir");
+    let scanner = scanner(&[]);
+
+    let mut group = c.benchmark_group("scan_file");
+    group.throughput(Throughput::Elements(FILES as u64));
+    for (name, ext) in LANGUAGES {
+        let paths: Vec<PathBuf> = (0..FILES)
+            .map(|i| {
+                let path = dir.path().join(format!("f{i}.{ext}"));
+                fs::write(&path, source(ext, i, FUNCTIONS, "REQ")).expect("write bench file");
+                path
+            })
+            .collect();
+
+        group.bench_function(*name, |b| {
+            b.iter(|| {
+                for path in &paths {
+                    black_box(scanner.scan_file(dir.path(), path).expect("scan"));
+                }
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_stages(c: &mut Criterion) {
+    let untagged: Vec<(PathBuf, String)> = (0..FILES)
+        .map(|i| {
+            let text = format!(
+                "const ID: &str = \"REQ-0\";\n{}",
+                source("rs", i, FUNCTIONS, "NOTE")
+            );
+            (PathBuf::from(format!("f{i}.rs")), text)
+        })
+        .collect();
+    let tagged: Vec<(PathBuf, String)> = (0..FILES)
+        .map(|i| {
+            (
+                PathBuf::from(format!("f{i}.rs")),
+                source("rs", i, FUNCTIONS, "REQ"),
+            )
+        })
+        .collect();
+
+    let cases = [
+        ("parse+walk", &untagged, scanner(&[])),
+        ("+hierarchy", &tagged, scanner(&["no_such_kind"])),
+        ("+block context", &tagged, scanner(&[])),
+    ];
+    let mut group = c.benchmark_group("stage");
+    group.throughput(Throughput::Elements(FILES as u64));
+    for (name, files, scanner) in &cases {
+        group.bench_function(*name, |b| {
+            b.iter(|| {
+                for (path, text) in files.iter() {
+                    black_box(
+                        scanner
+                            .scan_source(&Source::new(path, text.as_bytes()))
+                            .expect("scan"),
+                    );
+                }
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_scan_file, bench_stages);
+criterion_main!(benches);
@@ -0,0 +1,56 @@
+//! Id matching cost against the number of slugs.
+//!
+//! Compiles the id pattern for 1, 10, 100 and 1000 slugs and runs it over
+//! the same text, whose ids cycle through the slug set, so every size
+//! finds the same number of ids. The slug alternation is compiled into one
+//! automaton, so throughput should stay flat as the slug count grows.
+//!
+//! Throughput is per byte of text. Run with `cargo bench --bench slugs`.
+
+mod common;
+
+use common::source;
+use criterion::{BenchmarkId, Criterion, Throughput, criterion_group, criterion_main};
+use tracy::scan::{ScanArgs, compile_pattern};
+
+const SLUG_COUNTS: &[usize] = &[1, 10, 100, 1000];
+const FILES: usize = 200;
+const FUNCTIONS: usize = 50;
+
+/// A distinct project-key-like slug, e.g. `PRJAB`.
+fn slug(i: usize) -> String {
+    let mut key = String::from("PRJ");
+    let mut n = i;
+    loop {
+        key.push(char::from(b'A' + (n % 26) as u8));
+        n /= 26;
+        if n == 0 {
+            break;
+        }
+    }
+    key
+}
+
+fn bench_slugs(c: &mut Criterion) {
+    let mut group = c.benchmark_group("slugs");
+    for &count in SLUG_COUNTS {
+        let slugs: Vec<String> = (0..count).map(slug).collect();
+        let text: String = (0..FILES)
+            .map(|i| source("rs", i, FUNCTIONS, &slugs[i % count]))
+            .collect();
+        let pattern = compile_pattern(&ScanArgs {
+            slug: slugs,
+            ..Default::default()
+        })
+        .expect("valid slugs");
+
+        group.throughput(Throughput::Bytes(text.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(count), &text, |b, text| {
+            b.iter(|| pattern.find_iter(text).count())
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_slugs);
+criterion_main!(benches);
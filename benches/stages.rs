@@ -0,0 +1,169 @@
+//! Cost of the stages around the scan: blame parsing, the directory walk
+//! with `.gitattributes` excludes, and every output format.
+//!
+//! The walk is timed on the same synthetic tree without and with a
+//! `.gitattributes` of `ATTRIBUTES` vendored/generated patterns, so the
+//! difference is the cost of parsing the attributes and checking every
+//! path against them. Throughput is per blame line, file, entry or matrix
+//! cell. Run with `cargo bench --bench stages`.
+
+mod common;
+
+use common::write_tree;
+use criterion::{Criterion, Throughput, criterion_group, criterion_main};
+use std::collections::BTreeMap;
+use std::fs;
+use std::path::PathBuf;
+use tracy::aggregate::{Cell, Dimension, Matrix};
+use tracy::bench::parse_blame_porcelain;
+use tracy::filter::{FilterArgs, collect_files};
+use tracy::git::BlameInfo;
+use tracy::html::write_report;
+use tracy::output::{OutputFormat, Report, format_matrix, format_output};
+use tracy::scan::{Entry, ScanResult, ScopeItem};
+
+const BLAME_LINES: usize = 20_000;
+const TREE_FILES: usize = 2_000;
+const ATTRIBUTES: usize = 200;
+const ENTRIES: usize = 10_000;
+
+fn blame_output(lines: usize) -> String {
+    let mut out = String::new();
+    for line in 1..=lines {
+        let commit = format!("{:040x}", line % 97);
+        out.push_str(&format!("{commit} {line} {line} 1\n"));
+        // Git repeats a commit's metadata only on its first group
+        if line <= 97 {
+            out.push_str(&format!(
+                "author Dev {c}\nauthor-mail <dev{c}@example.com>\nauthor-time {t}\nauthor-tz +0000\n\
+                 committer Dev {c}\ncommitter-mail <dev{c}@example.com>\ncommitter-time {t}\n\
+                 committer-tz +0000\nsummary Change {c}\nfilename src/lib.rs\n",
+                c = line % 97,
+                t = 1_700_000_000 + line
+            ));
+        }
+        out.push_str(&format!("\tlet x{line} = {line};\n"));
+    }
+    out
+}
+
+fn bench_blame(c: &mut Criterion) {
+    let output = blame_output(BLAME_LINES);
+    let mut group = c.benchmark_group("blame");
+    group.throughput(Throughput::Elements(BLAME_LINES as u64));
+    group.bench_function("parse_blame_porcelain", |b| {
+        b.iter(|| parse_blame_porcelain(&output))
+    });
+    group.finish();
+}
+
+fn bench_walk(c: &mut Criterion) {
+    let dir = tempfile::tempdir().expect("temp dir");
+    write_tree(dir.path(), TREE_FILES, 1);
+    let args = FilterArgs::default();
+
+    let mut group = c.benchmark_group("walk");
+    group.throughput(Throughput::Elements(TREE_FILES as u64));
+    group.bench_function("plain", |b| {
+        b.iter(|| collect_files(dir.path(), &args).expect("walk"))
+    });
+
+    let attributes: String = (0..ATTRIBUTES)
+        .map(|i| match i % 2 {
+            0 => format!("src/d{i}/vendor/** linguist-vendored\n"),
+            _ => format!("**/*_gen{i}.* linguist-generated\n"),
+        })
+        .collect();
+    fs::write(dir.path().join(".gitattributes"), attributes).expect("write attributes");
+    group.bench_function(format!("gitattributes({ATTRIBUTES})"), |b| {
+        b.iter(|| collect_files(dir.path(), &args).expect("walk"))
+    });
+    group.finish();
+}
+
+fn results(entries: usize) -> ScanResult {
+    let mut results = ScanResult::new();
+    for i in 0..entries {
+        results
+            .entry(format!("REQ-{}", i % 1000))
+            .or_insert_with(Vec::new)
+            .push(Entry {
+                file: PathBuf::from(format!("src/d{}/f{i}.rs", i % 50)),
+                line: i % 400 + 1,
+                comment_text: format!("// REQ-{}: validate \"input\", then commit", i % 1000),
+                above: None,
+                below: None,
+                inline: None,
+                scope: vec![
+                    ScopeItem {
+                        kind: "function_item".to_string(),
+                        name: Some(format!("run_{i}")),
+                        line: i % 400,
+                    },
+                    ScopeItem {
+                        kind: "impl_item".to_string(),
+                        name: Some("Widget".to_string()),
+                        line: 1,
+                    },
+                ],
+                variants: None,
+                blame: Some(BlameInfo {
+                    commit: format!("{:040x}", i % 97),
+                    author: Some(format!("Dev {}", i % 13)),
+                    author_mail: Some(format!("dev{}@example.com", i % 13)),
+                    author_time: Some(1_700_000_000 + i as i64),
+                    summary: Some("Change".to_string()),
+                }),
+            });
+    }
+    results
+}
+
+fn bench_output(c: &mut Criterion) {
+    let results = results(ENTRIES);
+    let report_data = Report::new(&results);
+    let mut group = c.benchmark_group("format");
+    group.throughput(Throughput::Elements(ENTRIES as u64));
+    for format in [
+        OutputFormat::Json,
+        OutputFormat::Jsonl,
+        OutputFormat::Csv,
+        OutputFormat::Sarif,
+    ] {
+        group.bench_function(format!("{format:?}"), |b| {
+            b.iter(|| format_output(format, &report_data).expect("format"))
+        });
+    }
+
+    let dir = tempfile::tempdir().expect("temp dir");
+    group.bench_function("Html (write_report)", |b| {
+        b.iter(|| write_report(&dir.path().join("report"), &report_data).expect("html"))
+    });
+    group.finish();
+
+    let matrix = Matrix {
+        by: vec![Dimension::Requirement, Dimension::Author],
+        cells: (0..ENTRIES)
+            .map(|i| {
+                let key = vec![format!("REQ-{i}"), format!("Dev {}", i % 13)];
+                let cell = Cell {
+                    count: i % 7 + 1,
+                    first: Some(1_700_000_000),
+                    last: Some(1_700_000_000 + i as i64),
+                };
+                (key, cell)
+            })
+            .collect::<BTreeMap<_, _>>(),
+    };
+    let mut group = c.benchmark_group("format_matrix");
+    group.throughput(Throughput::Elements(ENTRIES as u64));
+    for format in [OutputFormat::Json, OutputFormat::Csv] {
+        group.bench_function(format!("{format:?}"), |b| {
+            b.iter(|| format_matrix(format, &matrix).expect("format"))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_blame, bench_walk, bench_output);
+criterion_main!(benches);
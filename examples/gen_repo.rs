@@ -0,0 +1,483 @@
+//! Generate a reproducible synthetic repository for scale testing.
+//!
+//! ```text
+//! cargo run --release --example gen_repo -- --out /tmp/synth --files 1000000
+//! tracy -s REQ --root /tmp/synth --format jsonl -q
+//! ```
+//!
+//! The same arguments and `--seed` always produce the same tree: every
+//! file draws from its own random stream, so the output does not depend on
+//! how the writes are spread over threads. File sizes follow a log-normal
+//! distribution around `--median-lines`. Every function is preceded by a
+//! comment with probability `--comment-density`, and every comment line
+//! carries an id with probability `--tag-density`. The summary reports the
+//! number of tagged lines in the regular files, which is the number of hits
+//! a plain scan of `src/` should find.
+//!
+//! `--pathological` adds the worst cases under `pathological/`: a 50 MiB
+//! file, 1000 nested scopes, 100k separate comments in one file, and 100k-
+//! line comment blocks.
+
+use clap::{Parser, ValueEnum};
+use std::f64::consts::PI;
+use std::fs;
+use std::io;
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
+
+const HUGE_FILE_BYTES: usize = 50 << 20;
+const NESTING_DEPTH: usize = 1000;
+const MANY_COMMENTS: usize = 100_000;
+const BLOCK_LINES: usize = 100_000;
+
+const PHRASES: &[&str] = &[
+    "validate the input before use",
+    "retry once on timeout",
+    "the buffer is owned by the caller",
+    "keep in sync with the protocol spec",
+    "clamp to the configured range",
+    "called with the lock held",
+];
+
+#[derive(Parser, Debug)]
+#[command(about = "Generate a reproducible synthetic repository for scale testing")]
+struct Args {
+    #[arg(long, help = "Directory to write the repository to")]
+    out: PathBuf,
+
+    #[arg(long, default_value_t = 1000, help = "Number of regular source files")]
+    files: usize,
+
+    #[arg(
+        long,
+        default_value = "rs=30,py=20,ts=15,js=5,c=10,cpp=10,go=5,java=5",
+        help = "Language mix as EXT=WEIGHT,..."
+    )]
+    languages: String,
+
+    #[arg(long, default_value_t = 200, help = "Median file length in lines")]
+    median_lines: usize,
+
+    #[arg(
+        long,
+        default_value_t = 1.0,
+        help = "Spread of file lengths (log-normal sigma; 0 makes all files the median)"
+    )]
+    size_spread: f64,
+
+    #[arg(
+        long,
+        default_value_t = 0.3,
+        help = "Probability that a function is preceded by a comment"
+    )]
+    comment_density: f64,
+
+    #[arg(
+        long,
+        default_value_t = 0.2,
+        help = "Probability that a comment line carries an id"
+    )]
+    tag_density: f64,
+
+    #[arg(long, default_value = "REQ", help = "Slug of the generated ids")]
+    slug: String,
+
+    #[arg(
+        long,
+        default_value_t = 5000,
+        help = "Ids are drawn from SLUG-1..SLUG-N"
+    )]
+    ids: usize,
+
+    #[arg(long, default_value_t = 1000, help = "Files per directory")]
+    files_per_dir: usize,
+
+    #[arg(long, default_value_t = 0, help = "Random seed")]
+    seed: u64,
+
+    #[arg(
+        long,
+        value_enum,
+        value_delimiter = ',',
+        help = "Also write these worst cases (comma-separated)"
+    )]
+    pathological: Vec<Pathological>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum)]
+enum Pathological {
+    /// One 50 MiB source file
+    HugeFile,
+    /// 1000 nested scopes
+    DeepNesting,
+    /// 100k separate comments in one file
+    ManyComments,
+    /// A 100k-line block comment and a 100k-line run of line comments
+    HugeBlock,
+    /// All of the above
+    All,
+}
+
+/// SplitMix64: small, fast and good enough for test data.
+struct Rng(u64);
+
+impl Rng {
+    /// An independent stream for `stream` under `seed`.
+    fn new(seed: u64, stream: u64) -> Self {
+        let mut rng = Self(seed ^ stream.wrapping_mul(0xD1B5_4A32_D192_ED03));
+        rng.next();
+        rng
+    }
+
+    fn next(&mut self) -> u64 {
+        self.0 = self.0.wrapping_add(0x9E37_79B9_7F4A_7C15);
+        let mut z = self.0;
+        z = (z ^ (z >> 30)).wrapping_mul(0xBF58_476D_1CE4_E5B9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94D0_49BB_1331_11EB);
+        z ^ (z >> 31)
+    }
+
+    /// Uniform in `[0, 1)`.
+    fn unit(&mut self) -> f64 {
+        (self.next() >> 11) as f64 / (1u64 << 53) as f64
+    }
+
+    fn chance(&mut self, p: f64) -> bool {
+        self.unit() < p
+    }
+
+    fn below(&mut self, n: usize) -> usize {
+        (self.next() % n.max(1) as u64) as usize
+    }
+
+    /// Standard normal, by Box-Muller.
+    fn normal(&mut self) -> f64 {
+        let u1 = self.unit().max(f64::MIN_POSITIVE);
+        let u2 = self.unit();
+        (-2.0 * u1.ln()).sqrt() * (2.0 * PI * u2).cos()
+    }
+}
+
+/// Bytes and tagged comment lines written.
+#[derive(Debug, Default, Clone, Copy)]
+struct Totals {
+    files: usize,
+    bytes: usize,
+    tags: usize,
+}
+
+impl Totals {
+    fn add(&mut self, other: Totals) {
+        self.files += other.files;
+        self.bytes += other.bytes;
+        self.tags += other.tags;
+    }
+}
+
+/// Writes source text in one language, counting the ids it emits.
+struct Writer<'a> {
+    args: &'a Args,
+    ext: &'static str,
+    text: String,
+    tags: usize,
+}
+
+impl<'a> Writer<'a> {
+    fn new(args: &'a Args, ext: &'static str) -> Self {
+        Self {
+            args,
+            ext,
+            text: String::new(),
+            tags: 0,
+        }
+    }
+
+    fn comment_prefix(&self) -> &'static str {
+        if self.ext == "py" { "#" } else { "//" }
+    }
+
+    fn id(&mut self, rng: &mut Rng) -> String {
+        self.tags += 1;
+        format!("{}-{}", self.args.slug, rng.below(self.args.ids) + 1)
+    }
+
+    /// A comment line, tagged with probability `--tag-density`.
+    fn comment_line(&mut self, rng: &mut Rng, prefix: &str) {
+        let phrase = PHRASES[rng.below(PHRASES.len())];
+        let line = if rng.chance(self.args.tag_density) {
+            format!("{prefix} {}: {phrase}\n", self.id(rng))
+        } else {
+            format!("{prefix} {phrase}\n")
+        };
+        self.text.push_str(&line);
+    }
+
+    fn header(&mut self, file: usize) {
+        match self.ext {
+            "go" => self.text.push_str(&format!("package p{file}\n\n")),
+            "java" => self.text.push_str(&format!("public class F{file} {{\n")),
+            _ => {}
+        }
+    }
+
+    fn footer(&mut self) {
+        if self.ext == "java" {
+            self.text.push_str("}\n");
+        }
+    }
+
+    /// A short function, preceded by a comment with probability
+    /// `--comment-density`. Returns the number of lines written.
+    fn function(&mut self, rng: &mut Rng, name: usize) -> usize {
+        let mut lines = 0;
+        if rng.chance(self.args.comment_density) {
+            let prefix = self.comment_prefix();
+            for _ in 0..=rng.below(3) {
+                self.comment_line(rng, prefix);
+                lines += 1;
+            }
+        }
+        let body = match self.ext {
+            "py" => format!("def f{name}(x):\n    y = x + {name}\n    return y * 2\n\n"),
+            "ts" => format!(
+                "function f{name}(x: number): number {{\n  const y = x + {name};\n  return y * 2;\n}}\n"
+            ),
+            "js" => {
+                format!("function f{name}(x) {{\n  const y = x + {name};\n  return y * 2;\n}}\n")
+            }
+            "c" | "cpp" => {
+                format!("int f{name}(int x) {{\n    int y = x + {name};\n    return y * 2;\n}}\n")
+            }
+            "go" => format!("func f{name}(x int) int {{\n\ty := x + {name}\n\treturn y * 2\n}}\n"),
+            "java" => format!(
+                "static int f{name}(int x) {{\n    int y = x + {name};\n    return y * 2;\n}}\n"
+            ),
+            _ => format!("fn f{name}(x: u32) -> u32 {{\n    let y = x + {name};\n    y * 2\n}}\n"),
+        };
+        self.text.push_str(&body);
+        lines + body.lines().count()
+    }
+
+    fn finish(self, path: &Path) -> io::Result<Totals> {
+        fs::write(path, &self.text)?;
+        Ok(Totals {
+            files: 1,
+            bytes: self.text.len(),
+            tags: self.tags,
+        })
+    }
+}
+
+fn parse_languages(spec: &str) -> Result<Vec<(&'static str, f64)>, String> {
+    const KNOWN: &[&str] = &["rs", "py", "ts", "js", "c", "cpp", "go", "java"];
+    let mut languages = Vec::new();
+    for part in spec.split(',').map(str::trim).filter(|p| !p.is_empty()) {
+        let (ext, weight) = part
+            .split_once('=')
+            .ok_or_else(|| format!("expected EXT=WEIGHT, got {part:?}"))?;
+        let ext = KNOWN
+            .iter()
+            .find(|known| **known == ext.trim())
+            .ok_or_else(|| format!("unknown extension {ext:?} (one of {})", KNOWN.join(", ")))?;
+        let weight: f64 = weight
+            .trim()
+            .parse()
+            .map_err(|_| format!("invalid weight in {part:?}"))?;
+        languages.push((*ext, weight));
+    }
+    let total: f64 = languages.iter().map(|(_, w)| w).sum();
+    if total <= 0.0 {
+        return Err("the language weights must add up to more than 0".to_string());
+    }
+    Ok(languages
+        .into_iter()
+        .map(|(ext, weight)| (ext, weight / total))
+        .collect())
+}
+
+fn pick_language(rng: &mut Rng, languages: &[(&'static str, f64)]) -> &'static str {
+    let mut roll = rng.unit();
+    for (ext, share) in languages {
+        if roll < *share {
+            return ext;
+        }
+        roll -= share;
+    }
+    languages[languages.len() - 1].0
+}
+
+fn write_file(args: &Args, languages: &[(&'static str, f64)], index: usize) -> io::Result<Totals> {
+    let mut rng = Rng::new(args.seed, index as u64);
+    let ext = pick_language(&mut rng, languages);
+    let target = (args.median_lines as f64 * (args.size_spread * rng.normal()).exp())
+        .clamp(5.0, 200_000.0) as usize;
+
+    let dir = args
+        .out
+        .join("src")
+        .join(format!("d{}", index / args.files_per_dir.max(1)));
+    fs::create_dir_all(&dir)?;
+
+    let mut writer = Writer::new(args, ext);
+    writer.header(index);
+    let mut lines = 0;
+    let mut name = 0;
+    while lines < target {
+        lines += writer.function(&mut rng, name);
+        name += 1;
+    }
+    writer.footer();
+    writer.finish(&dir.join(format!("f{index}.{ext}")))
+}
+
+/// Write the regular files on all cores.
+fn write_files(args: &Args, languages: &[(&'static str, f64)]) -> io::Result<Totals> {
+    let next = AtomicUsize::new(0);
+    let error = Mutex::new(None);
+    let workers = thread::available_parallelism().map_or(1, |n| n.get());
+
+    let totals = thread::scope(|scope| {
+        let handles: Vec<_> = (0..workers)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut totals = Totals::default();
+                    loop {
+                        let index = next.fetch_add(1, Ordering::Relaxed);
+                        if index >= args.files {
+                            break;
+                        }
+                        match write_file(args, languages, index) {
+                            Ok(file) => totals.add(file),
+                            Err(e) => {
+                                *error.lock().unwrap() = Some(e);
+                                // Make the other workers stop too
+                                next.store(args.files, Ordering::Relaxed);
+                                break;
+                            }
+                        }
+                    }
+                    totals
+                })
+            })
+            .collect();
+        handles
+            .into_iter()
+            .fold(Totals::default(), |mut totals, handle| {
+                totals.add(handle.join().expect("writer panicked"));
+                totals
+            })
+    });
+
+    match error.into_inner().unwrap() {
+        Some(e) => Err(e),
+        None => Ok(totals),
+    }
+}
+
+fn huge_file(args: &Args, dir: &Path) -> io::Result<Totals> {
+    let mut rng = Rng::new(args.seed, u64::MAX);
+    let mut writer = Writer::new(args, "rs");
+    let mut name = 0;
+    while writer.text.len() < HUGE_FILE_BYTES {
+        writer.function(&mut rng, name);
+        name += 1;
+    }
+    writer.finish(&dir.join("huge.rs"))
+}
+
+fn deep_nesting(args: &Args, dir: &Path) -> io::Result<Totals> {
+    let mut rng = Rng::new(args.seed, u64::MAX - 1);
+    let mut writer = Writer::new(args, "rs");
+    for depth in 0..NESTING_DEPTH {
+        writer.text.push_str(&format!("mod m{depth} {{\n"));
+        if depth % 100 == 99 {
+            let id = writer.id(&mut rng);
+            writer
+                .text
+                .push_str(&format!("// {id}: at depth {}\n", depth + 1));
+            writer.text.push_str(&format!("fn at_{depth}() {{}}\n"));
+        }
+    }
+    writer.text.push_str(&"}\n".repeat(NESTING_DEPTH));
+    writer.finish(&dir.join("deep.rs"))
+}
+
+fn many_comments(args: &Args, dir: &Path) -> io::Result<Totals> {
+    let mut rng = Rng::new(args.seed, u64::MAX - 2);
+    let mut writer = Writer::new(args, "py");
+    // Code between the comments keeps each one its own block
+    for n in 0..MANY_COMMENTS {
+        let id = writer.id(&mut rng);
+        writer.text.push_str(&format!("# {id}\nx{n} = {n}\n"));
+    }
+    writer.finish(&dir.join("many_comments.py"))
+}
+
+fn huge_block(args: &Args, dir: &Path) -> io::Result<Totals> {
+    let mut rng = Rng::new(args.seed, u64::MAX - 3);
+    let mut writer = Writer::new(args, "c");
+    writer.text.push_str("/*\n");
+    for _ in 0..BLOCK_LINES {
+        writer.comment_line(&mut rng, " *");
+    }
+    writer
+        .text
+        .push_str(" */\nint block(void) { return 0; }\n\n");
+    // Adjacent line comments are aggregated into one block as well
+    for _ in 0..BLOCK_LINES {
+        writer.comment_line(&mut rng, "//");
+    }
+    writer.text.push_str("int run(void) { return 0; }\n");
+    writer.finish(&dir.join("huge_block.c"))
+}
+
+fn main() -> Result<(), Box<dyn std::error::Error>> {
+    let args = Args::parse();
+    let languages = parse_languages(&args.languages)?;
+
+    let totals = write_files(&args, &languages)?;
+    println!(
+        "wrote {} files, {:.1} MiB, {} tagged comment lines ({}-1..{}-{}) to {}",
+        totals.files,
+        mib(totals.bytes),
+        totals.tags,
+        args.slug,
+        args.slug,
+        args.ids,
+        args.out.join("src").display()
+    );
+
+    if !args.pathological.is_empty() {
+        let mut totals = Totals::default();
+        let dir = args.out.join("pathological");
+        fs::create_dir_all(&dir)?;
+        let all = args.pathological.contains(&Pathological::All);
+        let wanted = |case| all || args.pathological.contains(&case);
+        if wanted(Pathological::HugeFile) {
+            totals.add(huge_file(&args, &dir)?);
+        }
+        if wanted(Pathological::DeepNesting) {
+            totals.add(deep_nesting(&args, &dir)?);
+        }
+        if wanted(Pathological::ManyComments) {
+            totals.add(many_comments(&args, &dir)?);
+        }
+        if wanted(Pathological::HugeBlock) {
+            totals.add(huge_block(&args, &dir)?);
+        }
+        println!(
+            "wrote {} pathological files, {:.1} MiB, {} tagged comment lines to {}",
+            totals.files,
+            mib(totals.bytes),
+            totals.tags,
+            dir.display()
+        );
+    }
+    Ok(())
+}
+
+fn mib(bytes: usize) -> f64 {
+    bytes as f64 / (1 << 20) as f64
+}
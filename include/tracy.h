@@ -0,0 +1,89 @@
+/*
+ * tracy C API
+ *
+ * In-process access to the tracy scanner from C and C++. Link against
+ * libtracy.a / libtracy.so (built by `cargo build --release`).
+ *
+ * Ownership:
+ *   - tracy_scanner_new() returns a scanner freed with tracy_scanner_free().
+ *     A scanner may be used from several threads at once.
+ *   - tracy_scan_buffer() / tracy_scan_path() return a result set freed with
+ *     tracy_hits_free(). Entries from tracy_hits_get() are borrowed from the
+ *     result set and stay valid until it is freed.
+ *
+ * Errors: functions returning a pointer return NULL on failure;
+ * tracy_last_error() then describes the failure. The message belongs to the
+ * calling thread and stays valid until its next tracy call.
+ *
+ * All strings are NUL-terminated UTF-8.
+ */
+
+#ifndef TRACY_H
+#define TRACY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tracy_scanner tracy_scanner;
+typedef struct tracy_hits tracy_hits;
+
+typedef struct tracy_options {
+    /* Requirement prefixes, e.g. "REQ" (required) */
+    const char *const *slugs;
+    size_t slug_count;
+    /* Characters allowed between slug and number; NULL for "-" */
+    const char *id_separator;
+    /* Regex for the number part; NULL for "\\d+" */
+    const char *id_number;
+    /* Non-zero to enable */
+    int hierarchical;
+    int word_boundary;
+    int ignore_case;
+} tracy_options;
+
+typedef struct tracy_entry {
+    /* Requirement id, e.g. "REQ-42" */
+    const char *id;
+    /* Path as given for buffers, relative to root for files */
+    const char *file;
+    /* 1-indexed line of the marker */
+    size_t line;
+    /* Full comment text */
+    const char *comment_text;
+    /* Innermost enclosing scope; both NULL at file level, name may be NULL */
+    const char *scope_kind;
+    const char *scope_name;
+} tracy_entry;
+
+tracy_scanner *tracy_scanner_new(const tracy_options *options);
+void tracy_scanner_free(tracy_scanner *scanner);
+
+/* Scan source held in memory. language (e.g. "cpp", "rust") may be NULL to
+ * detect it from path. Unsupported languages yield an empty result set. */
+tracy_hits *tracy_scan_buffer(const tracy_scanner *scanner,
+                              const char *path,
+                              const uint8_t *data,
+                              size_t len,
+                              const char *language);
+
+/* Scan a file on disk. Entry paths are relative to root, which may be NULL. */
+tracy_hits *tracy_scan_path(const tracy_scanner *scanner,
+                            const char *root,
+                            const char *path);
+
+size_t tracy_hits_len(const tracy_hits *hits);
+/* NULL when index is out of range */
+const tracy_entry *tracy_hits_get(const tracy_hits *hits, size_t index);
+void tracy_hits_free(tracy_hits *hits);
+
+const char *tracy_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACY_H */
@@ -0,0 +1,360 @@
+//! Streaming aggregation into traceability matrices.
+//!
+//! Instead of collecting every entry and grouping afterwards, each file's
+//! hits are folded into a per-worker group-by table as soon as the file is
+//! scanned, and the tables are merged once at the end. Memory is bounded by
+//! the number of distinct groups, not by the number of references.
+
+use crate::git::{self, GitError};
+use crate::output::OutputFormat;
+use crate::scan::{self, Entry, FileHits, ScanArgs, ScanError};
+use serde::Serialize;
+use std::collections::{BTreeMap, HashMap};
+use std::path::{Component, Path, PathBuf};
+use std::str::FromStr;
+use thiserror::Error;
+
+/// Group key used when a hit has no value for a dimension.
+const NONE_KEY: &str = "(none)";
+
+#[derive(Debug, Error)]
+pub enum AggregateError {
+    #[error("invalid --aggregate spec '{spec}': {reason}")]
+    InvalidSpec { spec: String, reason: String },
+
+    #[error("--aggregate does not support the {0:?} output format")]
+    UnsupportedFormat(OutputFormat),
+
+    #[error(transparent)]
+    Scan(#[from] ScanError),
+
+    #[error(transparent)]
+    Git(#[from] GitError),
+
+    #[error("failed to serialize output: {0}")]
+    Serialize(#[from] serde_json::Error),
+}
+
+/// A column of the traceability matrix.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Dimension {
+    /// The requirement id, e.g. `REQ-42`
+    Requirement,
+    /// The first directory below the scan root (`.` for top-level files)
+    TopDir,
+    /// The AST kind of the innermost enclosing scope
+    ScopeKind,
+    /// The blame author of the marker line
+    Author,
+}
+
+impl Dimension {
+    pub fn name(self) -> &'static str {
+        match self {
+            Dimension::Requirement => "requirement",
+            Dimension::TopDir => "top-dir",
+            Dimension::ScopeKind => "scope-kind",
+            Dimension::Author => "author",
+        }
+    }
+
+    fn key(self, requirement_id: &str, entry: &Entry) -> String {
+        match self {
+            Dimension::Requirement => requirement_id.to_string(),
+            Dimension::TopDir => top_dir(&entry.file),
+            Dimension::ScopeKind => entry
+                .scope
+                .first()
+                .map_or_else(|| NONE_KEY.to_string(), |s| s.kind.clone()),
+            Dimension::Author => entry
+                .blame
+                .as_ref()
+                .and_then(|b| b.author.clone())
+                .unwrap_or_else(|| NONE_KEY.to_string()),
+        }
+    }
+}
+
+/// Parsed `--aggregate` value, e.g. `by=requirement,top-dir`.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct AggregateSpec {
+    pub by: Vec<Dimension>,
+}
+
+impl AggregateSpec {
+    /// Whether any dimension needs git blame.
+    pub fn needs_blame(&self) -> bool {
+        self.by.contains(&Dimension::Author)
+    }
+}
+
+impl FromStr for AggregateSpec {
+    type Err = AggregateError;
+
+    fn from_str(spec: &str) -> Result<Self, Self::Err> {
+        let invalid = |reason: String| AggregateError::InvalidSpec {
+            spec: spec.to_string(),
+            reason,
+        };
+
+        let list = spec.trim();
+        let list = list.strip_prefix("by=").unwrap_or(list);
+
+        let mut by = Vec::new();
+        for name in list.split(',').map(str::trim).filter(|n| !n.is_empty()) {
+            let dimension = match name {
+                "requirement" => Dimension::Requirement,
+                "top-dir" => Dimension::TopDir,
+                "scope-kind" => Dimension::ScopeKind,
+                "author" => Dimension::Author,
+                _ => {
+                    return Err(invalid(format!(
+                        "unknown dimension '{name}' (expected requirement, top-dir, scope-kind or author)"
+                    )));
+                }
+            };
+            if by.contains(&dimension) {
+                return Err(invalid(format!("dimension '{name}' is listed twice")));
+            }
+            by.push(dimension);
+        }
+
+        if by.is_empty() {
+            return Err(invalid("no dimensions given".to_string()));
+        }
+        Ok(Self { by })
+    }
+}
+
+/// Counts for one group of the matrix.
+#[derive(Debug, Clone, Default, PartialEq, Eq, Serialize)]
+pub struct Cell {
+    /// Number of references in the group
+    pub count: usize,
+    /// Earliest blame author time in the group (Unix seconds)
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub first: Option<i64>,
+    /// Latest blame author time in the group (Unix seconds)
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub last: Option<i64>,
+}
+
+impl Cell {
+    fn add(&mut self, time: Option<i64>) {
+        self.count += 1;
+        self.add_times(time, time);
+    }
+
+    fn merge(&mut self, other: Cell) {
+        self.count += other.count;
+        self.add_times(other.first, other.last);
+    }
+
+    fn add_times(&mut self, first: Option<i64>, last: Option<i64>) {
+        self.first = match (self.first, first) {
+            (Some(a), Some(b)) => Some(a.min(b)),
+            (a, b) => a.or(b),
+        };
+        self.last = match (self.last, last) {
+            (Some(a), Some(b)) => Some(a.max(b)),
+            (a, b) => a.or(b),
+        };
+    }
+}
+
+/// Aggregated reference counts, one cell per distinct group key.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Matrix {
+    pub by: Vec<Dimension>,
+    /// Cells keyed by one value per dimension in `by`, sorted by key
+    pub cells: BTreeMap<Vec<String>, Cell>,
+}
+
+type Groups = HashMap<Vec<String>, Cell>;
+
+/// Scan `paths` and aggregate the hits by the dimensions in `spec`.
+///
+/// With `blame` set (or when grouping by author), marker lines are blamed per
+/// file inside the workers, which fills in the `first`/`last` timestamps.
+pub fn aggregate(
+    root: &Path,
+    paths: &[PathBuf],
+    args: &ScanArgs,
+    spec: &AggregateSpec,
+    blame: bool,
+) -> Result<Matrix, AggregateError> {
+    let blame = blame || spec.needs_blame();
+    if blame {
+        git::check_work_tree(root)?;
+    }
+
+    let per_worker = scan::fold_files(root, paths, args, Groups::new, |groups, hits| {
+        fold_hits(root, &spec.by, blame, groups, hits)
+    })?;
+
+    let mut cells = BTreeMap::new();
+    for groups in per_worker {
+        for (key, cell) in groups {
+            cells.entry(key).or_insert_with(Cell::default).merge(cell);
+        }
+    }
+
+    Ok(Matrix {
+        by: spec.by.clone(),
+        cells,
+    })
+}
+
+fn fold_hits(root: &Path, by: &[Dimension], blame: bool, groups: &mut Groups, mut hits: FileHits) {
+    if blame {
+        let mut entries: Vec<&mut Entry> = hits.iter_mut().map(|(_, e)| e).collect();
+        git::blame_file_entries(root, &mut entries);
+    }
+
+    for (requirement_id, entry) in &hits {
+        let key: Vec<String> = by.iter().map(|d| d.key(requirement_id, entry)).collect();
+        let time = entry.blame.as_ref().and_then(|b| b.author_time);
+        groups.entry(key).or_default().add(time);
+    }
+}
+
+fn top_dir(file: &Path) -> String {
+    let mut components = file
+        .components()
+        .filter(|c| matches!(c, Component::Normal(_)));
+    match (components.next(), components.next()) {
+        (Some(dir), Some(_)) => dir.as_os_str().to_string_lossy().into_owned(),
+        _ => ".".to_string(),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::git::BlameInfo;
+    use crate::scan::ScopeItem;
+
+    fn entry(file: &str, scope_kind: Option<&str>, author: Option<(&str, i64)>) -> Entry {
+        Entry {
+            file: PathBuf::from(file),
+            line: 1,
+            comment_text: String::new(),
+            above: None,
+            below: None,
+            inline: None,
+            scope: scope_kind
+                .map(|kind| ScopeItem {
+                    kind: kind.to_string(),
+                    name: None,
+                    line: 1,
+                })
+                .into_iter()
+                .collect(),
+            variants: None,
+            blame: author.map(|(author, time)| BlameInfo {
+                commit: "0".repeat(40),
+                author: Some(author.to_string()),
+                author_mail: None,
+                author_time: Some(time),
+                summary: None,
+            }),
+        }
+    }
+
+    #[test]
+    fn parses_dimension_lists() {
+        let spec: AggregateSpec = "by=requirement,top-dir".parse().unwrap();
+        assert_eq!(spec.by, vec![Dimension::Requirement, Dimension::TopDir]);
+        assert!(!spec.needs_blame());
+
+        let spec: AggregateSpec = "author, scope-kind".parse().unwrap();
+        assert_eq!(spec.by, vec![Dimension::Author, Dimension::ScopeKind]);
+        assert!(spec.needs_blame());
+
+        for bad in ["", "by=", "by=requirement,owner", "requirement,requirement"] {
+            assert!(
+                bad.parse::<AggregateSpec>().is_err(),
+                "expected {bad:?} to be rejected"
+            );
+        }
+    }
+
+    #[test]
+    fn top_dir_is_first_component() {
+        assert_eq!(top_dir(Path::new("src/scan/mod.rs")), "src");
+        assert_eq!(top_dir(Path::new("./lib/a.rs")), "lib");
+        assert_eq!(top_dir(Path::new("main.rs")), ".");
+    }
+
+    #[test]
+    fn folds_and_merges_groups() {
+        let by = [Dimension::Requirement, Dimension::TopDir];
+        let root = Path::new(".");
+
+        let mut first = Groups::new();
+        fold_hits(
+            root,
+            &by,
+            false,
+            &mut first,
+            vec![
+                (
+                    "REQ-1".to_string(),
+                    entry("src/a.rs", None, Some(("A", 20))),
+                ),
+                (
+                    "REQ-1".to_string(),
+                    entry("src/a.rs", None, Some(("A", 10))),
+                ),
+                ("REQ-2".to_string(), entry("src/a.rs", None, None)),
+            ],
+        );
+        let mut second = Groups::new();
+        fold_hits(
+            root,
+            &by,
+            false,
+            &mut second,
+            vec![(
+                "REQ-1".to_string(),
+                entry("src/b.rs", None, Some(("B", 30))),
+            )],
+        );
+
+        let mut cells = BTreeMap::new();
+        for groups in [first, second] {
+            for (key, cell) in groups {
+                cells.entry(key).or_insert_with(Cell::default).merge(cell);
+            }
+        }
+
+        let key = |a: &str, b: &str| vec![a.to_string(), b.to_string()];
+        assert_eq!(
+            cells[&key("REQ-1", "src")],
+            Cell {
+                count: 3,
+                first: Some(10),
+                last: Some(30),
+            }
+        );
+        assert_eq!(
+            cells[&key("REQ-2", "src")],
+            Cell {
+                count: 1,
+                first: None,
+                last: None,
+            }
+        );
+    }
+
+    #[test]
+    fn missing_values_group_under_none() {
+        let bare = entry("a.rs", None, None);
+        assert_eq!(Dimension::ScopeKind.key("REQ-1", &bare), NONE_KEY);
+        assert_eq!(Dimension::Author.key("REQ-1", &bare), NONE_KEY);
+
+        let full = entry("a.rs", Some("function_item"), Some(("Ada", 1)));
+        assert_eq!(Dimension::ScopeKind.key("REQ-1", &full), "function_item");
+        assert_eq!(Dimension::Author.key("REQ-1", &full), "Ada");
+    }
+}
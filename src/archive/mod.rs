@@ -0,0 +1,474 @@
+//! Scanning source archives without extracting them.
+//!
+//! Members are decompressed one at a time on the calling thread and handed
+//! through a bounded queue to the worker pool, so parsing overlaps
+//! decompression and at most a queue's worth of members is held in memory.
+//! Members are filtered by language and by the include/exclude globs,
+//! matched against their path in the archive, before they are decompressed.
+//! Nothing is written to disk.
+
+mod zip;
+
+use crate::filter::GlobFilters;
+use crate::pool;
+use crate::scan::{FileHits, ScanError, ScanResult, Scanner, Source};
+use crate::stats::{self, Skip};
+use crate::trace;
+use ast_grep_language::{Language, SupportLang};
+use flate2::read::GzDecoder;
+use std::fs::File;
+use std::io::{self, BufReader, Read};
+use std::path::{Component, Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, mpsc};
+use std::thread;
+use thiserror::Error;
+
+/// Members decompressed ahead of the workers, per worker.
+const QUEUE_PER_WORKER: usize = 4;
+
+/// Most a member buffer reserves up front from the size in its header. A
+/// larger member grows as it is read, so a corrupt size cannot allocate more
+/// than the data actually behind it.
+const MAX_RESERVE: u64 = 16 * 1024 * 1024;
+
+#[derive(Debug, Error)]
+pub enum ArchiveError {
+    #[error("failed to read archive {path}: {source}")]
+    Read { path: PathBuf, source: io::Error },
+
+    #[error("unsupported archive {path}: {reason}")]
+    Unsupported { path: PathBuf, reason: String },
+
+    #[error(transparent)]
+    Scan(#[from] ScanError),
+}
+
+/// Archive formats that can be scanned in place.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ArchiveKind {
+    Tar,
+    TarGz,
+    Zip,
+}
+
+impl ArchiveKind {
+    /// The archive format named by `path`'s extension, if any.
+    pub fn from_path(path: &Path) -> Option<Self> {
+        let name = path.file_name()?.to_string_lossy().to_ascii_lowercase();
+        if name.ends_with(".tar.gz") || name.ends_with(".tgz") {
+            Some(Self::TarGz)
+        } else if name.ends_with(".tar") {
+            Some(Self::Tar)
+        } else if name.ends_with(".zip") {
+            Some(Self::Zip)
+        } else {
+            None
+        }
+    }
+}
+
+/// One decompressed archive member, numbered in archive order.
+struct Member {
+    index: usize,
+    path: PathBuf,
+    content: Vec<u8>,
+}
+
+/// Scan the members of the archive at `path` that `filters` allows.
+///
+/// Entry paths are the member paths inside the archive. Hits are merged in
+/// archive order and cut to the scanner's limit; once the limit is reached
+/// no further members are decompressed.
+pub fn scan_archive(
+    path: &Path,
+    kind: ArchiveKind,
+    filters: &GlobFilters,
+    scanner: &Scanner,
+) -> Result<ScanResult, ArchiveError> {
+    let limit = scanner.limit().unwrap_or(usize::MAX);
+    let workers = pool::worker_count(usize::MAX);
+    let (sender, receiver) = mpsc::sync_channel::<Member>(workers * QUEUE_PER_WORKER);
+    // Only the workers own the receiver, so it is dropped once they have all
+    // exited, even by panicking, and the reader stops instead of blocking
+    let receiver = Arc::new(Mutex::new(receiver));
+    let stop = AtomicBool::new(false);
+    let found = AtomicUsize::new(0);
+    let (stop, found) = (&stop, &found);
+
+    let (read, per_worker) = thread::scope(|scope| {
+        let handles: Vec<_> = (0..workers)
+            .map(|_| {
+                let receiver = Arc::clone(&receiver);
+                scope.spawn(move || {
+                    let _span = trace::span("worker");
+                    let mut done = Vec::new();
+                    loop {
+                        // The lock is only held while waiting for the next member
+                        let member = {
+                            let _wait = trace::span("wait");
+                            receiver.lock().unwrap().recv()
+                        };
+                        let Ok(member) = member else { break };
+                        let result =
+                            scanner.scan_source(&Source::new(&member.path, &member.content));
+                        match &result {
+                            Ok(hits) if !hits.is_empty() => {
+                                if found.fetch_add(hits.len(), Ordering::Relaxed) + hits.len()
+                                    >= limit
+                                {
+                                    stop.store(true, Ordering::Relaxed);
+                                }
+                            }
+                            Ok(_) => {}
+                            Err(_) => stop.store(true, Ordering::Relaxed),
+                        }
+                        done.push((member.index, result));
+                    }
+                    done
+                })
+            })
+            .collect();
+        drop(receiver);
+
+        let _span = trace::span("decompress");
+        let mut next = 0;
+        let read = read_members(path, kind, filters, stop, |path, content| {
+            let member = Member {
+                index: next,
+                path,
+                content,
+            };
+            next += 1;
+            // A full queue means the workers are the bottleneck; only that
+            // wait is traced. Sending fails once every worker has exited
+            match sender.try_send(member) {
+                Ok(()) => true,
+                Err(mpsc::TrySendError::Full(member)) => {
+                    let _wait = trace::span("wait");
+                    sender.send(member).is_ok()
+                }
+                Err(mpsc::TrySendError::Disconnected(_)) => false,
+            }
+        });
+        drop(sender);
+
+        let per_worker: Vec<Vec<(usize, Result<FileHits, ScanError>)>> = handles
+            .into_iter()
+            .map(|h| h.join().unwrap_or_else(|e| std::panic::resume_unwind(e)))
+            .collect();
+        (read, per_worker)
+    });
+
+    let mut per_member: Vec<(usize, Result<FileHits, ScanError>)> =
+        per_worker.into_iter().flatten().collect();
+    per_member.sort_unstable_by_key(|(index, _)| *index);
+
+    let mut results = ScanResult::new();
+    let mut remaining = limit;
+    for (_, hits) in per_member {
+        // Members past the limit may still have been scanned
+        if remaining == 0 {
+            return Ok(results);
+        }
+        for (slug, entry) in hits? {
+            if remaining == 0 {
+                return Ok(results);
+            }
+            remaining -= 1;
+            results.entry(slug).or_default().push(entry);
+        }
+    }
+    // A read error after the limit was reached is not worth reporting
+    read?;
+    Ok(results)
+}
+
+/// Decompress every wanted member in archive order and pass it to `emit`,
+/// until `emit` returns false or `stop` is set.
+fn read_members<F>(
+    path: &Path,
+    kind: ArchiveKind,
+    filters: &GlobFilters,
+    stop: &AtomicBool,
+    mut emit: F,
+) -> Result<(), ArchiveError>
+where
+    F: FnMut(PathBuf, Vec<u8>) -> bool,
+{
+    let read_error = |source| ArchiveError::Read {
+        path: path.to_path_buf(),
+        source,
+    };
+    let file = BufReader::new(File::open(path).map_err(read_error)?);
+
+    let wanted = |member: &Path| {
+        if SupportLang::from_path(member).is_none() {
+            stats::skip(Skip::UnsupportedLanguage);
+            false
+        } else if !filters.allows(&member.to_string_lossy()) {
+            stats::skip(Skip::Glob);
+            false
+        } else {
+            true
+        }
+    };
+
+    let tar = match kind {
+        ArchiveKind::Zip => {
+            return zip::read_members(file, &wanted, stop, &mut emit).map_err(|e| match e {
+                zip::ZipError::Io(e) => read_error(e),
+                zip::ZipError::Unsupported(reason) => ArchiveError::Unsupported {
+                    path: path.to_path_buf(),
+                    reason,
+                },
+            });
+        }
+        ArchiveKind::TarGz => read_tar(GzDecoder::new(file), &wanted, stop, &mut emit),
+        ArchiveKind::Tar => read_tar(file, &wanted, stop, &mut emit),
+    };
+    tar.map_err(read_error)
+}
+
+fn read_tar<R, W, F>(reader: R, wanted: &W, stop: &AtomicBool, emit: &mut F) -> io::Result<()>
+where
+    R: Read,
+    W: Fn(&Path) -> bool,
+    F: FnMut(PathBuf, Vec<u8>) -> bool,
+{
+    let mut archive = tar::Archive::new(reader);
+    for entry in archive.entries()? {
+        if stop.load(Ordering::Relaxed) {
+            break;
+        }
+        let mut entry = entry?;
+        if !entry.header().entry_type().is_file() {
+            continue;
+        }
+        let member = member_path(&entry.path()?);
+        // Unwanted members are skipped without decompressing into memory
+        if !wanted(&member) {
+            continue;
+        }
+        let mut content = Vec::with_capacity(entry.size().min(MAX_RESERVE) as usize);
+        entry.read_to_end(&mut content)?;
+        if !emit(member, content) {
+            break;
+        }
+    }
+    Ok(())
+}
+
+/// A member path relative to the archive root, without `./` prefixes or a
+/// leading `/`.
+fn member_path(path: &Path) -> PathBuf {
+    path.components()
+        .filter(|component| matches!(component, Component::Normal(_) | Component::ParentDir))
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use flate2::Compression;
+    use flate2::write::GzEncoder;
+    use std::io::Write;
+    use tempfile::TempDir;
+
+    fn scanner(limit: Option<usize>) -> Scanner {
+        Scanner::new(&crate::scan::ScanArgs {
+            slug: vec!["REQ".to_string()],
+            limit,
+            ..Default::default()
+        })
+        .unwrap()
+    }
+
+    fn write_tar_gz(path: &Path, members: &[(&str, &str)]) {
+        let gz = GzEncoder::new(File::create(path).unwrap(), Compression::default());
+        let mut builder = tar::Builder::new(gz);
+        for (name, content) in members {
+            let mut header = tar::Header::new_gnu();
+            header.set_size(content.len() as u64);
+            header.set_mode(0o644);
+            header.set_cksum();
+            builder
+                .append_data(&mut header, name, content.as_bytes())
+                .unwrap();
+        }
+        builder
+            .into_inner()
+            .unwrap()
+            .finish()
+            .unwrap()
+            .flush()
+            .unwrap();
+    }
+
+    #[test]
+    fn kind_comes_from_the_extension() {
+        assert_eq!(
+            ArchiveKind::from_path(Path::new("drop.TAR.GZ")),
+            Some(ArchiveKind::TarGz)
+        );
+        assert_eq!(
+            ArchiveKind::from_path(Path::new("drop.tgz")),
+            Some(ArchiveKind::TarGz)
+        );
+        assert_eq!(
+            ArchiveKind::from_path(Path::new("a/drop.tar")),
+            Some(ArchiveKind::Tar)
+        );
+        assert_eq!(
+            ArchiveKind::from_path(Path::new("drop.zip")),
+            Some(ArchiveKind::Zip)
+        );
+        assert_eq!(ArchiveKind::from_path(Path::new("src")), None);
+    }
+
+    #[test]
+    fn member_paths_are_relative() {
+        assert_eq!(member_path(Path::new("./src/a.c")), Path::new("src/a.c"));
+        assert_eq!(member_path(Path::new("/src/a.c")), Path::new("src/a.c"));
+    }
+
+    #[test]
+    fn tar_members_are_filtered_before_decompression() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join("drop.tar.gz");
+        write_tar_gz(
+            &path,
+            &[
+                ("./src/a.rs", "// REQ-1\n"),
+                ("src/notes.txt", "REQ-2\n"),
+                ("vendor/b.rs", "// REQ-3\n"),
+                ("src/c.rs", "// REQ-4\n"),
+            ],
+        );
+        let filters = GlobFilters::new(&[], &["vendor/**".to_string()]).unwrap();
+
+        let mut seen = Vec::new();
+        read_members(
+            &path,
+            ArchiveKind::TarGz,
+            &filters,
+            &AtomicBool::new(false),
+            |member, content| {
+                seen.push((member, String::from_utf8(content).unwrap()));
+                true
+            },
+        )
+        .unwrap();
+        assert_eq!(
+            seen,
+            vec![
+                (PathBuf::from("src/a.rs"), "// REQ-1\n".to_string()),
+                (PathBuf::from("src/c.rs"), "// REQ-4\n".to_string()),
+            ]
+        );
+    }
+
+    #[test]
+    fn emit_returning_false_stops_reading() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join("drop.tgz");
+        write_tar_gz(&path, &[("a.rs", "// REQ-1\n"), ("b.rs", "// REQ-2\n")]);
+
+        let mut count = 0;
+        read_members(
+            &path,
+            ArchiveKind::TarGz,
+            &GlobFilters::default(),
+            &AtomicBool::new(false),
+            |_, _| {
+                count += 1;
+                false
+            },
+        )
+        .unwrap();
+        assert_eq!(count, 1);
+    }
+
+    #[test]
+    fn empty_archive_scans_to_nothing() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join("drop.tar.gz");
+        write_tar_gz(&path, &[]);
+
+        let results = scan_archive(
+            &path,
+            ArchiveKind::TarGz,
+            &GlobFilters::default(),
+            &scanner(None),
+        )
+        .unwrap();
+        assert!(results.is_empty());
+    }
+
+    #[test]
+    fn tar_gz_and_zip_members_are_scanned() {
+        let dir = TempDir::new().unwrap();
+        let members = [
+            ("./src/a.rs", "fn a() {}\n// REQ-1\n"),
+            ("docs/notes.md", "REQ-9\n"),
+            ("src/b.py", "# REQ-2\ndef b():\n    pass\n"),
+        ];
+        let tar_gz = dir.path().join("drop.tar.gz");
+        write_tar_gz(&tar_gz, &members);
+        let zip = dir.path().join("drop.zip");
+        std::fs::write(&zip, zip::tests::deflated_zip(&members)).unwrap();
+
+        for (path, kind) in [(&tar_gz, ArchiveKind::TarGz), (&zip, ArchiveKind::Zip)] {
+            let results =
+                scan_archive(path, kind, &GlobFilters::default(), &scanner(None)).unwrap();
+            assert_eq!(results.keys().collect::<Vec<_>>(), ["REQ-1", "REQ-2"]);
+            assert_eq!(results["REQ-1"][0].file, Path::new("src/a.rs"));
+            assert_eq!(results["REQ-1"][0].line, 2);
+            assert_eq!(results["REQ-2"][0].file, Path::new("src/b.py"));
+        }
+    }
+
+    #[test]
+    fn limit_keeps_the_first_hits_in_archive_order() {
+        let dir = TempDir::new().unwrap();
+        // Enough members that the workers finish them out of order
+        let files: Vec<(String, String)> = (0..64)
+            .map(|i| {
+                (
+                    format!("src/f{i:02}.rs"),
+                    format!("// REQ-{i}\nfn f() {{}}\n"),
+                )
+            })
+            .collect();
+        let members: Vec<(&str, &str)> = files
+            .iter()
+            .map(|(name, content)| (name.as_str(), content.as_str()))
+            .collect();
+        let tar_gz = dir.path().join("drop.tar.gz");
+        write_tar_gz(&tar_gz, &members);
+        let zip = dir.path().join("drop.zip");
+        std::fs::write(&zip, zip::tests::deflated_zip(&members)).unwrap();
+
+        for (path, kind) in [(&tar_gz, ArchiveKind::TarGz), (&zip, ArchiveKind::Zip)] {
+            let results =
+                scan_archive(path, kind, &GlobFilters::default(), &scanner(Some(5))).unwrap();
+            let mut files: Vec<_> = results.values().flatten().map(|e| e.file.clone()).collect();
+            files.sort();
+            let expected: Vec<_> = (0..5)
+                .map(|i| PathBuf::from(format!("src/f{i:02}.rs")))
+                .collect();
+            assert_eq!(files, expected, "{kind:?}");
+        }
+    }
+
+    #[test]
+    fn missing_archive_is_a_read_error() {
+        let result = scan_archive(
+            Path::new("/nonexistent-tracy-drop.zip"),
+            ArchiveKind::Zip,
+            &GlobFilters::default(),
+            &scanner(Some(1)),
+        );
+        assert!(matches!(result, Err(ArchiveError::Read { .. })));
+    }
+}
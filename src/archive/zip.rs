@@ -0,0 +1,338 @@
+//! Minimal zip reader: stored and deflated members of single-disk archives,
+//! read straight from the archive file through the central directory.
+
+use super::{MAX_RESERVE, member_path};
+use flate2::read::DeflateDecoder;
+use std::io::{self, Read, Seek, SeekFrom};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+
+const END_OF_CENTRAL_DIRECTORY: u32 = 0x0605_4b50;
+const CENTRAL_FILE_HEADER: u32 = 0x0201_4b50;
+const LOCAL_FILE_HEADER: u32 = 0x0403_4b50;
+
+/// Fixed part of the end of central directory record.
+const EOCD_LEN: usize = 22;
+/// The record may be followed by a comment of up to this length.
+const MAX_COMMENT_LEN: usize = u16::MAX as usize;
+const CENTRAL_HEADER_LEN: usize = 46;
+const LOCAL_HEADER_LEN: usize = 30;
+
+const STORED: u16 = 0;
+const DEFLATED: u16 = 8;
+const ENCRYPTED: u16 = 1;
+
+#[derive(Debug)]
+pub(super) enum ZipError {
+    Io(io::Error),
+    Unsupported(String),
+}
+
+impl From<io::Error> for ZipError {
+    fn from(e: io::Error) -> Self {
+        Self::Io(e)
+    }
+}
+
+/// A file member as listed in the central directory.
+#[derive(Debug, PartialEq)]
+struct CentralEntry {
+    path: PathBuf,
+    method: u16,
+    flags: u16,
+    compressed_size: u64,
+    size: u64,
+    local_header: u64,
+}
+
+/// Decompress every wanted member in central directory order and pass it to
+/// `emit`, until `emit` returns false or `stop` is set.
+pub(super) fn read_members<R, W, F>(
+    mut reader: R,
+    wanted: &W,
+    stop: &AtomicBool,
+    emit: &mut F,
+) -> Result<(), ZipError>
+where
+    R: Read + Seek,
+    W: Fn(&Path) -> bool,
+    F: FnMut(PathBuf, Vec<u8>) -> bool,
+{
+    let len = reader.seek(SeekFrom::End(0))?;
+    for entry in central_directory(&mut reader)? {
+        if stop.load(Ordering::Relaxed) {
+            break;
+        }
+        if !wanted(&entry.path) {
+            continue;
+        }
+        if entry.flags & ENCRYPTED != 0 {
+            return Err(ZipError::Unsupported(format!(
+                "{} is encrypted",
+                entry.path.display()
+            )));
+        }
+
+        reader.seek(SeekFrom::Start(entry.local_header))?;
+        let mut header = [0; LOCAL_HEADER_LEN];
+        reader.read_exact(&mut header)?;
+        if u32_at(&header, 0) != LOCAL_FILE_HEADER {
+            return Err(corrupt("bad local file header"));
+        }
+        let skip = u64::from(u16_at(&header, 26)) + u64::from(u16_at(&header, 28));
+        let data_start = entry.local_header + LOCAL_HEADER_LEN as u64 + skip;
+        if data_start + entry.compressed_size > len {
+            return Err(corrupt("member extends past the end of the archive"));
+        }
+        reader.seek(SeekFrom::Start(data_start))?;
+
+        let data = (&mut reader).take(entry.compressed_size);
+        let mut content = Vec::with_capacity(entry.size.min(MAX_RESERVE) as usize);
+        match entry.method {
+            STORED => data.take(entry.size).read_to_end(&mut content)?,
+            DEFLATED => DeflateDecoder::new(data)
+                .take(entry.size)
+                .read_to_end(&mut content)?,
+            method => {
+                return Err(ZipError::Unsupported(format!(
+                    "{} uses compression method {method}",
+                    entry.path.display()
+                )));
+            }
+        };
+        if !emit(entry.path, content) {
+            break;
+        }
+    }
+    Ok(())
+}
+
+/// The file members listed in the central directory.
+fn central_directory<R: Read + Seek>(reader: &mut R) -> Result<Vec<CentralEntry>, ZipError> {
+    let len = reader.seek(SeekFrom::End(0))?;
+    let tail_len = len.min((EOCD_LEN + MAX_COMMENT_LEN) as u64);
+    reader.seek(SeekFrom::Start(len - tail_len))?;
+    let mut tail = Vec::with_capacity(tail_len as usize);
+    reader.read_to_end(&mut tail)?;
+
+    // The last signature wins; a comment could contain an earlier one
+    let eocd = (0..tail.len().saturating_sub(EOCD_LEN - 1))
+        .rev()
+        .find(|&at| u32_at(&tail, at) == END_OF_CENTRAL_DIRECTORY)
+        .ok_or_else(|| corrupt("no end of central directory record"))?;
+    let record = &tail[eocd..];
+    if u16_at(record, 4) != 0 || u16_at(record, 6) != 0 {
+        return Err(ZipError::Unsupported(
+            "multi-disk archives are not supported".to_string(),
+        ));
+    }
+    let count = u16_at(record, 10);
+    let size = u32_at(record, 12);
+    let offset = u32_at(record, 16);
+    if count == u16::MAX || size == u32::MAX || offset == u32::MAX {
+        return Err(ZipError::Unsupported(
+            "zip64 archives are not supported".to_string(),
+        ));
+    }
+
+    // The directory ends where the record starts; checking that bounds the
+    // buffer below by the file's real length
+    let record_start = len - tail_len + eocd as u64;
+    if u64::from(offset) + u64::from(size) > record_start {
+        return Err(corrupt("central directory outside the archive"));
+    }
+    reader.seek(SeekFrom::Start(u64::from(offset)))?;
+    let mut directory = vec![0; size as usize];
+    reader.read_exact(&mut directory)?;
+
+    let max_entries = directory.len() / CENTRAL_HEADER_LEN;
+    let mut entries = Vec::with_capacity(usize::from(count).min(max_entries));
+    let mut at = 0;
+    for _ in 0..count {
+        let header = directory
+            .get(at..at + CENTRAL_HEADER_LEN)
+            .filter(|header| u32_at(header, 0) == CENTRAL_FILE_HEADER)
+            .ok_or_else(|| corrupt("bad central directory entry"))?;
+        let name_len = usize::from(u16_at(header, 28));
+        let extra_len = usize::from(u16_at(header, 30));
+        let comment_len = usize::from(u16_at(header, 32));
+        let compressed_size = u32_at(header, 20);
+        let size = u32_at(header, 24);
+        let local_header = u32_at(header, 42);
+        let flags = u16_at(header, 8);
+        let method = u16_at(header, 10);
+
+        let name_start = at + CENTRAL_HEADER_LEN;
+        let name = directory
+            .get(name_start..name_start + name_len)
+            .ok_or_else(|| corrupt("truncated central directory"))?;
+        at = name_start + name_len + extra_len + comment_len;
+
+        // Directories have a trailing slash and no content
+        if name.ends_with(b"/") {
+            continue;
+        }
+        if compressed_size == u32::MAX || size == u32::MAX || local_header == u32::MAX {
+            return Err(ZipError::Unsupported(
+                "zip64 archives are not supported".to_string(),
+            ));
+        }
+        entries.push(CentralEntry {
+            path: member_path(Path::new(&*String::from_utf8_lossy(name))),
+            method,
+            flags,
+            compressed_size: u64::from(compressed_size),
+            size: u64::from(size),
+            local_header: u64::from(local_header),
+        });
+    }
+    Ok(entries)
+}
+
+fn corrupt(reason: &str) -> ZipError {
+    ZipError::Io(io::Error::new(io::ErrorKind::InvalidData, reason))
+}
+
+fn u16_at(bytes: &[u8], at: usize) -> u16 {
+    u16::from_le_bytes([bytes[at], bytes[at + 1]])
+}
+
+fn u32_at(bytes: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes([bytes[at], bytes[at + 1], bytes[at + 2], bytes[at + 3]])
+}
+
+#[cfg(test)]
+pub(super) mod tests {
+    use super::*;
+    use flate2::Compression;
+    use flate2::write::DeflateEncoder;
+    use std::io::{Cursor, Write};
+
+    /// Build a zip archive of deflated `(name, content)` members.
+    pub(in crate::archive) fn deflated_zip(members: &[(&str, &str)]) -> Vec<u8> {
+        let members: Vec<_> = members
+            .iter()
+            .map(|&(name, content)| (name, DEFLATED, content))
+            .collect();
+        build_zip(&members)
+    }
+
+    /// Build a zip archive of `(name, method, content)` members.
+    fn build_zip(members: &[(&str, u16, &str)]) -> Vec<u8> {
+        let mut out = Vec::new();
+        let mut directory = Vec::new();
+        for (name, method, content) in members {
+            let data = if *method == DEFLATED {
+                let mut encoder = DeflateEncoder::new(Vec::new(), Compression::default());
+                encoder.write_all(content.as_bytes()).unwrap();
+                encoder.finish().unwrap()
+            } else {
+                content.as_bytes().to_vec()
+            };
+            let offset = out.len() as u32;
+            let sizes = [data.len() as u32, content.len() as u32];
+
+            out.extend(LOCAL_FILE_HEADER.to_le_bytes());
+            out.extend([20, 0, 0, 0]);
+            out.extend(method.to_le_bytes());
+            out.extend([0; 8]);
+            sizes.iter().for_each(|size| out.extend(size.to_le_bytes()));
+            out.extend((name.len() as u16).to_le_bytes());
+            out.extend([0, 0]);
+            out.extend(name.as_bytes());
+            out.extend(&data);
+
+            directory.extend(CENTRAL_FILE_HEADER.to_le_bytes());
+            directory.extend([20, 0, 20, 0, 0, 0]);
+            directory.extend(method.to_le_bytes());
+            directory.extend([0; 8]);
+            sizes
+                .iter()
+                .for_each(|size| directory.extend(size.to_le_bytes()));
+            directory.extend((name.len() as u16).to_le_bytes());
+            directory.extend([0; 12]);
+            directory.extend(offset.to_le_bytes());
+            directory.extend(name.as_bytes());
+        }
+
+        let offset = out.len() as u32;
+        out.extend(&directory);
+        out.extend(END_OF_CENTRAL_DIRECTORY.to_le_bytes());
+        out.extend([0; 4]);
+        out.extend((members.len() as u16).to_le_bytes());
+        out.extend((members.len() as u16).to_le_bytes());
+        out.extend((directory.len() as u32).to_le_bytes());
+        out.extend(offset.to_le_bytes());
+        out.extend(7u16.to_le_bytes());
+        out.extend(b"comment");
+        out
+    }
+
+    fn read_all(zip: Vec<u8>) -> Result<Vec<(PathBuf, String)>, ZipError> {
+        let mut seen = Vec::new();
+        read_members(
+            Cursor::new(zip),
+            &|path: &Path| path.extension().is_some_and(|ext| ext == "rs"),
+            &AtomicBool::new(false),
+            &mut |path, content| {
+                seen.push((path, String::from_utf8(content).unwrap()));
+                true
+            },
+        )?;
+        Ok(seen)
+    }
+
+    #[test]
+    fn reads_stored_and_deflated_members() {
+        let zip = build_zip(&[
+            ("src/", STORED, ""),
+            ("src/a.rs", STORED, "// REQ-1\n"),
+            ("README.md", DEFLATED, "REQ-2"),
+            ("./src/b.rs", DEFLATED, "// REQ-3\nfn b() {}\n"),
+        ]);
+
+        assert_eq!(
+            read_all(zip).unwrap(),
+            vec![
+                (PathBuf::from("src/a.rs"), "// REQ-1\n".to_string()),
+                (
+                    PathBuf::from("src/b.rs"),
+                    "// REQ-3\nfn b() {}\n".to_string()
+                ),
+            ]
+        );
+    }
+
+    #[test]
+    fn rejects_unknown_methods_and_garbage() {
+        let zip = build_zip(&[("a.rs", 12, "// REQ-1\n")]);
+        assert!(matches!(read_all(zip), Err(ZipError::Unsupported(_))));
+
+        assert!(matches!(
+            read_all(b"not a zip".to_vec()),
+            Err(ZipError::Io(e)) if e.kind() == io::ErrorKind::InvalidData
+        ));
+    }
+
+    #[test]
+    fn sizes_are_checked_against_the_file() {
+        let zip = build_zip(&[("a.rs", STORED, "// REQ-1\n")]);
+        let record = zip.len() - EOCD_LEN - "comment".len();
+        let directory = u32_at(&zip, record + 16) as usize;
+        let corrupt_at = |at: usize, value: u32| {
+            let mut zip = zip.clone();
+            zip[at..at + 4].copy_from_slice(&value.to_le_bytes());
+            read_all(zip)
+        };
+        let invalid_data = |result: Result<_, ZipError>| matches!(result, Err(ZipError::Io(e)) if e.kind() == io::ErrorKind::InvalidData);
+
+        // Central directory size, then a member's compressed size
+        assert!(invalid_data(corrupt_at(record + 12, 0xffff_0000)));
+        assert!(invalid_data(corrupt_at(directory + 20, 0xffff_0000)));
+        // A size larger than the data only reads what is there
+        assert_eq!(
+            corrupt_at(directory + 24, 0xffff_0000).unwrap(),
+            vec![(PathBuf::from("a.rs"), "// REQ-1\n".to_string())]
+        );
+    }
+}
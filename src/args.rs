@@ -1,9 +1,16 @@
-use crate::config::Config;
+use crate::aggregate::{AggregateError, AggregateSpec};
+use crate::archive::ArchiveKind;
+use crate::config::{CONFIG_FILE, Config, ProfileConfig, ScanConfig, load_config};
+use crate::discover::DiscoverArgs;
 use crate::error::TracyError;
 use crate::filter::FilterArgs;
 use crate::output::OutputFormat;
-use crate::scan::ScanArgs;
-use clap::Parser;
+use crate::profile::Profile;
+use crate::roots::{RootsError, ScanRoot, read_manifest, root_name};
+use crate::scan::{ContextRule, MarkerSource, ScanArgs, ScanError, Variant};
+use crate::stats::StatsFormat;
+use clap::{Parser, Subcommand};
+use std::fs;
 use std::path::{Path, PathBuf};
 
 #[derive(Parser, Debug)]
@@ -13,8 +20,21 @@ use std::path::{Path, PathBuf};
     about = "Scan codebases for requirement references in comments and output results"
 )]
 pub struct Args {
-    #[arg(long, help = "Root directory to scan (default: config dir or '.')")]
-    pub root: Option<PathBuf>,
+    #[command(subcommand)]
+    pub command: Option<Command>,
+
+    #[arg(
+        long,
+        help = "Root directory to scan (default: config dir or '.'). Can be repeated to scan several roots."
+    )]
+    pub root: Vec<PathBuf>,
+
+    #[arg(
+        long,
+        value_name = "PATH",
+        help = "Also scan the roots listed in this file (one directory per line)"
+    )]
+    pub roots_file: Option<PathBuf>,
 
     #[arg(long, value_enum, help = "Output format")]
     pub format: Option<OutputFormat>,
@@ -29,21 +49,92 @@ pub struct Args {
     #[arg(long, help = "Disable config file loading")]
     pub no_config: bool,
 
-    #[arg(short, long, help = "Write output to file (in addition to stdout)")]
+    #[arg(
+        long,
+        conflicts_with = "no_config",
+        help = "Apply tracy.toml files found in subdirectories to the files below them"
+    )]
+    pub nested_configs: bool,
+
+    #[arg(
+        short,
+        long,
+        help = "Write output to file (in addition to stdout); report directory for --format html"
+    )]
     pub output: Option<PathBuf>,
 
+    #[arg(
+        long,
+        value_name = "PATH",
+        help = "Write a Make/Ninja depfile listing every file the scan read (requires --output)"
+    )]
+    pub depfile: Option<PathBuf>,
+
+    #[arg(
+        long,
+        value_name = "PATH",
+        help = "Touch this file after every successful run; with --depfile it is the depfile target"
+    )]
+    pub stamp: Option<PathBuf>,
+
     #[arg(short, long, help = "Suppress stdout output")]
     pub quiet: bool,
 
     #[arg(long, help = "Exit with error if no matches found")]
     pub fail_on_empty: bool,
 
+    #[arg(
+        long,
+        value_name = "ID",
+        help = "Stop at the first reference to ID; exit with error if there is none"
+    )]
+    pub exists: Option<String>,
+
+    #[arg(
+        long,
+        value_name = "PATH",
+        help = "Requirements catalog (.csv, .json or .reqif) to check coverage against"
+    )]
+    pub catalog: Option<PathBuf>,
+
+    #[arg(
+        long,
+        value_name = "by=DIM,...",
+        help = "Output counts grouped by requirement, top-dir, scope-kind and/or author instead of matches"
+    )]
+    pub aggregate: Option<String>,
+
+    #[arg(
+        long = "profile",
+        value_name = "NAME",
+        help = "Only run this [[profile]] from the config (repeatable; default: all)"
+    )]
+    pub profiles: Vec<String>,
+
     #[arg(long, help = "Include git repository metadata in output")]
     pub include_git_meta: bool,
 
     #[arg(long, help = "Include git blame metadata for each match")]
     pub include_blame: bool,
 
+    #[arg(
+        long,
+        value_enum,
+        value_name = "FORMAT",
+        num_args = 0..=1,
+        require_equals = true,
+        default_missing_value = "text",
+        help = "Print per-phase timings, throughput, skipped files and cache hits to stderr (text or json)"
+    )]
+    pub stats: Option<StatsFormat>,
+
+    #[arg(
+        long,
+        value_name = "PATH",
+        help = "Write a Chrome trace of the run (per-file and per-phase spans) for Perfetto"
+    )]
+    pub trace_out: Option<PathBuf>,
+
     #[command(flatten)]
     pub filter: FilterArgs,
 
@@ -51,17 +142,37 @@ pub struct Args {
     pub scan: ScanArgs,
 }
 
+#[derive(Subcommand, Debug)]
+pub enum Command {
+    /// List requirement-like prefixes (e.g. 'REQ' in 'REQ-123') used in comments
+    Discover(DiscoverArgs),
+}
+
 #[derive(Debug)]
 pub struct ResolvedArgs {
     pub root: PathBuf,
     pub format: OutputFormat,
     pub output: Option<PathBuf>,
+    pub depfile: Option<PathBuf>,
+    pub stamp: Option<PathBuf>,
     pub quiet: bool,
     pub fail_on_empty: bool,
     pub include_git_meta: bool,
     pub include_blame: bool,
+    pub catalog: Option<PathBuf>,
+    pub aggregate: Option<AggregateSpec>,
+    /// Compilation databases read for `[[variant]]` tables
+    pub compile_commands: Vec<PathBuf>,
     pub filter: FilterArgs,
     pub scan: ScanArgs,
+    /// `[[profile]]` tables to run instead of the single top-level scan
+    pub profiles: Vec<Profile>,
+    /// Roots to scan instead of `root`, when more than one is given
+    pub roots: Vec<ScanRoot>,
+    /// Apply `tracy.toml` files found in subdirectories of the root
+    pub nested_configs: bool,
+    /// Scan flags re-applied over every config layer
+    pub cli_scan: CliScan,
 }
 
 pub fn resolve_args(
@@ -70,11 +181,34 @@ pub fn resolve_args(
     config_dir: Option<&Path>,
 ) -> Result<ResolvedArgs, TracyError> {
     let config = config.unwrap_or_default();
+    let nested_configs = cli.nested_configs || config.nested_configs.unwrap_or(false);
 
     let base_dir = config_dir.unwrap_or_else(|| Path::new("."));
 
-    let root = match (cli.root, config.root) {
-        (Some(root), _) => root,
+    let mut root_paths = if !cli.root.is_empty() {
+        cli.root
+    } else {
+        config
+            .roots
+            .unwrap_or_default()
+            .into_iter()
+            .map(|path| resolve_path(base_dir, path))
+            .collect()
+    };
+    let roots_file = match (cli.roots_file, config.roots_file) {
+        (Some(path), _) => Some(path),
+        (None, Some(path)) => Some(resolve_path(base_dir, path)),
+        (None, None) => None,
+    };
+    if let Some(path) = &roots_file {
+        root_paths.extend(read_manifest(path)?);
+    }
+    let multi_root = root_paths.len() > 1;
+    // With profiles or several roots, the top-level settings are only defaults
+    let single_report = config.profiles.is_empty() && !multi_root;
+
+    let root = match (root_paths.first(), config.root) {
+        (Some(root), _) => root.clone(),
         (None, Some(root)) => resolve_path(base_dir, root),
         (None, None) => config_dir
             .map(|d| d.to_path_buf())
@@ -89,8 +223,41 @@ pub fn resolve_args(
         (None, None) => None,
     };
 
+    if format == OutputFormat::Html && output.is_none() && single_report {
+        return Err(TracyError::HtmlNeedsOutput);
+    }
+
+    let depfile = match (cli.depfile, config.depfile) {
+        (Some(depfile), _) => Some(depfile),
+        (None, Some(depfile)) => Some(resolve_path(base_dir, depfile)),
+        (None, None) => None,
+    };
+    if depfile.is_some() && output.is_none() {
+        return Err(TracyError::DepfileNeedsOutput);
+    }
+    let stamp = match (cli.stamp, config.stamp) {
+        (Some(stamp), _) => Some(stamp),
+        (None, Some(stamp)) => Some(resolve_path(base_dir, stamp)),
+        (None, None) => None,
+    };
+
+    let catalog = match (cli.catalog, config.catalog) {
+        (Some(catalog), _) => Some(catalog),
+        (None, Some(catalog)) => Some(resolve_path(base_dir, catalog)),
+        (None, None) => None,
+    };
+
+    let aggregate = cli
+        .aggregate
+        .or(config.aggregate)
+        .map(|spec| spec.parse::<AggregateSpec>())
+        .transpose()?;
+    if aggregate.is_some() && matches!(format, OutputFormat::Sarif | OutputFormat::Html) {
+        return Err(AggregateError::UnsupportedFormat(format).into());
+    }
+
     let quiet = cli.quiet || config.quiet.unwrap_or(false);
-    let fail_on_empty = cli.fail_on_empty || config.fail_on_empty.unwrap_or(false);
+    let mut fail_on_empty = cli.fail_on_empty || config.fail_on_empty.unwrap_or(false);
     let include_git_meta = cli.include_git_meta || config.include_git_meta.unwrap_or(false);
     let include_blame = cli.include_blame || config.include_blame.unwrap_or(false);
 
@@ -116,29 +283,483 @@ pub fn resolve_args(
         exclude,
     };
 
-    let slug = if !cli.scan.slug.is_empty() {
+    let cli_slug = !cli.scan.slug.is_empty() || cli.scan.slug_file.is_some();
+    let mut cli_scan = CliScan {
+        id_separator: cli.scan.id_separator.clone(),
+        id_number: cli.scan.id_number.clone(),
+        hierarchical: cli.scan.hierarchical,
+        word_boundary: cli.scan.word_boundary,
+        ignore_case: cli.scan.ignore_case,
+        id: (!cli.scan.id.is_empty()).then(|| cli.scan.id.clone()),
+        scope_kind: (!cli.scan.scope_kind.is_empty()).then(|| cli.scan.scope_kind.clone()),
+        limit: cli.scan.limit,
+        ..CliScan::default()
+    };
+
+    let mut slug = if !cli.scan.slug.is_empty() {
         cli.scan.slug
     } else {
         config.scan.slug.unwrap_or_default()
     };
 
-    if slug.is_empty() {
+    let slug_file = match (cli.scan.slug_file, config.scan.slug_file) {
+        (Some(path), _) => Some(path),
+        (None, Some(path)) => Some(resolve_path(base_dir, path)),
+        (None, None) => None,
+    };
+    if let Some(path) = &slug_file {
+        slug.extend(read_slug_file(path)?);
+    }
+
+    if slug.is_empty() && single_report {
         return Err(TracyError::NoSlugs);
     }
 
+    let mut id = if !cli.scan.id.is_empty() {
+        cli.scan.id
+    } else {
+        config.scan.id.unwrap_or_default()
+    };
+    let scope_kind = if !cli.scan.scope_kind.is_empty() {
+        cli.scan.scope_kind
+    } else {
+        config.scan.scope_kind.unwrap_or_default()
+    };
+    let mut limit = cli.scan.limit.or(config.scan.limit);
+
+    let markers = if !cli.scan.markers.is_empty() {
+        cli.scan.markers
+    } else {
+        config
+            .markers
+            .into_iter()
+            .map(|marker| MarkerSource::new(&marker.language, &marker.pattern))
+            .collect::<Result<_, _>>()?
+    };
+
+    let mut context_rules = Vec::new();
+    for config in config.context_rules {
+        let mut rule = ContextRule::new(config.kind);
+        for language in &config.languages {
+            let lang = language
+                .trim()
+                .parse()
+                .map_err(|e| ScanError::InvalidContextRule {
+                    kind: rule.kind.clone(),
+                    reason: format!("{e}"),
+                })?;
+            rule.languages.push(lang);
+        }
+        rule.context = config.context.unwrap_or(rule.context);
+        rule.scope = config.scope.unwrap_or(rule.scope);
+        rule.priority = config.priority.unwrap_or(rule.priority);
+        rule.name = config.name.unwrap_or_default();
+        context_rules.push(rule);
+    }
+
+    let mut compile_commands = Vec::new();
+    let variants = if !cli.scan.variants.is_empty() {
+        cli.scan.variants
+    } else {
+        let mut variants = Vec::new();
+        for config in config.variants {
+            let mut variant = Variant::new(config.name);
+            if let Some(path) = config.compile_commands {
+                let path = resolve_path(base_dir, path);
+                variant = variant.with_compile_commands(&path)?;
+                compile_commands.push(path);
+            }
+            variants.push(
+                config
+                    .defines
+                    .iter()
+                    .fold(variant, |variant, define| variant.define(define)),
+            );
+        }
+        variants
+    };
+
+    let cache_dir = match (cli.scan.cache_dir, config.cache.dir) {
+        (Some(dir), _) => Some(dir),
+        (None, Some(dir)) => Some(resolve_path(base_dir, dir)),
+        (None, None) => None,
+    };
+    let cache_max_mb = cli.scan.cache_max_mb.or(config.cache.max_mb);
+
+    let id_separator = cli.scan.id_separator.or(config.scan.id_separator);
+    let id_number = cli.scan.id_number.or(config.scan.id_number);
+    let hierarchical = cli.scan.hierarchical || config.scan.hierarchical.unwrap_or(false);
+    let word_boundary = cli.scan.word_boundary || config.scan.word_boundary.unwrap_or(false);
+    let ignore_case = cli.scan.ignore_case || config.scan.ignore_case.unwrap_or(false);
+
+    // Coverage is computed from the reported matches, so anything that
+    // drops matches would report referenced ids as unreferenced
+    if catalog.is_some() {
+        let conflict = [
+            (cli.exists.is_some(), "exists"),
+            (limit.is_some(), "limit"),
+            (!id.is_empty(), "id"),
+        ]
+        .into_iter()
+        .find_map(|(set, name)| set.then_some(name));
+        if let Some(name) = conflict {
+            return Err(TracyError::CatalogConflict(name));
+        }
+    }
+
+    // The matrix counts every hit of the single top-level scan
+    if aggregate.is_some() {
+        let conflict = [
+            (cli.exists.is_some(), "exists"),
+            (limit.is_some(), "limit"),
+            (catalog.is_some(), "catalog"),
+            (include_git_meta, "include-git-meta"),
+            (nested_configs, "nested-configs"),
+        ]
+        .into_iter()
+        .find_map(|(set, name)| set.then_some(name));
+        if let Some(name) = conflict {
+            return Err(TracyError::AggregateConflict(name));
+        }
+    }
+
+    // `--exists` is a single-id query that stops at the first hit
+    if let Some(exists) = cli.exists {
+        id = vec![exists];
+        limit = Some(1);
+        fail_on_empty = true;
+        cli_scan.id = Some(id.clone());
+        cli_scan.limit = limit;
+    }
+    if cli_slug {
+        cli_scan.slug = Some((slug.clone(), slug_file.clone()));
+    }
+
+    let scan = ScanArgs {
+        slug,
+        slug_file,
+        id_separator,
+        id_number,
+        hierarchical,
+        word_boundary,
+        ignore_case,
+        id,
+        scope_kind,
+        limit,
+        markers,
+        context_rules,
+        variants,
+        cache_dir,
+        cache_max_mb,
+    };
+
+    let mut profile_configs = config.profiles;
+    if !cli.profiles.is_empty() {
+        if let Some(unknown) = cli
+            .profiles
+            .iter()
+            .find(|name| !profile_configs.iter().any(|p| &p.name == *name))
+        {
+            return Err(TracyError::UnknownProfile(unknown.clone()));
+        }
+        profile_configs.retain(|p| cli.profiles.contains(&p.name));
+    }
+    if !profile_configs.is_empty() {
+        let conflict = [
+            (output.is_some(), "output"),
+            (depfile.is_some(), "depfile"),
+            (stamp.is_some(), "stamp"),
+            (catalog.is_some(), "catalog"),
+            (aggregate.is_some(), "aggregate"),
+        ]
+        .into_iter()
+        .find_map(|(set, name)| set.then_some(name));
+        if let Some(name) = conflict {
+            return Err(TracyError::ProfileConflict(name));
+        }
+    }
+    if multi_root {
+        let conflict = [
+            (depfile.is_some(), "depfile"),
+            (stamp.is_some(), "stamp"),
+            (catalog.is_some(), "catalog"),
+            (aggregate.is_some(), "aggregate"),
+            (!profile_configs.is_empty(), "[[profile]]"),
+        ]
+        .into_iter()
+        .find_map(|(set, name)| set.then_some(name));
+        if let Some(name) = conflict {
+            return Err(TracyError::RootConflict(name));
+        }
+    }
+    if !multi_root && ArchiveKind::from_path(&root).is_some() {
+        // An archive has no git history and no files on disk to depend on
+        let conflict = [
+            (depfile.is_some(), "depfile"),
+            (stamp.is_some(), "stamp"),
+            (aggregate.is_some(), "aggregate"),
+            (include_blame, "include-blame"),
+            (include_git_meta, "include-git-meta"),
+            (!profile_configs.is_empty(), "[[profile]]"),
+        ]
+        .into_iter()
+        .find_map(|(set, name)| set.then_some(name));
+        if let Some(name) = conflict {
+            return Err(TracyError::ArchiveConflict(name));
+        }
+    }
+    let roots = if multi_root {
+        root_paths
+            .into_iter()
+            .map(|path| resolve_root(path, format, output.as_deref(), &filter, &scan, &cli_scan))
+            .collect::<Result<_, _>>()?
+    } else {
+        Vec::new()
+    };
+
+    let profiles = profile_configs
+        .into_iter()
+        .map(|profile| resolve_profile(profile, &scan, &cli_scan, format, base_dir))
+        .collect::<Result<_, _>>()?;
+
     Ok(ResolvedArgs {
         root,
         format,
         output,
+        depfile,
+        stamp,
         quiet,
         fail_on_empty,
         include_git_meta,
         include_blame,
+        catalog,
+        aggregate,
+        compile_commands,
+        filter,
+        scan,
+        profiles,
+        roots,
+        nested_configs,
+        cli_scan,
+    })
+}
+
+/// Resolve a `[[profile]]` table; unset keys fall back to the top-level
+/// scan settings and format.
+fn resolve_profile(
+    config: ProfileConfig,
+    base: &ScanArgs,
+    cli: &CliScan,
+    format: OutputFormat,
+    base_dir: &Path,
+) -> Result<Profile, TracyError> {
+    let scan = overlay_scan(config.scan, base, cli, base_dir)?;
+
+    let format = config.format.unwrap_or(format);
+    let output = config.output.map(|path| resolve_path(base_dir, path));
+    if format == OutputFormat::Html && output.is_none() {
+        return Err(TracyError::HtmlNeedsOutput);
+    }
+
+    Ok(Profile {
+        name: config.name,
+        format,
+        output,
+        include: config.include,
+        exclude: config.exclude,
+        scan,
+    })
+}
+
+/// Resolve one root of a multi-root scan. A `tracy.toml` directly in the
+/// root overrides the top-level config for that root, though not the `cli`
+/// flags; with a top-level output directory, the root's report is written
+/// there under its name.
+fn resolve_root(
+    path: PathBuf,
+    format: OutputFormat,
+    output_dir: Option<&Path>,
+    filter: &FilterArgs,
+    scan: &ScanArgs,
+    cli: &CliScan,
+) -> Result<ScanRoot, TracyError> {
+    // Its members would otherwise be walked as a directory and find nothing
+    if ArchiveKind::from_path(&path).is_some() {
+        return Err(RootsError::Archive(path).into());
+    }
+    let name = root_name(&path);
+    let config_path = path.join(CONFIG_FILE);
+    let config = if config_path.is_file() {
+        load_config(&config_path)?
+    } else {
+        Config::default()
+    };
+
+    // Only `[scan]` and `[filter]` are resolved per root
+    let unsupported = [
+        (!config.markers.is_empty(), "[[marker]]"),
+        (!config.context_rules.is_empty(), "[[context_rule]]"),
+        (!config.variants.is_empty(), "[[variant]]"),
+        (
+            config.cache.dir.is_some() || config.cache.max_mb.is_some(),
+            "[cache]",
+        ),
+        (!config.profiles.is_empty(), "[[profile]]"),
+    ]
+    .into_iter()
+    .find_map(|(set, section)| set.then_some(section));
+    if let Some(section) = unsupported {
+        return Err(RootsError::UnsupportedSection {
+            root: name,
+            section,
+        }
+        .into());
+    }
+
+    let scan = overlay_scan(config.scan, scan, cli, &path)?;
+    let filter = FilterArgs {
+        include_vendored: config
+            .filter
+            .include_vendored
+            .unwrap_or(filter.include_vendored),
+        include_generated: config
+            .filter
+            .include_generated
+            .unwrap_or(filter.include_generated),
+        include_submodules: config
+            .filter
+            .include_submodules
+            .unwrap_or(filter.include_submodules),
+        include: config
+            .filter
+            .include
+            .unwrap_or_else(|| filter.include.clone()),
+        exclude: config
+            .filter
+            .exclude
+            .unwrap_or_else(|| filter.exclude.clone()),
+    };
+
+    let format = config.format.unwrap_or(format);
+    let output = match (config.output, output_dir) {
+        (Some(output), _) => Some(resolve_path(&path, output)),
+        (None, Some(dir)) => Some(match format.extension() {
+            Some(ext) => dir.join(format!("{name}.{ext}")),
+            None => dir.join(&name),
+        }),
+        (None, None) => None,
+    };
+    if format == OutputFormat::Html && output.is_none() {
+        return Err(TracyError::HtmlNeedsOutput);
+    }
+
+    Ok(ScanRoot {
+        name,
+        path,
+        format,
+        output,
         filter,
-        scan: ScanArgs { slug },
+        scan,
     })
 }
 
+/// Apply the scan keys set in a `[scan]`-like table on top of `base`, then
+/// the flags in `cli`, which win over every config layer; relative paths
+/// are resolved against `base_dir`.
+pub(crate) fn overlay_scan(
+    config: ScanConfig,
+    base: &ScanArgs,
+    cli: &CliScan,
+    base_dir: &Path,
+) -> Result<ScanArgs, TracyError> {
+    let mut scan = base.clone();
+    if let Some(slug) = config.slug {
+        scan.slug = slug;
+        scan.slug_file = None;
+    }
+    if let Some(path) = config.slug_file {
+        let path = resolve_path(base_dir, path);
+        scan.slug.extend(read_slug_file(&path)?);
+        scan.slug_file = Some(path);
+    }
+
+    scan.id_separator = config.id_separator.or(scan.id_separator);
+    scan.id_number = config.id_number.or(scan.id_number);
+    scan.hierarchical = config.hierarchical.unwrap_or(scan.hierarchical);
+    scan.word_boundary = config.word_boundary.unwrap_or(scan.word_boundary);
+    scan.ignore_case = config.ignore_case.unwrap_or(scan.ignore_case);
+    if let Some(id) = config.id {
+        scan.id = id;
+    }
+    if let Some(scope_kind) = config.scope_kind {
+        scan.scope_kind = scope_kind;
+    }
+    scan.limit = config.limit.or(scan.limit);
+
+    cli.apply(&mut scan);
+    if scan.slug.is_empty() {
+        return Err(TracyError::NoSlugs);
+    }
+    Ok(scan)
+}
+
+/// The scan flags passed explicitly on the command line. Profile, root and
+/// nested `tracy.toml` tables are resolved first and these are applied
+/// again on top, so a flag always wins over a config key.
+#[derive(Debug, Clone, Default)]
+pub struct CliScan {
+    /// The slugs and slug file, set together
+    slug: Option<(Vec<String>, Option<PathBuf>)>,
+    id_separator: Option<String>,
+    id_number: Option<String>,
+    hierarchical: bool,
+    word_boundary: bool,
+    ignore_case: bool,
+    id: Option<Vec<String>>,
+    scope_kind: Option<Vec<String>>,
+    limit: Option<usize>,
+}
+
+impl CliScan {
+    fn apply(&self, scan: &mut ScanArgs) {
+        if let Some((slug, slug_file)) = &self.slug {
+            scan.slug = slug.clone();
+            scan.slug_file = slug_file.clone();
+        }
+        if let Some(separator) = &self.id_separator {
+            scan.id_separator = Some(separator.clone());
+        }
+        if let Some(number) = &self.id_number {
+            scan.id_number = Some(number.clone());
+        }
+        scan.hierarchical |= self.hierarchical;
+        scan.word_boundary |= self.word_boundary;
+        scan.ignore_case |= self.ignore_case;
+        if let Some(id) = &self.id {
+            scan.id = id.clone();
+        }
+        if let Some(scope_kind) = &self.scope_kind {
+            scan.scope_kind = scope_kind.clone();
+        }
+        scan.limit = self.limit.or(scan.limit);
+    }
+}
+
+/// Read one slug per line, skipping blank lines and `#` comments.
+fn read_slug_file(path: &Path) -> Result<Vec<String>, ScanError> {
+    let content = fs::read_to_string(path).map_err(|e| ScanError::ReadFile {
+        path: path.to_path_buf(),
+        source: e,
+    })?;
+
+    Ok(content
+        .lines()
+        .map(str::trim)
+        .filter(|line| !line.is_empty() && !line.starts_with('#'))
+        .map(str::to_string)
+        .collect())
+}
+
 fn resolve_path(base_dir: &Path, path: PathBuf) -> PathBuf {
     if path.is_absolute() {
         path
@@ -0,0 +1,24 @@
+//! Internals timed directly by the benches in `benches/`.
+//!
+//! Hidden from the docs and not part of the public API: these may change
+//! or go away with the code they wrap.
+
+use crate::git::{self, BlameInfo};
+use crate::scan::rules::ContextRules;
+use ast_grep_language::SupportLang;
+use std::collections::BTreeMap;
+use std::sync::Arc;
+
+pub use crate::scan::rules::{CompiledRule, LangRules};
+
+/// See `git::parse_blame_porcelain`.
+pub fn parse_blame_porcelain(output: &str) -> BTreeMap<usize, BlameInfo> {
+    git::parse_blame_porcelain(output)
+}
+
+/// The built-in context rules compiled for `lang`.
+pub fn builtin_context_rules(lang: SupportLang) -> Arc<LangRules> {
+    ContextRules::new(&[])
+        .expect("built-in rules are valid")
+        .for_lang(lang)
+}
@@ -0,0 +1,260 @@
+//! Helpers for running tracy from a crate's `build.rs`.
+//!
+//! ```no_run
+//! // build.rs
+//! fn main() {
+//!     tracy::build::TraceBuilder::new()
+//!         .slug("REQ")
+//!         .run()
+//!         .expect("tracy scan failed");
+//! }
+//! ```
+//!
+//! ```ignore
+//! // src/lib.rs
+//! include!(concat!(env!("OUT_DIR"), "/trace.rs"));
+//! ```
+//!
+//! Only the crate's own sources are scanned, and Cargo is told to rerun the
+//! build script when one of those files or the directories they are scanned
+//! from change, so a new file is picked up too. The manifest is rewritten
+//! only when its content changes, so an unchanged scan does not trigger
+//! recompilation of the crate.
+
+use crate::filter::{FilterArgs, FilterError, collect_files};
+use crate::fsutil::write_if_changed;
+use crate::scan::{ScanArgs, ScanError, ScanResult, Scanner};
+use ast_grep_language::{Language, SupportLang};
+use std::collections::BTreeSet;
+use std::fmt::Write as _;
+use std::io::{self, Write as _};
+use std::path::{Path, PathBuf};
+use thiserror::Error;
+
+const DEFAULT_INCLUDE: &str = "src/**";
+const DEFAULT_OUT_FILE: &str = "trace.rs";
+
+#[derive(Debug, Error)]
+pub enum BuildError {
+    #[error("environment variable {0} is not set (is this running from build.rs?)")]
+    MissingEnv(&'static str),
+
+    #[error(transparent)]
+    Filter(#[from] FilterError),
+
+    #[error(transparent)]
+    Scan(#[from] ScanError),
+
+    #[error("failed to write {path}: {source}")]
+    Write { path: PathBuf, source: io::Error },
+}
+
+/// Scans a crate's sources and writes a trace manifest into `OUT_DIR`.
+#[derive(Debug, Default)]
+pub struct TraceBuilder {
+    root: Option<PathBuf>,
+    include: Vec<String>,
+    out_file: Option<String>,
+    scan: ScanArgs,
+}
+
+impl TraceBuilder {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Add a requirement prefix, e.g. `REQ`.
+    pub fn slug(mut self, slug: impl Into<String>) -> Self {
+        self.scan.slug.push(slug.into());
+        self
+    }
+
+    /// Replace all scan options, including the slugs.
+    pub fn scan_args(mut self, scan: ScanArgs) -> Self {
+        self.scan = scan;
+        self
+    }
+
+    /// Directory to scan from (default: `CARGO_MANIFEST_DIR`).
+    pub fn root(mut self, root: impl Into<PathBuf>) -> Self {
+        self.root = Some(root.into());
+        self
+    }
+
+    /// Only scan paths matching this glob, relative to the root. Repeatable;
+    /// defaults to `src/**`.
+    pub fn include(mut self, glob: impl Into<String>) -> Self {
+        self.include.push(glob.into());
+        self
+    }
+
+    /// Manifest file name inside `OUT_DIR` (default: `trace.rs`).
+    pub fn out_file(mut self, name: impl Into<String>) -> Self {
+        self.out_file = Some(name.into());
+        self
+    }
+
+    /// Scan, print the `cargo:rerun-if-changed` lines and write the manifest.
+    /// Returns the manifest path.
+    pub fn run(self) -> Result<PathBuf, BuildError> {
+        let root = match self.root {
+            Some(root) => root,
+            None => env_path("CARGO_MANIFEST_DIR")?,
+        };
+        let out_dir = env_path("OUT_DIR")?;
+
+        let include = if self.include.is_empty() {
+            vec![DEFAULT_INCLUDE.to_string()]
+        } else {
+            self.include
+        };
+        let filter = FilterArgs {
+            include: include.clone(),
+            ..Default::default()
+        };
+
+        // Only files in a supported language are ever read
+        let files: Vec<PathBuf> = collect_files(&root, &filter)?
+            .into_iter()
+            .filter(|path| SupportLang::from_path(path).is_some())
+            .collect();
+        let results = Scanner::new(&self.scan)?.scan_paths(&root, &files)?;
+
+        let mut stdout = io::stdout().lock();
+        for path in watched_dirs(&root, &include, &files).iter().chain(&files) {
+            let _ = writeln!(stdout, "cargo:rerun-if-changed={}", path.display());
+        }
+
+        let out = out_dir.join(self.out_file.as_deref().unwrap_or(DEFAULT_OUT_FILE));
+        write_if_changed(&out, render_manifest(&results).as_bytes()).map_err(|e| {
+            BuildError::Write {
+                path: out.clone(),
+                source: e,
+            }
+        })?;
+        Ok(out)
+    }
+}
+
+/// The directories to watch for new files: the literal leading directories
+/// of the include globs (`src` for `src/**`). A glob without one would mean
+/// watching the whole root, `target/` included, so the directories holding
+/// the scanned files stand in for it.
+fn watched_dirs(root: &Path, include: &[String], files: &[PathBuf]) -> BTreeSet<PathBuf> {
+    let mut dirs = BTreeSet::new();
+    for glob in include {
+        let prefix: PathBuf = Path::new(glob)
+            .components()
+            .take_while(|c| {
+                !c.as_os_str()
+                    .to_string_lossy()
+                    .contains(['*', '?', '[', '{'])
+            })
+            .collect();
+        let dir = root.join(&prefix);
+        if prefix.as_os_str().is_empty() || !dir.exists() {
+            dirs.extend(
+                files
+                    .iter()
+                    .filter_map(|file| file.parent())
+                    .map(Path::to_path_buf),
+            );
+        } else {
+            dirs.insert(dir);
+        }
+    }
+    dirs
+}
+
+fn env_path(name: &'static str) -> Result<PathBuf, BuildError> {
+    std::env::var_os(name)
+        .map(PathBuf::from)
+        .ok_or(BuildError::MissingEnv(name))
+}
+
+/// Render the scan results as Rust constants.
+fn render_manifest(results: &ScanResult) -> String {
+    let mut out = String::from("// @generated by tracy; do not edit.\n\n");
+
+    out.push_str("/// Referenced requirement ids, sorted.\n");
+    out.push_str("pub const TRACE_IDS: &[&str] = &[\n");
+    for id in results.keys() {
+        let _ = writeln!(out, "    {id:?},");
+    }
+    out.push_str("];\n\n");
+
+    out.push_str("/// Requirement references as `(id, file, line)`, sorted by id.\n");
+    out.push_str("pub const TRACE: &[(&str, &str, usize)] = &[\n");
+    for (id, entries) in results {
+        for entry in entries {
+            let file = entry.file.to_string_lossy().replace('\\', "/");
+            let _ = writeln!(out, "    ({id:?}, {file:?}, {}),", entry.line);
+        }
+    }
+    out.push_str("];\n");
+
+    out
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::scan::Entry;
+    use std::collections::BTreeMap;
+
+    fn entry(file: &str, line: usize) -> Entry {
+        Entry {
+            file: PathBuf::from(file),
+            line,
+            comment_text: String::new(),
+            above: None,
+            below: None,
+            inline: None,
+            scope: Vec::new(),
+            variants: None,
+            blame: None,
+        }
+    }
+
+    #[test]
+    fn watches_the_literal_directories_of_the_globs() {
+        let dir = tempfile::TempDir::new().unwrap();
+        let root = dir.path();
+        std::fs::create_dir_all(root.join("src/bin")).unwrap();
+        std::fs::create_dir_all(root.join("tests")).unwrap();
+        let files = vec![root.join("src/lib.rs"), root.join("tests/it.rs")];
+
+        let watched = |include: &[&str]| {
+            let include: Vec<String> = include.iter().map(|s| s.to_string()).collect();
+            watched_dirs(root, &include, &files)
+                .into_iter()
+                .collect::<Vec<_>>()
+        };
+        assert_eq!(watched(&["src/**"]), vec![root.join("src")]);
+        assert_eq!(watched(&["src/bin/*.rs"]), vec![root.join("src/bin")]);
+        // No literal prefix, or one that does not exist yet
+        assert_eq!(
+            watched(&["**/*.rs", "benches/**"]),
+            vec![root.join("src"), root.join("tests")]
+        );
+    }
+
+    #[test]
+    fn renders_ids_and_references() {
+        let mut results: ScanResult = BTreeMap::new();
+        results.insert(
+            "REQ-1".to_string(),
+            vec![entry("src/lib.rs", 3), entry("src/a \"b\".rs", 9)],
+        );
+        results.insert("REQ-2".to_string(), vec![entry("src/lib.rs", 7)]);
+
+        let manifest = render_manifest(&results);
+        assert!(
+            manifest
+                .contains("pub const TRACE_IDS: &[&str] = &[\n    \"REQ-1\",\n    \"REQ-2\",\n];")
+        );
+        assert!(manifest.contains("    (\"REQ-1\", \"src/lib.rs\", 3),\n"));
+        assert!(manifest.contains("    (\"REQ-1\", \"src/a \\\"b\\\".rs\", 9),\n"));
+        assert!(manifest.contains("    (\"REQ-2\", \"src/lib.rs\", 7),\n];"));
+    }
+}
@@ -0,0 +1,496 @@
+//! Requirement catalog loading and coverage checks.
+//!
+//! Catalogs are parsed as streams, so exports far larger than memory-friendly
+//! sizes only cost the id set itself:
+//!
+//! - CSV: the `id` column (case-insensitive header) or the first column
+//! - JSON: an array of ids, an array of objects with an `id` field, or an
+//!   object keyed by id
+//! - ReqIF: every `THE-VALUE` attribute whose whole value is a requirement id
+
+use crate::scan::{ScanArgs, ScanError, ScanResult, SlugSpelling, compile_pattern};
+use regex::Regex;
+use serde::Serialize;
+use serde::de::{self, DeserializeSeed, Deserializer, IgnoredAny, MapAccess, SeqAccess, Visitor};
+use std::collections::HashSet;
+use std::fmt;
+use std::fs::File;
+use std::io::{BufRead, BufReader, Read};
+use std::path::{Path, PathBuf};
+use thiserror::Error;
+
+/// Read size for streaming formats without line structure.
+const CHUNK_SIZE: usize = 256 * 1024;
+
+const REQIF_VALUE: &[u8] = b"THE-VALUE=\"";
+
+#[derive(Debug, Error)]
+pub enum CatalogError {
+    #[error("failed to read catalog {path}: {source}")]
+    Read {
+        path: PathBuf,
+        source: std::io::Error,
+    },
+
+    #[error("failed to parse catalog {path}: {message}")]
+    Parse { path: PathBuf, message: String },
+
+    #[error("unknown catalog format for {0} (expected .csv, .json or .reqif)")]
+    UnknownFormat(PathBuf),
+
+    #[error(transparent)]
+    Pattern(#[from] ScanError),
+}
+
+/// The set of requirement ids defined by a catalog.
+#[derive(Debug, Default)]
+pub struct Catalog {
+    ids: HashSet<Box<str>>,
+}
+
+impl Catalog {
+    pub fn len(&self) -> usize {
+        self.ids.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.ids.is_empty()
+    }
+
+    pub fn contains(&self, id: &str) -> bool {
+        self.ids.contains(id)
+    }
+
+    /// Spell every id's slug as configured, to compare with `ignore_case`
+    /// results.
+    fn respell(self, spelling: &SlugSpelling) -> Self {
+        Self {
+            ids: self
+                .ids
+                .into_iter()
+                .map(|id| spelling.canonical(&id).into())
+                .collect(),
+        }
+    }
+
+    fn insert(&mut self, id: &str) {
+        let id = id.trim();
+        if !id.is_empty() && !self.ids.contains(id) {
+            self.ids.insert(id.into());
+        }
+    }
+}
+
+/// Catalog coverage of a scan.
+#[derive(Debug, Clone, PartialEq, Eq, Serialize)]
+pub struct Coverage {
+    /// Number of ids in the catalog
+    pub catalog_size: usize,
+    /// Number of catalog ids referenced at least once
+    pub referenced: usize,
+    /// Ids found in code that are not in the catalog
+    pub unknown: Vec<String>,
+    /// Catalog ids with no reference in code
+    pub unreferenced: Vec<String>,
+}
+
+impl Coverage {
+    /// Compare the ids of a scan against a catalog.
+    ///
+    /// Only the distinct ids of the merged result are visited; entries are
+    /// never revisited.
+    pub fn compute(catalog: &Catalog, results: &ScanResult) -> Self {
+        let unknown: Vec<String> = results
+            .keys()
+            .filter(|id| !catalog.contains(id))
+            .cloned()
+            .collect();
+
+        let mut unreferenced: Vec<String> = catalog
+            .ids
+            .iter()
+            .filter(|id| !results.contains_key(&***id))
+            .map(|id| id.to_string())
+            .collect();
+        unreferenced.sort_unstable();
+
+        Self {
+            catalog_size: catalog.len(),
+            referenced: catalog.len() - unreferenced.len(),
+            unknown,
+            unreferenced,
+        }
+    }
+}
+
+/// Stream-parse the catalog at `path`, choosing the format by extension.
+pub fn load_catalog(path: &Path, scan: &ScanArgs) -> Result<Catalog, CatalogError> {
+    let extension = path
+        .extension()
+        .and_then(|e| e.to_str())
+        .map(str::to_ascii_lowercase);
+
+    let file = File::open(path).map_err(|e| CatalogError::Read {
+        path: path.to_path_buf(),
+        source: e,
+    })?;
+    let reader = BufReader::with_capacity(CHUNK_SIZE, file);
+
+    let catalog = match extension.as_deref() {
+        Some("csv") => parse_csv(reader, path),
+        Some("json") => parse_json(reader, path),
+        Some("reqif" | "xml") => parse_reqif(reader, path, &compile_pattern(scan)?),
+        _ => Err(CatalogError::UnknownFormat(path.to_path_buf())),
+    }?;
+    if scan.ignore_case {
+        return Ok(catalog.respell(&SlugSpelling::new(scan)));
+    }
+    Ok(catalog)
+}
+
+fn parse_csv(reader: impl BufRead, path: &Path) -> Result<Catalog, CatalogError> {
+    let mut catalog = Catalog::default();
+    let mut column = None;
+    let mut record = String::new();
+
+    for line in reader.lines() {
+        let line = line.map_err(|e| CatalogError::Read {
+            path: path.to_path_buf(),
+            source: e,
+        })?;
+        record.push_str(&line);
+        // An odd number of quotes means a quoted field runs onto the next line
+        if record.matches('"').count() % 2 == 1 {
+            record.push('\n');
+            continue;
+        }
+        let record = std::mem::take(&mut record);
+        if record.trim().is_empty() {
+            continue;
+        }
+        let fields = split_csv_record(&record);
+
+        let index = match column {
+            Some(index) => index,
+            None => {
+                // The first row is a header if it names an `id` column
+                let header = fields.iter().position(|f| f.eq_ignore_ascii_case("id"));
+                column = Some(header.unwrap_or(0));
+                if header.is_some() {
+                    continue;
+                }
+                0
+            }
+        };
+
+        if let Some(id) = fields.get(index) {
+            catalog.insert(id);
+        }
+    }
+
+    if !record.is_empty() {
+        return Err(CatalogError::Parse {
+            path: path.to_path_buf(),
+            message: "unterminated quoted field".to_string(),
+        });
+    }
+    Ok(catalog)
+}
+
+/// Split one CSV record, honouring double-quoted fields, which may contain
+/// line breaks.
+fn split_csv_record(record: &str) -> Vec<String> {
+    let mut fields = Vec::new();
+    let mut field = String::new();
+    let mut quoted = false;
+    let mut chars = record.chars().peekable();
+
+    while let Some(c) = chars.next() {
+        match c {
+            '"' if quoted && chars.peek() == Some(&'"') => {
+                field.push('"');
+                chars.next();
+            }
+            '"' => quoted = !quoted,
+            ',' if !quoted => fields.push(std::mem::take(&mut field)),
+            _ => field.push(c),
+        }
+    }
+    fields.push(field);
+    fields
+}
+
+fn parse_json(reader: impl Read, path: &Path) -> Result<Catalog, CatalogError> {
+    let mut catalog = Catalog::default();
+    let mut deserializer = serde_json::Deserializer::from_reader(reader);
+    IdSink(&mut catalog)
+        .deserialize(&mut deserializer)
+        .and_then(|()| deserializer.end())
+        .map_err(|e| CatalogError::Parse {
+            path: path.to_path_buf(),
+            message: e.to_string(),
+        })?;
+    Ok(catalog)
+}
+
+/// Deserializes ids straight into the catalog without building a document.
+struct IdSink<'a>(&'a mut Catalog);
+
+impl<'de> DeserializeSeed<'de> for IdSink<'_> {
+    type Value = ();
+
+    fn deserialize<D: Deserializer<'de>>(self, deserializer: D) -> Result<(), D::Error> {
+        deserializer.deserialize_any(self)
+    }
+}
+
+impl<'de> Visitor<'de> for IdSink<'_> {
+    type Value = ();
+
+    fn expecting(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.write_str("an array of ids, an array of objects with an `id`, or an object keyed by id")
+    }
+
+    fn visit_seq<A: SeqAccess<'de>>(self, mut seq: A) -> Result<(), A::Error> {
+        while let Some(item) = seq.next_element::<CatalogItem>()? {
+            self.0.insert(&item.0);
+        }
+        Ok(())
+    }
+
+    fn visit_map<A: MapAccess<'de>>(self, mut map: A) -> Result<(), A::Error> {
+        while let Some(id) = map.next_key::<String>()? {
+            map.next_value::<IgnoredAny>()?;
+            self.0.insert(&id);
+        }
+        Ok(())
+    }
+}
+
+/// One array element: either an id string or an object with an `id` field.
+struct CatalogItem(String);
+
+impl<'de> de::Deserialize<'de> for CatalogItem {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> Result<Self, D::Error> {
+        struct ItemVisitor;
+
+        impl<'de> Visitor<'de> for ItemVisitor {
+            type Value = CatalogItem;
+
+            fn expecting(&self, f: &mut fmt::Formatter) -> fmt::Result {
+                f.write_str("an id string or an object with an `id` field")
+            }
+
+            fn visit_str<E: de::Error>(self, v: &str) -> Result<CatalogItem, E> {
+                Ok(CatalogItem(v.to_string()))
+            }
+
+            fn visit_map<A: MapAccess<'de>>(self, mut map: A) -> Result<CatalogItem, A::Error> {
+                let mut id = None;
+                while let Some(key) = map.next_key::<String>()? {
+                    if key == "id" {
+                        id = Some(map.next_value::<String>()?);
+                    } else {
+                        map.next_value::<IgnoredAny>()?;
+                    }
+                }
+                id.map(CatalogItem)
+                    .ok_or_else(|| de::Error::missing_field("id"))
+            }
+        }
+
+        deserializer.deserialize_any(ItemVisitor)
+    }
+}
+
+fn parse_reqif(
+    mut reader: impl Read,
+    path: &Path,
+    pattern: &Regex,
+) -> Result<Catalog, CatalogError> {
+    let mut catalog = Catalog::default();
+    let mut buf: Vec<u8> = Vec::with_capacity(2 * CHUNK_SIZE);
+    let mut chunk = vec![0u8; CHUNK_SIZE];
+
+    loop {
+        let read = reader.read(&mut chunk).map_err(|e| CatalogError::Read {
+            path: path.to_path_buf(),
+            source: e,
+        })?;
+        buf.extend_from_slice(&chunk[..read]);
+
+        let consumed = scan_reqif_values(&buf, pattern, &mut catalog, read == 0);
+        buf.drain(..consumed);
+
+        if read == 0 {
+            return Ok(catalog);
+        }
+    }
+}
+
+/// Collect ids from complete `THE-VALUE="..."` attributes in `buf`.
+///
+/// Returns how many bytes can be dropped; an attribute cut off by the chunk
+/// boundary is kept for the next call.
+fn scan_reqif_values(buf: &[u8], pattern: &Regex, catalog: &mut Catalog, eof: bool) -> usize {
+    let mut pos = 0;
+
+    while let Some(start) = find(buf, pos, REQIF_VALUE) {
+        let value_start = start + REQIF_VALUE.len();
+        let Some(len) = buf[value_start..].iter().position(|&b| b == b'"') else {
+            return if eof { buf.len() } else { start };
+        };
+
+        if let Ok(value) = std::str::from_utf8(&buf[value_start..value_start + len]) {
+            let value = value.trim();
+            if pattern
+                .find(value)
+                .is_some_and(|m| m.start() == 0 && m.end() == value.len())
+            {
+                catalog.insert(value);
+            }
+        }
+        pos = value_start + len + 1;
+    }
+
+    // Keep enough of the tail to complete a marker split across chunks
+    if eof {
+        buf.len()
+    } else {
+        pos.max(buf.len().saturating_sub(REQIF_VALUE.len() - 1))
+    }
+}
+
+fn find(haystack: &[u8], start: usize, needle: &[u8]) -> Option<usize> {
+    haystack
+        .get(start..)?
+        .windows(needle.len())
+        .position(|w| w == needle)
+        .map(|p| start + p)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::scan::Entry;
+    use std::collections::BTreeMap;
+    use std::io::Cursor;
+
+    fn ids(catalog: &Catalog) -> Vec<String> {
+        let mut ids: Vec<String> = catalog.ids.iter().map(|id| id.to_string()).collect();
+        ids.sort();
+        ids
+    }
+
+    fn req_pattern() -> Regex {
+        compile_pattern(&ScanArgs {
+            slug: vec!["REQ".to_string()],
+            ..Default::default()
+        })
+        .unwrap()
+    }
+
+    #[test]
+    fn csv_uses_id_column_from_header() {
+        let csv = "title,ID,status\n\"Input, validated\",REQ-1,ok\nOutput,REQ-2,draft\n";
+        let catalog = parse_csv(Cursor::new(csv), Path::new("c.csv")).unwrap();
+        assert_eq!(ids(&catalog), vec!["REQ-1", "REQ-2"]);
+    }
+
+    #[test]
+    fn csv_quoted_fields_may_span_lines() {
+        let csv = "title,id\n\"Input\nvalidated, \"\"strictly\"\"\",REQ-1\nOutput,REQ-2\n";
+        let catalog = parse_csv(Cursor::new(csv), Path::new("c.csv")).unwrap();
+        assert_eq!(ids(&catalog), vec!["REQ-1", "REQ-2"]);
+
+        let err = parse_csv(Cursor::new("id\n\"REQ-1\n"), Path::new("c.csv"));
+        assert!(matches!(err, Err(CatalogError::Parse { .. })));
+    }
+
+    #[test]
+    fn csv_without_header_uses_first_column() {
+        let csv = "REQ-1,first\nREQ-2,second\n\n";
+        let catalog = parse_csv(Cursor::new(csv), Path::new("c.csv")).unwrap();
+        assert_eq!(ids(&catalog), vec!["REQ-1", "REQ-2"]);
+    }
+
+    #[test]
+    fn json_accepts_strings_objects_and_maps() {
+        for json in [
+            r#"["REQ-1", "REQ-2"]"#,
+            r#"[{"id": "REQ-1", "title": "x"}, {"title": "y", "id": "REQ-2"}]"#,
+            r#"{"REQ-1": {"title": "x"}, "REQ-2": null}"#,
+        ] {
+            let catalog = parse_json(Cursor::new(json), Path::new("c.json")).unwrap();
+            assert_eq!(ids(&catalog), vec!["REQ-1", "REQ-2"], "input: {json}");
+        }
+    }
+
+    #[test]
+    fn json_rejects_objects_without_id() {
+        let err = parse_json(Cursor::new(r#"[{"title": "x"}]"#), Path::new("c.json"));
+        assert!(matches!(err, Err(CatalogError::Parse { .. })));
+    }
+
+    #[test]
+    fn reqif_takes_whole_id_values_across_chunks() {
+        let mut xml = String::from("<REQ-IF>");
+        for i in 0..20_000 {
+            xml.push_str(&format!(
+                "<ATTRIBUTE-VALUE-STRING THE-VALUE=\"REQ-{i}\"/>\
+                 <ATTRIBUTE-VALUE-STRING THE-VALUE=\"Refines REQ-999999\"/>"
+            ));
+        }
+        xml.push_str("</REQ-IF>");
+
+        let catalog = parse_reqif(Cursor::new(xml), Path::new("c.reqif"), &req_pattern()).unwrap();
+        assert_eq!(catalog.len(), 20_000);
+        assert!(catalog.contains("REQ-0"));
+        assert!(catalog.contains("REQ-19999"));
+        assert!(!catalog.contains("REQ-999999"));
+    }
+
+    #[test]
+    fn ignore_case_catalogs_use_the_configured_spelling() {
+        let csv = "id\nreq-1\nReq-2\nLIN-3\n";
+        let catalog = parse_csv(Cursor::new(csv), Path::new("c.csv")).unwrap();
+        let spelling = SlugSpelling::new(&ScanArgs {
+            slug: vec!["REQ".to_string()],
+            ignore_case: true,
+            ..Default::default()
+        });
+        assert_eq!(
+            ids(&catalog.respell(&spelling)),
+            vec!["LIN-3", "REQ-1", "REQ-2"]
+        );
+    }
+
+    #[test]
+    fn coverage_reports_unknown_and_unreferenced() {
+        let mut catalog = Catalog::default();
+        for id in ["REQ-1", "REQ-2", "REQ-3"] {
+            catalog.insert(id);
+        }
+
+        let entry = || Entry {
+            file: PathBuf::from("src/lib.rs"),
+            line: 1,
+            comment_text: String::new(),
+            above: None,
+            below: None,
+            inline: None,
+            scope: Vec::new(),
+            variants: None,
+            blame: None,
+        };
+        let mut results: ScanResult = BTreeMap::new();
+        results.insert("REQ-1".to_string(), vec![entry()]);
+        results.insert("REQ-9".to_string(), vec![entry()]);
+
+        let coverage = Coverage::compute(&catalog, &results);
+        assert_eq!(coverage.catalog_size, 3);
+        assert_eq!(coverage.referenced, 1);
+        assert_eq!(coverage.unknown, vec!["REQ-9"]);
+        assert_eq!(coverage.unreferenced, vec!["REQ-2", "REQ-3"]);
+    }
+}
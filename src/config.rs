@@ -4,24 +4,56 @@ use std::fs;
 use std::path::{Path, PathBuf};
 use thiserror::Error;
 
+/// File name of the config, at the root and in subdirectories.
+pub const CONFIG_FILE: &str = "tracy.toml";
+
 #[derive(Debug, Default, Deserialize)]
 pub struct Config {
     pub root: Option<PathBuf>,
+    /// Several roots to scan in one run
+    pub roots: Option<Vec<PathBuf>>,
+    /// File listing more roots, one per line
+    pub roots_file: Option<PathBuf>,
     pub format: Option<OutputFormat>,
     pub output: Option<PathBuf>,
+    pub depfile: Option<PathBuf>,
+    pub stamp: Option<PathBuf>,
     pub quiet: Option<bool>,
     pub fail_on_empty: Option<bool>,
     pub include_git_meta: Option<bool>,
     pub include_blame: Option<bool>,
+    pub catalog: Option<PathBuf>,
+    pub aggregate: Option<String>,
+    /// Apply `tracy.toml` files found in subdirectories
+    pub nested_configs: Option<bool>,
     #[serde(default)]
     pub scan: ScanConfig,
     #[serde(default)]
     pub filter: FilterConfig,
+    #[serde(default)]
+    pub cache: CacheConfig,
+    #[serde(default, rename = "variant")]
+    pub variants: Vec<VariantConfig>,
+    #[serde(default, rename = "marker")]
+    pub markers: Vec<MarkerConfig>,
+    #[serde(default, rename = "context_rule")]
+    pub context_rules: Vec<ContextRuleConfig>,
+    #[serde(default, rename = "profile")]
+    pub profiles: Vec<ProfileConfig>,
 }
 
 #[derive(Debug, Default, Deserialize)]
 pub struct ScanConfig {
     pub slug: Option<Vec<String>>,
+    pub slug_file: Option<PathBuf>,
+    pub id_separator: Option<String>,
+    pub id_number: Option<String>,
+    pub hierarchical: Option<bool>,
+    pub word_boundary: Option<bool>,
+    pub ignore_case: Option<bool>,
+    pub id: Option<Vec<String>>,
+    pub scope_kind: Option<Vec<String>>,
+    pub limit: Option<usize>,
 }
 
 #[derive(Debug, Default, Deserialize)]
@@ -33,6 +65,59 @@ pub struct FilterConfig {
     pub exclude: Option<Vec<String>>,
 }
 
+#[derive(Debug, Default, Deserialize)]
+pub struct CacheConfig {
+    pub dir: Option<PathBuf>,
+    pub max_mb: Option<u64>,
+}
+
+/// A `[[variant]]` table: a named build configuration for C/C++ sources.
+#[derive(Debug, Deserialize)]
+pub struct VariantConfig {
+    pub name: String,
+    /// `NAME` or `NAME=VALUE`, applied after `compile_commands`
+    #[serde(default)]
+    pub defines: Vec<String>,
+    /// Take the defines shared by every entry of this compilation database
+    pub compile_commands: Option<PathBuf>,
+}
+
+/// A `[[marker]]` table: an ast-grep pattern scanned for ids besides comments.
+#[derive(Debug, Deserialize)]
+pub struct MarkerConfig {
+    pub language: String,
+    pub pattern: String,
+}
+
+/// A `[[profile]]` table: scan settings for some paths, with their own output.
+/// Unset scan keys fall back to `[scan]`.
+#[derive(Debug, Deserialize)]
+pub struct ProfileConfig {
+    pub name: String,
+    pub format: Option<OutputFormat>,
+    pub output: Option<PathBuf>,
+    #[serde(default)]
+    pub include: Vec<String>,
+    #[serde(default)]
+    pub exclude: Vec<String>,
+    #[serde(flatten)]
+    pub scan: ScanConfig,
+}
+
+/// A `[[context_rule]]` table: a node kind reported as context and/or scope.
+#[derive(Debug, Deserialize)]
+pub struct ContextRuleConfig {
+    /// Languages the rule applies to; all languages when omitted
+    #[serde(default)]
+    pub languages: Vec<String>,
+    pub kind: String,
+    pub context: Option<bool>,
+    pub scope: Option<bool>,
+    pub priority: Option<i32>,
+    /// Name path, e.g. `name` or `declarator.name|@identifier`
+    pub name: Option<String>,
+}
+
 #[derive(Debug, Error)]
 pub enum ConfigError {
     #[error("failed to read config file {path}: {source}")]
@@ -67,7 +152,7 @@ pub fn find_config(start: &Path) -> Option<PathBuf> {
     };
 
     loop {
-        let candidate = dir.join("tracy.toml");
+        let candidate = dir.join(CONFIG_FILE);
         if candidate.is_file() {
             return Some(candidate);
         }
@@ -119,4 +204,31 @@ include = ["src/**"]
             Some(&["src/**".to_string()][..])
         );
     }
+
+    #[test]
+    fn parses_profiles_with_scan_keys() {
+        let config: Config = toml::from_str(
+            r#"
+[[profile]]
+name = "safety"
+include = ["safety/**"]
+output = "haz.json"
+slug = ["HAZ"]
+word_boundary = true
+
+[[profile]]
+name = "tests"
+format = "csv"
+"#,
+        )
+        .unwrap();
+
+        assert_eq!(config.profiles.len(), 2);
+        let safety = &config.profiles[0];
+        assert_eq!(safety.include, ["safety/**"]);
+        assert_eq!(safety.scan.slug.as_deref(), Some(&["HAZ".to_string()][..]));
+        assert_eq!(safety.scan.word_boundary, Some(true));
+        assert_eq!(config.profiles[1].format, Some(OutputFormat::Csv));
+        assert!(config.profiles[1].scan.slug.is_none());
+    }
 }
@@ -0,0 +1,56 @@
+//! Make/Ninja dependency files (`--depfile`).
+//!
+//! A depfile names the output and every input it was built from, so a build
+//! system can skip rerunning tracy when none of the inputs changed.
+
+use std::path::{Path, PathBuf};
+
+/// Render a Make-style depfile: `target: dep dep ...`.
+pub fn render_depfile(target: &Path, deps: &[PathBuf]) -> String {
+    let mut out = escape(target);
+    out.push(':');
+    for dep in deps {
+        out.push_str(" \\\n  ");
+        out.push_str(&escape(dep));
+    }
+    out.push('\n');
+    out
+}
+
+/// Escape the characters Make and Ninja treat specially in depfile paths.
+fn escape(path: &Path) -> String {
+    let path = path.to_string_lossy();
+    let mut out = String::with_capacity(path.len());
+    for c in path.chars() {
+        match c {
+            ' ' => out.push_str("\\ "),
+            '#' => out.push_str("\\#"),
+            '$' => out.push_str("$$"),
+            _ => out.push(c),
+        }
+    }
+    out
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn renders_escaped_target_and_deps() {
+        let deps = vec![
+            PathBuf::from("/repo/src/main.c"),
+            PathBuf::from("/repo/my dir/a#1.c"),
+            PathBuf::from("/repo/$x.h"),
+        ];
+        assert_eq!(
+            render_depfile(Path::new("build/trace.json"), &deps),
+            "build/trace.json: \\\n  /repo/src/main.c \\\n  /repo/my\\ dir/a\\#1.c \\\n  /repo/$$x.h\n"
+        );
+    }
+
+    #[test]
+    fn no_deps_is_a_bare_target() {
+        assert_eq!(render_depfile(Path::new("out.json"), &[]), "out.json:\n");
+    }
+}
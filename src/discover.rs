@@ -0,0 +1,364 @@
+//! Slug auto-discovery.
+//!
+//! Finds `XXX-123`-style prefixes used in comments without knowing the slugs
+//! up front. Instead of a tree-sitter parse, comments are pulled out with a
+//! small per-language lexer, and each worker counts prefixes into its own
+//! table; the tables are merged once at the end.
+
+use crate::filter::FilterArgs;
+use crate::pool;
+use crate::scan::ScanError;
+use ast_grep_language::{Language, SupportLang};
+use clap::Args;
+use regex::Regex;
+use serde::Serialize;
+use std::collections::{HashMap, HashSet};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+
+/// Generic requirement id shape: an upper-case prefix, a hyphen and a number.
+const GENERIC_ID_PATTERN: &str = r"\b([A-Z][A-Z0-9_]+)-\d+";
+
+#[derive(Debug, Args)]
+pub struct DiscoverArgs {
+    #[arg(long, help = "Root directory to scan (default: '.')")]
+    pub root: Option<PathBuf>,
+
+    #[arg(
+        long,
+        value_name = "N",
+        help = "Only report the N highest-ranked prefixes"
+    )]
+    pub top: Option<usize>,
+
+    #[arg(
+        long,
+        value_name = "N",
+        default_value_t = 1,
+        help = "Only report prefixes used in at least N files"
+    )]
+    pub min_files: usize,
+
+    #[command(flatten)]
+    pub filter: FilterArgs,
+}
+
+/// A prefix found in comments, with its usage counts.
+#[derive(Debug, Clone, PartialEq, Eq, Serialize)]
+pub struct DiscoveredSlug {
+    /// The prefix, e.g. `REQ` for `REQ-123`
+    pub slug: String,
+    /// Total number of ids with this prefix
+    pub count: usize,
+    /// Number of files containing at least one id with this prefix
+    pub files: usize,
+}
+
+#[derive(Debug, Default)]
+struct Counter {
+    count: usize,
+    files: usize,
+}
+
+/// Count id prefixes found in comments across `paths`.
+///
+/// Results are ranked by file spread, then by total count, so prefixes used
+/// throughout a codebase rank above incidental matches like `UTF-8`.
+pub fn discover_slugs(paths: &[PathBuf]) -> Result<Vec<DiscoveredSlug>, ScanError> {
+    let pattern = Regex::new(GENERIC_ID_PATTERN)?;
+    let stop = AtomicBool::new(false);
+
+    let per_worker = pool::for_each_index(
+        paths.len(),
+        &stop,
+        || (HashMap::<String, Counter>::new(), None),
+        |(counters, error), index| {
+            if error.is_some() {
+                return;
+            }
+            if let Err(e) = count_file(&paths[index], &pattern, counters) {
+                *error = Some(e);
+                // The run fails anyway; spare the other workers the rest
+                stop.store(true, Ordering::Relaxed);
+            }
+        },
+    );
+
+    let mut merged: HashMap<String, Counter> = HashMap::new();
+    for (counters, error) in per_worker {
+        if let Some(e) = error {
+            return Err(e);
+        }
+        for (slug, counter) in counters {
+            let total = merged.entry(slug).or_default();
+            total.count += counter.count;
+            total.files += counter.files;
+        }
+    }
+
+    let mut ranked: Vec<DiscoveredSlug> = merged
+        .into_iter()
+        .map(|(slug, c)| DiscoveredSlug {
+            slug,
+            count: c.count,
+            files: c.files,
+        })
+        .collect();
+    ranked.sort_by(|a, b| {
+        b.files
+            .cmp(&a.files)
+            .then(b.count.cmp(&a.count))
+            .then(a.slug.cmp(&b.slug))
+    });
+    Ok(ranked)
+}
+
+fn count_file(
+    path: &Path,
+    pattern: &Regex,
+    counters: &mut HashMap<String, Counter>,
+) -> Result<(), ScanError> {
+    let Some(syntax) = SupportLang::from_path(path).and_then(comment_syntax) else {
+        return Ok(());
+    };
+
+    let bytes = fs::read(path).map_err(|e| ScanError::ReadFile {
+        path: path.to_path_buf(),
+        source: e,
+    })?;
+    let Ok(source) = std::str::from_utf8(&bytes) else {
+        return Ok(());
+    };
+
+    // Most files contain no id-shaped token at all; skip lexing them
+    if !pattern.is_match(source) {
+        return Ok(());
+    }
+
+    count_source(source, syntax, pattern, counters);
+    Ok(())
+}
+
+fn count_source(
+    source: &str,
+    syntax: CommentSyntax,
+    pattern: &Regex,
+    counters: &mut HashMap<String, Counter>,
+) {
+    let mut in_file: HashSet<&str> = HashSet::new();
+    for_each_comment(source, syntax, |comment| {
+        for caps in pattern.captures_iter(comment) {
+            let Some(prefix) = caps.get(1) else {
+                continue;
+            };
+            let prefix = prefix.as_str();
+            if !counters.contains_key(prefix) {
+                counters.insert(prefix.to_string(), Counter::default());
+            }
+            let counter = counters.get_mut(prefix).expect("inserted above");
+            counter.count += 1;
+            if in_file.insert(prefix) {
+                counter.files += 1;
+            }
+        }
+    });
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum CommentSyntax {
+    /// `//` line and `/* */` block comments
+    CLike,
+    /// `/* */` block comments only
+    Block,
+    /// `#` line comments
+    Hash,
+    /// `#` line comments, with `"""`/`'''` strings that may span lines
+    Python,
+    /// `--` line comments
+    DoubleDash,
+}
+
+fn comment_syntax(lang: SupportLang) -> Option<CommentSyntax> {
+    match lang {
+        SupportLang::C
+        | SupportLang::Cpp
+        | SupportLang::CSharp
+        | SupportLang::Go
+        | SupportLang::Java
+        | SupportLang::JavaScript
+        | SupportLang::Kotlin
+        | SupportLang::Php
+        | SupportLang::Rust
+        | SupportLang::Scala
+        | SupportLang::Swift
+        | SupportLang::Tsx
+        | SupportLang::TypeScript => Some(CommentSyntax::CLike),
+        SupportLang::Css => Some(CommentSyntax::Block),
+        SupportLang::Bash | SupportLang::Elixir | SupportLang::Ruby => Some(CommentSyntax::Hash),
+        SupportLang::Python => Some(CommentSyntax::Python),
+        SupportLang::Haskell | SupportLang::Lua => Some(CommentSyntax::DoubleDash),
+        _ => None,
+    }
+}
+
+/// Call `f` with the text of every comment in `source`.
+///
+/// This is a deliberately small lexer: it skips string literals (single-line
+/// ones, and Python's triple-quoted ones) so that comment markers inside
+/// strings are not mistaken for comments, but does not model raw strings or
+/// nested block comments.
+fn for_each_comment<'s>(source: &'s str, syntax: CommentSyntax, mut f: impl FnMut(&'s str)) {
+    let bytes = source.as_bytes();
+    let mut i = 0;
+
+    while i < bytes.len() {
+        let next = bytes.get(i + 1).copied();
+        match (syntax, bytes[i]) {
+            (CommentSyntax::Python, quote @ (b'"' | b'\''))
+                if bytes[i..].starts_with(&[quote; 3]) =>
+            {
+                i = find(bytes, i + 3, &[quote; 3]).map_or(bytes.len(), |e| e + 3);
+            }
+            (_, b'"')
+            | (CommentSyntax::Block | CommentSyntax::Hash | CommentSyntax::Python, b'\'') => {
+                i = skip_string(bytes, i);
+            }
+            (CommentSyntax::CLike, b'\'') => {
+                i = skip_char_literal(bytes, i);
+            }
+            (CommentSyntax::CLike, b'/') if next == Some(b'/') => {
+                let end = line_end(bytes, i);
+                f(&source[i..end]);
+                i = end;
+            }
+            (CommentSyntax::CLike | CommentSyntax::Block, b'/') if next == Some(b'*') => {
+                let end = find(bytes, i + 2, b"*/").map_or(bytes.len(), |e| e + 2);
+                f(&source[i..end]);
+                i = end;
+            }
+            (CommentSyntax::Hash | CommentSyntax::Python, b'#') => {
+                let end = line_end(bytes, i);
+                f(&source[i..end]);
+                i = end;
+            }
+            (CommentSyntax::DoubleDash, b'-') if next == Some(b'-') => {
+                let end = line_end(bytes, i);
+                f(&source[i..end]);
+                i = end;
+            }
+            _ => i += 1,
+        }
+    }
+}
+
+/// Skip a quoted string starting at `start`, stopping at the end of the line
+/// so that an unmatched quote cannot swallow the rest of the file.
+fn skip_string(bytes: &[u8], start: usize) -> usize {
+    let quote = bytes[start];
+    let mut i = start + 1;
+    while i < bytes.len() {
+        match bytes[i] {
+            b'\\' => i += 2,
+            b'\n' => return i,
+            c if c == quote => return i + 1,
+            _ => i += 1,
+        }
+    }
+    bytes.len()
+}
+
+/// Skip a C-style character literal such as `'"'` or `'\''`; a lone quote
+/// (a Rust lifetime, for example) is skipped on its own.
+fn skip_char_literal(bytes: &[u8], start: usize) -> usize {
+    match bytes.get(start + 1) {
+        Some(b'\\') if bytes.get(start + 3) == Some(&b'\'') => start + 4,
+        Some(_) if bytes.get(start + 2) == Some(&b'\'') => start + 3,
+        _ => start + 1,
+    }
+}
+
+fn line_end(bytes: &[u8], start: usize) -> usize {
+    bytes[start..]
+        .iter()
+        .position(|&b| b == b'\n')
+        .map_or(bytes.len(), |p| start + p)
+}
+
+fn find(bytes: &[u8], start: usize, needle: &[u8]) -> Option<usize> {
+    bytes
+        .get(start..)?
+        .windows(needle.len())
+        .position(|w| w == needle)
+        .map(|p| start + p)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn comments(source: &str, syntax: CommentSyntax) -> Vec<&str> {
+        let mut out = Vec::new();
+        for_each_comment(source, syntax, |c| out.push(c));
+        out
+    }
+
+    #[test]
+    fn lexes_c_like_comments() {
+        let source = "int x = 1; // REQ-1\n/* REQ-2\n REQ-3 */ int y;\n";
+        assert_eq!(
+            comments(source, CommentSyntax::CLike),
+            vec!["// REQ-1", "/* REQ-2\n REQ-3 */"]
+        );
+    }
+
+    #[test]
+    fn ignores_markers_inside_strings() {
+        let source = "let url = \"http://x/REQ-1\"; let q = '\"'; // REQ-2\n";
+        assert_eq!(comments(source, CommentSyntax::CLike), vec!["// REQ-2"]);
+
+        let source = "s = '# REQ-1'  # REQ-2\n";
+        assert_eq!(comments(source, CommentSyntax::Hash), vec!["# REQ-2"]);
+    }
+
+    #[test]
+    fn skips_python_triple_quoted_strings() {
+        let source = "\"\"\"Docs\n# REQ-1 in a docstring\n\"\"\"\nx = '''# REQ-2'''  # REQ-3\n";
+        assert_eq!(comments(source, CommentSyntax::Python), vec!["# REQ-3"]);
+    }
+
+    #[test]
+    fn css_has_only_block_comments() {
+        let source = "a { background: url(//cdn/REQ-1.png); } /* REQ-2 */\n";
+        assert_eq!(comments(source, CommentSyntax::Block), vec!["/* REQ-2 */"]);
+        assert_eq!(comment_syntax(SupportLang::Css), Some(CommentSyntax::Block));
+    }
+
+    #[test]
+    fn lexes_double_dash_comments() {
+        let source = "local x = a - b -- REQ-1\n";
+        assert_eq!(
+            comments(source, CommentSyntax::DoubleDash),
+            vec!["-- REQ-1"]
+        );
+    }
+
+    #[test]
+    fn counts_prefixes_and_file_spread() {
+        let pattern = Regex::new(GENERIC_ID_PATTERN).unwrap();
+        let mut counters = HashMap::new();
+        count_source(
+            "// REQ-1 REQ-2 LIN-7\nfn x() {} // see MYREQ-3\nlet s = \"TODO-1\";",
+            CommentSyntax::CLike,
+            &pattern,
+            &mut counters,
+        );
+        count_source("// REQ-3\n", CommentSyntax::CLike, &pattern, &mut counters);
+
+        assert_eq!(counters["REQ"].count, 3);
+        assert_eq!(counters["REQ"].files, 2);
+        assert_eq!(counters["LIN"].count, 1);
+        assert_eq!(counters["MYREQ"].count, 1);
+        assert!(!counters.contains_key("TODO"));
+    }
+}
@@ -1,9 +1,17 @@
 use thiserror::Error;
 
+use crate::aggregate::AggregateError;
+use crate::archive::ArchiveError;
+use crate::catalog::CatalogError;
 use crate::config::ConfigError;
 use crate::filter::FilterError;
 use crate::git::GitError;
+use crate::html::HtmlError;
+use crate::output::OutputError;
+use crate::profile::ProfileError;
+use crate::roots::RootsError;
 use crate::scan::ScanError;
+use crate::trace::TraceError;
 
 #[derive(Debug, Error)]
 pub enum TracyError {
@@ -19,12 +27,60 @@ pub enum TracyError {
     #[error(transparent)]
     Config(#[from] ConfigError),
 
+    #[error(transparent)]
+    Catalog(#[from] CatalogError),
+
+    #[error(transparent)]
+    Aggregate(#[from] AggregateError),
+
+    #[error(transparent)]
+    Html(#[from] HtmlError),
+
+    #[error(transparent)]
+    Profile(#[from] ProfileError),
+
+    #[error(transparent)]
+    Roots(#[from] RootsError),
+
+    #[error(transparent)]
+    Archive(#[from] ArchiveError),
+
+    #[error(transparent)]
+    Trace(#[from] TraceError),
+
+    #[error(transparent)]
+    Output(#[from] OutputError),
+
     #[error("failed to serialize output: {0}")]
     Serialize(#[from] serde_json::Error),
 
     #[error("failed to write output file: {0}")]
     WriteOutput(#[from] std::io::Error),
 
+    #[error("--format html writes a report directory; pass it with --output")]
+    HtmlNeedsOutput,
+
+    #[error("--depfile names the output it describes; pass it with --output")]
+    DepfileNeedsOutput,
+
+    #[error("{0} cannot be combined with [[profile]] tables; each profile has its own output")]
+    ProfileConflict(&'static str),
+
+    #[error("{0} cannot be combined with multiple roots; each root has its own report")]
+    RootConflict(&'static str),
+
+    #[error("{0} cannot be combined with --catalog; coverage needs every match")]
+    CatalogConflict(&'static str),
+
+    #[error("{0} cannot be used when scanning an archive")]
+    ArchiveConflict(&'static str),
+
+    #[error("{0} cannot be combined with --aggregate; it outputs counts, not matches")]
+    AggregateConflict(&'static str),
+
+    #[error("unknown profile {0:?}")]
+    UnknownProfile(String),
+
     #[error("no matches found")]
     NoResults,
 
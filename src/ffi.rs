@@ -0,0 +1,387 @@
+//! C ABI for in-process use from C and C++ (see `include/tracy.h`).
+//!
+//! Results are handed out as borrowed `tracy_entry` structs that point into a
+//! `tracy_hits` allocation; they stay valid until `tracy_hits_free`. Errors
+//! are reported by a NULL return and a thread-local message from
+//! `tracy_last_error`. No function unwinds across the boundary.
+
+use crate::scan::{FileHits, ScanArgs, Scanner, Source};
+use ast_grep_language::SupportLang;
+use std::cell::RefCell;
+use std::ffi::{CStr, CString, c_char, c_int};
+use std::panic::{AssertUnwindSafe, catch_unwind};
+use std::path::Path;
+use std::ptr;
+
+/// Scanner options; mirrors `struct tracy_options`.
+#[repr(C)]
+pub struct TracyOptions {
+    pub slugs: *const *const c_char,
+    pub slug_count: usize,
+    pub id_separator: *const c_char,
+    pub id_number: *const c_char,
+    pub hierarchical: c_int,
+    pub word_boundary: c_int,
+    pub ignore_case: c_int,
+}
+
+/// One hit; mirrors `struct tracy_entry`. Strings are NUL-terminated UTF-8.
+#[repr(C)]
+pub struct TracyEntry {
+    pub id: *const c_char,
+    pub file: *const c_char,
+    pub line: usize,
+    pub comment_text: *const c_char,
+    /// Innermost enclosing scope, or NULL at file level
+    pub scope_kind: *const c_char,
+    pub scope_name: *const c_char,
+}
+
+/// Opaque scanner handle.
+pub struct TracyScanner(Scanner);
+
+/// Opaque result set owning the strings its entries point into.
+pub struct TracyHits {
+    entries: Vec<TracyEntry>,
+    _strings: Vec<CString>,
+}
+
+thread_local! {
+    static LAST_ERROR: RefCell<Option<CString>> = const { RefCell::new(None) };
+}
+
+fn set_last_error(message: impl Into<String>) {
+    let message = c_string(message.into());
+    LAST_ERROR.with(|e| *e.borrow_mut() = Some(message));
+}
+
+/// Build a C string, dropping interior NULs rather than failing.
+fn c_string(s: String) -> CString {
+    CString::new(s).unwrap_or_else(|e| {
+        let mut bytes = e.into_vec();
+        bytes.retain(|&b| b != 0);
+        CString::new(bytes).expect("NULs removed")
+    })
+}
+
+/// Run `f`, turning errors and panics into a NULL return plus a last error.
+fn guard<T>(f: impl FnOnce() -> Result<*mut T, String>) -> *mut T {
+    match catch_unwind(AssertUnwindSafe(f)) {
+        Ok(Ok(ptr)) => ptr,
+        Ok(Err(message)) => {
+            set_last_error(message);
+            ptr::null_mut()
+        }
+        Err(_) => {
+            set_last_error("internal error: tracy panicked");
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Read an optional C string argument.
+///
+/// # Safety
+/// `ptr` must be NULL or point to a NUL-terminated string.
+unsafe fn opt_str<'a>(ptr: *const c_char, name: &str) -> Result<Option<&'a str>, String> {
+    if ptr.is_null() {
+        return Ok(None);
+    }
+    unsafe { CStr::from_ptr(ptr) }
+        .to_str()
+        .map(Some)
+        .map_err(|_| format!("{name} is not valid UTF-8"))
+}
+
+/// # Safety
+/// `ptr` must be NULL or point to a NUL-terminated string.
+unsafe fn req_str<'a>(ptr: *const c_char, name: &str) -> Result<&'a str, String> {
+    unsafe { opt_str(ptr, name) }?.ok_or_else(|| format!("{name} must not be NULL"))
+}
+
+fn into_hits(hits: FileHits) -> *mut TracyHits {
+    let mut strings = Vec::with_capacity(hits.len() * 4);
+    let mut keep = |s: String| {
+        let s = c_string(s);
+        let ptr = s.as_ptr();
+        strings.push(s);
+        ptr
+    };
+
+    let entries = hits
+        .into_iter()
+        .map(|(id, entry)| {
+            let scope = entry.scope.into_iter().next();
+            let (scope_kind, scope_name) = match scope {
+                Some(item) => (keep(item.kind), item.name.map_or(ptr::null(), &mut keep)),
+                None => (ptr::null(), ptr::null()),
+            };
+            TracyEntry {
+                id: keep(id),
+                file: keep(entry.file.to_string_lossy().into_owned()),
+                line: entry.line,
+                comment_text: keep(entry.comment_text),
+                scope_kind,
+                scope_name,
+            }
+        })
+        .collect();
+
+    Box::into_raw(Box::new(TracyHits {
+        entries,
+        _strings: strings,
+    }))
+}
+
+/// Create a scanner. Returns NULL on error.
+///
+/// # Safety
+/// `options` must point to a valid `tracy_options` whose `slugs` array holds
+/// `slug_count` NUL-terminated strings.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_scanner_new(options: *const TracyOptions) -> *mut TracyScanner {
+    guard(|| {
+        let options = unsafe { options.as_ref() }.ok_or("options must not be NULL")?;
+        if options.slugs.is_null() && options.slug_count > 0 {
+            return Err("slugs must not be NULL".to_string());
+        }
+
+        let mut slug = Vec::with_capacity(options.slug_count);
+        for i in 0..options.slug_count {
+            slug.push(unsafe { req_str(*options.slugs.add(i), "slug") }?.to_string());
+        }
+
+        let args = ScanArgs {
+            slug,
+            id_separator: unsafe { opt_str(options.id_separator, "id_separator") }?
+                .map(str::to_string),
+            id_number: unsafe { opt_str(options.id_number, "id_number") }?.map(str::to_string),
+            hierarchical: options.hierarchical != 0,
+            word_boundary: options.word_boundary != 0,
+            ignore_case: options.ignore_case != 0,
+            ..Default::default()
+        };
+
+        let scanner = Scanner::new(&args).map_err(|e| e.to_string())?;
+        Ok(Box::into_raw(Box::new(TracyScanner(scanner))))
+    })
+}
+
+/// Free a scanner. NULL is ignored.
+///
+/// # Safety
+/// `scanner` must be NULL or come from `tracy_scanner_new`, and must not be in
+/// use by another thread.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_scanner_free(scanner: *mut TracyScanner) {
+    if !scanner.is_null() {
+        drop(unsafe { Box::from_raw(scanner) });
+    }
+}
+
+/// Scan `len` bytes of UTF-8 source held in memory. `language` (e.g.
+/// `"cpp"`) may be NULL to detect it from `path`. Returns NULL on error.
+///
+/// # Safety
+/// `scanner` must be a live scanner, `path` a NUL-terminated string, `data`
+/// valid for `len` bytes, and `language` NULL or NUL-terminated.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_scan_buffer(
+    scanner: *const TracyScanner,
+    path: *const c_char,
+    data: *const u8,
+    len: usize,
+    language: *const c_char,
+) -> *mut TracyHits {
+    guard(|| {
+        let scanner = unsafe { scanner.as_ref() }.ok_or("scanner must not be NULL")?;
+        let path = Path::new(unsafe { req_str(path, "path") }?);
+        let content = if len == 0 {
+            &[][..]
+        } else if data.is_null() {
+            return Err("data must not be NULL".to_string());
+        } else {
+            unsafe { std::slice::from_raw_parts(data, len) }
+        };
+        let lang = match unsafe { opt_str(language, "language") }? {
+            Some(name) => Some(
+                name.parse::<SupportLang>()
+                    .map_err(|_| format!("unsupported language '{name}'"))?,
+            ),
+            None => None,
+        };
+
+        let source = Source {
+            path,
+            content,
+            lang,
+        };
+        let hits = scanner.0.scan_source(&source).map_err(|e| e.to_string())?;
+        Ok(into_hits(hits))
+    })
+}
+
+/// Scan the file at `path`; entry paths are made relative to `root`, which
+/// may be NULL. Returns NULL on error.
+///
+/// # Safety
+/// `scanner` must be a live scanner, `path` a NUL-terminated string and
+/// `root` NULL or NUL-terminated.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_scan_path(
+    scanner: *const TracyScanner,
+    root: *const c_char,
+    path: *const c_char,
+) -> *mut TracyHits {
+    guard(|| {
+        let scanner = unsafe { scanner.as_ref() }.ok_or("scanner must not be NULL")?;
+        let path = Path::new(unsafe { req_str(path, "path") }?);
+        let root = Path::new(unsafe { opt_str(root, "root") }?.unwrap_or(""));
+
+        let hits = scanner.0.scan_file(root, path).map_err(|e| e.to_string())?;
+        Ok(into_hits(hits))
+    })
+}
+
+/// Number of entries in `hits`; 0 for NULL.
+///
+/// # Safety
+/// `hits` must be NULL or a live result set.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_hits_len(hits: *const TracyHits) -> usize {
+    unsafe { hits.as_ref() }.map_or(0, |h| h.entries.len())
+}
+
+/// Borrow entry `index`, or NULL when out of range. The entry is valid until
+/// `tracy_hits_free`.
+///
+/// # Safety
+/// `hits` must be NULL or a live result set.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_hits_get(hits: *const TracyHits, index: usize) -> *const TracyEntry {
+    unsafe { hits.as_ref() }
+        .and_then(|h| h.entries.get(index))
+        .map_or(ptr::null(), |e| e as *const TracyEntry)
+}
+
+/// Free a result set. NULL is ignored.
+///
+/// # Safety
+/// `hits` must be NULL or come from a scan function, and no borrowed entry
+/// may be used afterwards.
+#[unsafe(no_mangle)]
+pub unsafe extern "C" fn tracy_hits_free(hits: *mut TracyHits) {
+    if !hits.is_null() {
+        drop(unsafe { Box::from_raw(hits) });
+    }
+}
+
+/// Message for the last error on this thread, or NULL. Valid until the next
+/// tracy call on the same thread.
+#[unsafe(no_mangle)]
+pub extern "C" fn tracy_last_error() -> *const c_char {
+    LAST_ERROR.with(|e| e.borrow().as_ref().map_or(ptr::null(), |s| s.as_ptr()))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn options(slugs: &[*const c_char]) -> TracyOptions {
+        TracyOptions {
+            slugs: slugs.as_ptr(),
+            slug_count: slugs.len(),
+            id_separator: ptr::null(),
+            id_number: ptr::null(),
+            hierarchical: 0,
+            word_boundary: 0,
+            ignore_case: 0,
+        }
+    }
+
+    fn last_error() -> String {
+        let ptr = tracy_last_error();
+        assert!(!ptr.is_null());
+        unsafe { CStr::from_ptr(ptr) }
+            .to_string_lossy()
+            .into_owned()
+    }
+
+    #[test]
+    fn buffer_errors_surface_through_last_error() {
+        let slugs = [c"REQ".as_ptr()];
+        let scanner = unsafe { tracy_scanner_new(&options(&slugs)) };
+        assert!(!scanner.is_null());
+
+        let data = b"// REQ-1 \xff";
+        let hits = unsafe {
+            tracy_scan_buffer(
+                scanner,
+                c"a.cpp".as_ptr(),
+                data.as_ptr(),
+                data.len(),
+                ptr::null(),
+            )
+        };
+        assert!(hits.is_null());
+        assert!(last_error().contains("UTF-8"), "{}", last_error());
+
+        let hits = unsafe {
+            tracy_scan_buffer(
+                scanner,
+                c"a".as_ptr(),
+                data.as_ptr(),
+                data.len(),
+                c"klingon".as_ptr(),
+            )
+        };
+        assert!(hits.is_null());
+        assert!(last_error().contains("klingon"));
+
+        unsafe { tracy_scanner_free(scanner) };
+    }
+
+    #[test]
+    fn entries_are_borrowed_from_hits() {
+        let hits = into_hits(vec![(
+            "REQ-1".to_string(),
+            crate::scan::Entry {
+                file: "src/a.cpp".into(),
+                line: 3,
+                comment_text: "// REQ-1\0".to_string(),
+                above: None,
+                below: None,
+                inline: None,
+                scope: vec![crate::scan::ScopeItem {
+                    kind: "function_definition".to_string(),
+                    name: None,
+                    line: 2,
+                }],
+                variants: None,
+                blame: None,
+            },
+        )]);
+
+        unsafe {
+            assert_eq!(tracy_hits_len(hits), 1);
+            assert!(tracy_hits_get(hits, 1).is_null());
+
+            let entry = &*tracy_hits_get(hits, 0);
+            assert_eq!(CStr::from_ptr(entry.id).to_str().unwrap(), "REQ-1");
+            assert_eq!(CStr::from_ptr(entry.file).to_str().unwrap(), "src/a.cpp");
+            assert_eq!(entry.line, 3);
+            assert_eq!(
+                CStr::from_ptr(entry.comment_text).to_str().unwrap(),
+                "// REQ-1"
+            );
+            assert_eq!(
+                CStr::from_ptr(entry.scope_kind).to_str().unwrap(),
+                "function_definition"
+            );
+            assert!(entry.scope_name.is_null());
+
+            tracy_hits_free(hits);
+            assert_eq!(tracy_hits_len(ptr::null()), 0);
+        }
+    }
+}
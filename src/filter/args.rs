@@ -1,6 +1,6 @@
 use clap::Args;
 
-#[derive(Debug, Default, Args)]
+#[derive(Debug, Clone, Default, Args)]
 pub struct FilterArgs {
     #[arg(long, help = "Include vendored files")]
     pub include_vendored: bool,
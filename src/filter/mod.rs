@@ -4,6 +4,8 @@ mod error;
 pub use args::FilterArgs;
 pub use error::FilterError;
 
+use crate::config::CONFIG_FILE;
+use crate::stats::{self, Phase, Skip};
 use ignore::WalkBuilder;
 use std::fs;
 use std::path::{Path, PathBuf};
@@ -13,15 +15,44 @@ struct Excludes {
     generated: Vec<glob::Pattern>,
 }
 
-struct GlobFilters {
+/// Include and exclude globs, matched against paths relative to the root.
+#[derive(Debug, Default)]
+pub struct GlobFilters {
     include: Vec<glob::Pattern>,
     exclude: Vec<glob::Pattern>,
 }
 
+impl GlobFilters {
+    pub fn new(include: &[String], exclude: &[String]) -> Result<Self, FilterError> {
+        Ok(Self {
+            include: compile_globs(include)?,
+            exclude: compile_globs(exclude)?,
+        })
+    }
+
+    /// Whether a relative path passes both the include and exclude globs.
+    pub fn allows(&self, relative: &str) -> bool {
+        (self.include.is_empty() || self.include.iter().any(|p| p.matches(relative)))
+            && !self.exclude.iter().any(|p| p.matches(relative))
+    }
+}
+
 pub fn collect_files(root: &Path, args: &FilterArgs) -> Result<Vec<PathBuf>, FilterError> {
+    collect_files_and_configs(root, args).map(|(files, _)| files)
+}
+
+/// Like [`collect_files`], also returning the `tracy.toml` files found in
+/// subdirectories of `root` during the same walk. Configs in directories
+/// the filters drop are left out; see [`is_config_excluded`].
+pub fn collect_files_and_configs(
+    root: &Path,
+    args: &FilterArgs,
+) -> Result<(Vec<PathBuf>, Vec<PathBuf>), FilterError> {
+    let _timer = stats::time(Phase::Walk);
     let excludes = parse_gitattributes(root);
-    let filters = parse_globs(args)?;
+    let filters = GlobFilters::new(&args.include, &args.exclude)?;
     let mut files = Vec::new();
+    let mut configs = Vec::new();
 
     for entry in WalkBuilder::new(root)
         .git_ignore(true)
@@ -38,6 +69,13 @@ pub fn collect_files(root: &Path, args: &FilterArgs) -> Result<Vec<PathBuf>, Fil
 
         let path = entry.path();
 
+        if entry.depth() > 1
+            && entry.file_name() == CONFIG_FILE
+            && !is_config_excluded(path, root, &excludes, &filters, args)
+        {
+            configs.push(path.to_path_buf());
+        }
+
         if is_excluded(path, root, &excludes, &filters, args) {
             continue;
         }
@@ -45,12 +83,11 @@ pub fn collect_files(root: &Path, args: &FilterArgs) -> Result<Vec<PathBuf>, Fil
         files.push(path.to_path_buf());
     }
 
-    Ok(files)
+    Ok((files, configs))
 }
 
-fn parse_globs(args: &FilterArgs) -> Result<GlobFilters, FilterError> {
-    let include = args
-        .include
+fn compile_globs(globs: &[String]) -> Result<Vec<glob::Pattern>, FilterError> {
+    globs
         .iter()
         .map(|g| {
             glob::Pattern::new(g).map_err(|e| FilterError::InvalidGlob {
@@ -58,20 +95,7 @@ fn parse_globs(args: &FilterArgs) -> Result<GlobFilters, FilterError> {
                 source: e,
             })
         })
-        .collect::<Result<Vec<_>, _>>()?;
-
-    let exclude = args
-        .exclude
-        .iter()
-        .map(|g| {
-            glob::Pattern::new(g).map_err(|e| FilterError::InvalidGlob {
-                pattern: g.clone(),
-                source: e,
-            })
-        })
-        .collect::<Result<Vec<_>, _>>()?;
-
-    Ok(GlobFilters { include, exclude })
+        .collect()
 }
 
 fn parse_gitattributes(root: &Path) -> Excludes {
@@ -132,25 +156,44 @@ fn is_excluded(
     };
     let relative_str = relative.to_string_lossy();
 
-    if !filters.include.is_empty() && !filters.include.iter().any(|p| p.matches(&relative_str)) {
-        return true;
-    }
-
-    if filters.exclude.iter().any(|p| p.matches(&relative_str)) {
+    if !filters.allows(&relative_str) {
+        stats::skip(Skip::Glob);
         return true;
     }
 
     if !args.include_vendored && excludes.vendored.iter().any(|p| p.matches(&relative_str)) {
+        stats::skip(Skip::Vendored);
         return true;
     }
 
     if !args.include_generated && excludes.generated.iter().any(|p| p.matches(&relative_str)) {
+        stats::skip(Skip::Generated);
         return true;
     }
 
     false
 }
 
+/// Whether a nested config lies in a directory the filters drop. Include
+/// globs select source files rather than directories, so only the exclude
+/// globs and the vendored and generated attributes apply.
+fn is_config_excluded(
+    path: &Path,
+    root: &Path,
+    excludes: &Excludes,
+    filters: &GlobFilters,
+    args: &FilterArgs,
+) -> bool {
+    let Ok(relative) = path.strip_prefix(root) else {
+        return false;
+    };
+    let relative_str = relative.to_string_lossy();
+
+    filters.exclude.iter().any(|p| p.matches(&relative_str))
+        || (!args.include_vendored && excludes.vendored.iter().any(|p| p.matches(&relative_str)))
+        || (!args.include_generated && excludes.generated.iter().any(|p| p.matches(&relative_str)))
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -179,7 +222,7 @@ mod tests {
     #[test]
     fn is_excluded_respects_vendored_flag() {
         let excludes = parse_gitattributes(&fixture_root());
-        let filters = parse_globs(&FilterArgs::default()).unwrap();
+        let filters = GlobFilters::default();
         let root = Path::new("/repo");
         let path = Path::new("/repo/vendor/dep/lib.rs");
 
@@ -196,7 +239,7 @@ mod tests {
     #[test]
     fn is_excluded_respects_generated_flag() {
         let excludes = parse_gitattributes(&fixture_root());
-        let filters = parse_globs(&FilterArgs::default()).unwrap();
+        let filters = GlobFilters::default();
         let root = Path::new("/repo");
         let path = Path::new("/repo/types.generated.rs");
 
@@ -224,7 +267,7 @@ mod tests {
             include: vec!["src/**".to_string()],
             ..Default::default()
         };
-        let filters = parse_globs(&args).unwrap();
+        let filters = GlobFilters::new(&args.include, &args.exclude).unwrap();
 
         assert!(!is_excluded(path_in, root, &excludes, &filters, &args));
         assert!(is_excluded(path_out, root, &excludes, &filters, &args));
@@ -244,9 +287,39 @@ mod tests {
             exclude: vec!["src/gen/**".to_string()],
             ..Default::default()
         };
-        let filters = parse_globs(&args).unwrap();
+        let filters = GlobFilters::new(&args.include, &args.exclude).unwrap();
 
         assert!(!is_excluded(path_in, root, &excludes, &filters, &args));
         assert!(is_excluded(path_out, root, &excludes, &filters, &args));
     }
+
+    #[test]
+    fn configs_in_dropped_directories_are_not_collected() {
+        let excludes = parse_gitattributes(&fixture_root());
+        let root = Path::new("/repo");
+        let args = FilterArgs {
+            include: vec!["**/*.rs".to_string()],
+            exclude: vec!["legacy/**".to_string()],
+            ..Default::default()
+        };
+        let filters = GlobFilters::new(&args.include, &args.exclude).unwrap();
+
+        let kept = Path::new("/repo/safety/tracy.toml");
+        assert!(!is_config_excluded(kept, root, &excludes, &filters, &args));
+        for dropped in ["/repo/legacy/tracy.toml", "/repo/vendor/dep/tracy.toml"] {
+            let dropped = Path::new(dropped);
+            assert!(is_config_excluded(
+                dropped, root, &excludes, &filters, &args
+            ));
+        }
+
+        let args = FilterArgs {
+            include_vendored: true,
+            ..args
+        };
+        let vendored = Path::new("/repo/vendor/dep/tracy.toml");
+        assert!(!is_config_excluded(
+            vendored, root, &excludes, &filters, &args
+        ));
+    }
 }
@@ -0,0 +1,70 @@
+//! Small filesystem helpers shared by the output writers.
+
+use std::fs::{self, File};
+use std::io;
+use std::path::Path;
+use std::time::SystemTime;
+
+/// Write `content` to `path` unless the file already holds exactly these
+/// bytes, so that an unchanged output keeps its mtime and does not trigger
+/// downstream rebuilds. Returns whether the file was written.
+pub fn write_if_changed(path: &Path, content: &[u8]) -> io::Result<bool> {
+    // A length mismatch settles it without reading the old file
+    let same_len = fs::metadata(path).is_ok_and(|m| m.len() == content.len() as u64);
+    if same_len && fs::read(path).is_ok_and(|existing| existing == content) {
+        return Ok(false);
+    }
+    fs::write(path, content)?;
+    Ok(true)
+}
+
+/// Set the modification time of `path` to now, creating it empty if needed.
+pub fn touch(path: &Path) -> io::Result<()> {
+    File::options()
+        .append(true)
+        .create(true)
+        .open(path)?
+        .set_modified(SystemTime::now())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::TempDir;
+
+    #[test]
+    fn unchanged_content_is_not_rewritten() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join("out.json");
+
+        assert!(write_if_changed(&path, b"a").unwrap());
+        let before = fs::metadata(&path).unwrap().modified().unwrap();
+        std::thread::sleep(std::time::Duration::from_millis(20));
+
+        assert!(!write_if_changed(&path, b"a").unwrap());
+        assert_eq!(fs::metadata(&path).unwrap().modified().unwrap(), before);
+
+        assert!(write_if_changed(&path, b"b").unwrap());
+        assert_eq!(fs::read_to_string(&path).unwrap(), "b");
+    }
+
+    #[test]
+    fn touch_creates_or_bumps_without_changing_content() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join("stamp");
+
+        touch(&path).unwrap();
+        assert_eq!(fs::read(&path).unwrap(), b"");
+
+        fs::write(&path, b"kept").unwrap();
+        File::options()
+            .append(true)
+            .open(&path)
+            .unwrap()
+            .set_modified(SystemTime::UNIX_EPOCH)
+            .unwrap();
+        touch(&path).unwrap();
+        assert_eq!(fs::read(&path).unwrap(), b"kept");
+        assert!(fs::metadata(&path).unwrap().modified().unwrap() > SystemTime::UNIX_EPOCH);
+    }
+}
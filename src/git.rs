@@ -1,10 +1,12 @@
-use serde::Serialize;
+use serde::{Deserialize, Serialize};
 use std::collections::{BTreeMap, BTreeSet};
 use std::path::{Path, PathBuf};
 use std::process::Command;
 use thiserror::Error;
 
-use crate::scan::ScanResult;
+use crate::scan::{Entry, ScanResult};
+use crate::stats::{self, Phase};
+use crate::trace;
 
 #[derive(Debug, Clone, PartialEq, Eq, Serialize)]
 pub struct GitMeta {
@@ -27,7 +29,7 @@ pub enum GitError {
     OutputUtf8(#[from] std::string::FromUtf8Error),
 }
 
-#[derive(Debug, Clone, PartialEq, Eq, Serialize)]
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
 pub struct BlameInfo {
     pub commit: String,
     #[serde(skip_serializing_if = "Option::is_none")]
@@ -61,8 +63,14 @@ pub fn collect_git_meta(scan_root: &Path) -> Result<GitMeta, GitError> {
     })
 }
 
-pub fn add_blame(scan_root: &Path, results: &mut ScanResult) -> Result<(), GitError> {
+/// Fail unless `scan_root` is inside a git work tree.
+pub fn check_work_tree(scan_root: &Path) -> Result<(), GitError> {
     let _ = git(scan_root, &["rev-parse", "--is-inside-work-tree"])?;
+    Ok(())
+}
+
+pub fn add_blame(scan_root: &Path, results: &mut ScanResult) -> Result<(), GitError> {
+    check_work_tree(scan_root)?;
 
     let mut by_file: BTreeMap<PathBuf, BTreeSet<usize>> = BTreeMap::new();
     for entries in results.values() {
@@ -102,6 +110,25 @@ pub fn add_blame(scan_root: &Path, results: &mut ScanResult) -> Result<(), GitEr
     Ok(())
 }
 
+/// Blame the marker lines of `entries`, which all belong to one file.
+///
+/// This is the per-file half of [`add_blame`], for callers that process hits
+/// file by file. As there, a file that cannot be blamed is left without blame.
+pub fn blame_file_entries(scan_root: &Path, entries: &mut [&mut Entry]) {
+    let Some(file) = entries.first().map(|e| e.file.clone()) else {
+        return;
+    };
+    let start = entries.iter().map(|e| e.line).min().unwrap_or(1);
+    let end = entries.iter().map(|e| e.line).max().unwrap_or(start);
+
+    let Ok(map) = blame_range(scan_root, &file, start, end) else {
+        return;
+    };
+    for entry in entries.iter_mut() {
+        entry.blame = map.get(&entry.line).cloned();
+    }
+}
+
 fn git(scan_root: &Path, args: &[&str]) -> Result<String, GitError> {
     let output = Command::new("git")
         .arg("-C")
@@ -125,6 +152,8 @@ fn blame_range(
     start_line: usize,
     end_line: usize,
 ) -> Result<BTreeMap<usize, BlameInfo>, GitError> {
+    let _span = trace::file(file);
+    let _timer = stats::time(Phase::Blame);
     let range = format!("{start_line},{end_line}");
     let file = file.to_string_lossy().to_string();
 
@@ -142,7 +171,8 @@ fn blame_range(
     Ok(parse_blame_porcelain(&output))
 }
 
-fn parse_blame_porcelain(output: &str) -> BTreeMap<usize, BlameInfo> {
+/// Parse `git blame --porcelain` output into blame info per final line.
+pub(crate) fn parse_blame_porcelain(output: &str) -> BTreeMap<usize, BlameInfo> {
     let mut result = BTreeMap::new();
     let mut iter = output.lines();
 
@@ -289,6 +319,7 @@ mod tests {
                 below: None,
                 inline: None,
                 scope: Vec::new(),
+                variants: None,
                 blame: None,
             }],
         );
@@ -302,6 +333,7 @@ mod tests {
                 below: None,
                 inline: None,
                 scope: Vec::new(),
+                variants: None,
                 blame: None,
             }],
         );
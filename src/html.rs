@@ -0,0 +1,290 @@
+//! Static HTML report.
+//!
+//! The report is a directory: a fixed `index.html` viewer plus precomputed
+//! data shards it loads on demand. `data/index.js` lists every requirement id
+//! with its match count and shard number; `data/shard-N.js` holds the entries
+//! for a run of consecutive ids. Shards are plain scripts rather than JSON so
+//! the report also works when opened from disk, where `fetch` is unavailable.
+
+use crate::catalog::Coverage;
+use crate::fsutil::{touch, write_if_changed};
+use crate::git::GitMeta;
+use crate::output::Report;
+use crate::pool;
+use crate::scan::{Entry, ScanResult};
+use crate::stats::{self, Phase};
+use serde::Serialize;
+use std::collections::BTreeMap;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use thiserror::Error;
+
+/// The viewer page, written verbatim as `index.html`.
+const INDEX_HTML: &str = include_str!("html/index.html");
+
+/// Entries per shard. Small enough that any shard loads instantly; a single
+/// requirement with more entries gets a shard of its own.
+const SHARD_ENTRIES: usize = 1000;
+
+const DATA_DIR: &str = "data";
+
+#[derive(Debug, Error)]
+pub enum HtmlError {
+    #[error("failed to write report file {path}: {source}")]
+    Write {
+        path: PathBuf,
+        source: std::io::Error,
+    },
+
+    #[error("failed to serialize report data: {0}")]
+    Serialize(#[from] serde_json::Error),
+}
+
+/// The file of the report in `dir` whose modification time moves whenever
+/// any part of the report changes; the build target for `--depfile`.
+pub fn report_target(dir: &Path) -> PathBuf {
+    dir.join(DATA_DIR).join("index.js")
+}
+
+/// Write the report for `report` into the directory `dir`.
+///
+/// Files whose content is unchanged are left alone, and shards left over
+/// from a larger previous report in the same directory are removed. When
+/// anything changed, [`report_target`] is written or touched last.
+pub fn write_report(dir: &Path, report: &Report) -> Result<(), HtmlError> {
+    let _timer = stats::time(Phase::Output);
+    let data_dir = dir.join(DATA_DIR);
+    fs::create_dir_all(&data_dir).map_err(|e| write_error(&data_dir, e))?;
+
+    let shards = plan_shards(report.results);
+    let mut changed = remove_stale_shards(&data_dir, shards.len())?;
+
+    let stop = AtomicBool::new(false);
+    let per_worker = pool::for_each_index(
+        shards.len(),
+        &stop,
+        || Ok(false),
+        |state: &mut Result<bool, HtmlError>, index| {
+            let Ok(changed) = state else { return };
+            match write_shard(&data_dir, index, &shards[index], report.results) {
+                Ok(written) => *changed |= written,
+                Err(e) => {
+                    *state = Err(e);
+                    stop.store(true, Ordering::Relaxed);
+                }
+            }
+        },
+    );
+    for state in per_worker {
+        changed |= state?;
+    }
+
+    changed |= write_file(&dir.join("index.html"), INDEX_HTML)?;
+    let target = report_target(dir);
+    if !write_file(&target, &index_script(report, &shards)?)? && changed {
+        touch(&target).map_err(|e| write_error(&target, e))?;
+    }
+    Ok(())
+}
+
+/// Group requirement ids, in order, into shards of about `SHARD_ENTRIES`.
+fn plan_shards(results: &ScanResult) -> Vec<Vec<&str>> {
+    let mut shards: Vec<Vec<&str>> = Vec::new();
+    let mut current: Vec<&str> = Vec::new();
+    let mut size = 0;
+
+    for (id, entries) in results {
+        if !current.is_empty() && size + entries.len() > SHARD_ENTRIES {
+            shards.push(std::mem::take(&mut current));
+            size = 0;
+        }
+        current.push(id);
+        size += entries.len();
+    }
+    if !current.is_empty() {
+        shards.push(current);
+    }
+
+    shards
+}
+
+fn index_script(report: &Report, shards: &[Vec<&str>]) -> Result<String, HtmlError> {
+    #[derive(Serialize)]
+    struct Index<'a> {
+        #[serde(skip_serializing_if = "Option::is_none")]
+        meta: Option<&'a GitMeta>,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        coverage: Option<&'a Coverage>,
+        total: usize,
+        shards: usize,
+        /// `[id, match count, shard]` triples in id order
+        ids: Vec<(&'a str, usize, usize)>,
+    }
+
+    let ids = shards
+        .iter()
+        .enumerate()
+        .flat_map(|(shard, ids)| {
+            ids.iter()
+                .map(move |id| (*id, report.results[*id].len(), shard))
+        })
+        .collect();
+
+    let index = Index {
+        meta: report.meta,
+        coverage: report.coverage,
+        total: report.results.values().map(Vec::len).sum(),
+        shards: shards.len(),
+        ids,
+    };
+    Ok(format!("tracyIndex({});\n", serde_json::to_string(&index)?))
+}
+
+fn write_shard(
+    data_dir: &Path,
+    index: usize,
+    ids: &[&str],
+    results: &ScanResult,
+) -> Result<bool, HtmlError> {
+    let chunk: BTreeMap<&str, &Vec<Entry>> = ids.iter().map(|id| (*id, &results[*id])).collect();
+    let script = format!("tracyShard({index}, {});\n", serde_json::to_string(&chunk)?);
+    write_file(&data_dir.join(format!("shard-{index}.js")), &script)
+}
+
+/// Remove shard files numbered `keep` and above. Returns whether any were.
+fn remove_stale_shards(data_dir: &Path, keep: usize) -> Result<bool, HtmlError> {
+    let mut removed = false;
+    let entries = fs::read_dir(data_dir).map_err(|e| write_error(data_dir, e))?;
+    for entry in entries.flatten() {
+        let name = entry.file_name();
+        let name = name.to_string_lossy();
+        let Some(number) = name
+            .strip_prefix("shard-")
+            .and_then(|rest| rest.strip_suffix(".js"))
+        else {
+            continue;
+        };
+        if !number.parse::<usize>().is_ok_and(|n| n < keep) {
+            fs::remove_file(entry.path()).map_err(|e| write_error(&entry.path(), e))?;
+            removed = true;
+        }
+    }
+    Ok(removed)
+}
+
+/// Write `content` unless unchanged. Returns whether the file was written.
+fn write_file(path: &Path, content: &str) -> Result<bool, HtmlError> {
+    write_if_changed(path, content.as_bytes()).map_err(|e| write_error(path, e))
+}
+
+fn write_error(path: &Path, source: std::io::Error) -> HtmlError {
+    HtmlError::Write {
+        path: path.to_path_buf(),
+        source,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::TempDir;
+
+    fn results(counts: &[(&str, usize)]) -> ScanResult {
+        counts
+            .iter()
+            .map(|(id, n)| {
+                let entries = (0..*n)
+                    .map(|i| Entry {
+                        file: PathBuf::from("src/lib.rs"),
+                        line: i + 1,
+                        comment_text: format!("// {id}"),
+                        above: None,
+                        below: None,
+                        inline: None,
+                        scope: Vec::new(),
+                        variants: None,
+                        blame: None,
+                    })
+                    .collect();
+                (id.to_string(), entries)
+            })
+            .collect()
+    }
+
+    #[test]
+    fn shards_pack_ids_up_to_the_entry_budget() {
+        let results = results(&[
+            ("REQ-1", 600),
+            ("REQ-2", 300),
+            ("REQ-3", 200),
+            ("REQ-4", 2500),
+            ("REQ-5", 1),
+        ]);
+        assert_eq!(
+            plan_shards(&results),
+            vec![
+                vec!["REQ-1", "REQ-2"],
+                vec!["REQ-3"],
+                vec!["REQ-4"],
+                vec!["REQ-5"],
+            ]
+        );
+    }
+
+    #[test]
+    fn writes_viewer_index_and_shards() {
+        let dir = TempDir::new().unwrap();
+        let out = dir.path().join("report");
+        fs::create_dir_all(out.join(DATA_DIR)).unwrap();
+        fs::write(out.join(DATA_DIR).join("shard-99.js"), "stale").unwrap();
+
+        let results = results(&[("REQ-1", 2), ("REQ-2", 1)]);
+        write_report(&out, &Report::new(&results)).unwrap();
+
+        assert!(out.join("index.html").is_file());
+        assert!(!out.join(DATA_DIR).join("shard-99.js").exists());
+
+        let index = fs::read_to_string(out.join(DATA_DIR).join("index.js")).unwrap();
+        let json = index
+            .strip_prefix("tracyIndex(")
+            .and_then(|s| s.strip_suffix(");\n"))
+            .unwrap();
+        let value: serde_json::Value = serde_json::from_str(json).unwrap();
+        assert_eq!(value["total"], 3);
+        assert_eq!(value["shards"], 1);
+        assert_eq!(value["ids"][0], serde_json::json!(["REQ-1", 2, 0]));
+
+        let shard = fs::read_to_string(out.join(DATA_DIR).join("shard-0.js")).unwrap();
+        assert!(shard.starts_with("tracyShard(0, {\"REQ-1\":["));
+    }
+
+    #[test]
+    fn target_moves_only_when_the_report_changes() {
+        let dir = TempDir::new().unwrap();
+        let out = dir.path().join("report");
+        let target = report_target(&out);
+        let age_target = || {
+            fs::File::options()
+                .append(true)
+                .open(&target)
+                .unwrap()
+                .set_modified(std::time::SystemTime::UNIX_EPOCH)
+                .unwrap()
+        };
+        let target_moved = || {
+            fs::metadata(&target).unwrap().modified().unwrap() > std::time::SystemTime::UNIX_EPOCH
+        };
+
+        let mut results = results(&[("REQ-1", 2)]);
+        write_report(&out, &Report::new(&results)).unwrap();
+        age_target();
+        write_report(&out, &Report::new(&results)).unwrap();
+        assert!(!target_moved());
+
+        // Only a shard changes; the index of ids and counts stays the same
+        results.get_mut("REQ-1").unwrap()[0].line = 40;
+        write_report(&out, &Report::new(&results)).unwrap();
+        assert!(target_moved());
+    }
+}
@@ -1,7 +1,24 @@
+pub mod aggregate;
+pub mod archive;
 pub mod args;
+#[doc(hidden)]
+pub mod bench;
+pub mod build;
+pub mod catalog;
 pub mod config;
+pub mod depfile;
+pub mod discover;
 pub mod error;
+pub mod ffi;
 pub mod filter;
+pub mod fsutil;
 pub mod git;
+pub mod html;
+pub mod nested;
 pub mod output;
+mod pool;
+pub mod profile;
+pub mod roots;
 pub mod scan;
+pub mod stats;
+pub mod trace;
@@ -1,18 +1,65 @@
+use ast_grep_language::{Language, SupportLang};
 use clap::Parser;
 use std::fs;
+use std::path::{Path, PathBuf};
 use std::process::ExitCode;
+use std::thread;
+use std::time::Instant;
 
+use tracy::aggregate::aggregate;
+use tracy::archive::{ArchiveKind, scan_archive};
 use tracy::args::Args;
+use tracy::args::Command;
+use tracy::args::ResolvedArgs;
 use tracy::args::resolve_args;
+use tracy::catalog::{Coverage, load_catalog};
 use tracy::config::{find_config, load_config};
+use tracy::depfile::render_depfile;
+use tracy::discover::{DiscoverArgs, discover_slugs};
 use tracy::error::TracyError;
-use tracy::filter::collect_files;
+use tracy::filter::{GlobFilters, collect_files, collect_files_and_configs};
+use tracy::fsutil::{touch, write_if_changed};
 use tracy::git::{add_blame, collect_git_meta};
-use tracy::output::format_output;
-use tracy::scan::scan_files;
+use tracy::html::{report_target, write_report};
+use tracy::nested::NestedConfigs;
+use tracy::output::{OutputFormat, Report, format_matrix, format_output};
+use tracy::profile::scan_profiles;
+use tracy::roots::scan_roots;
+use tracy::scan::{Scanner, scan_files};
+use tracy::stats::{self, Phase, StatsFormat};
+use tracy::trace;
 
 fn main() -> ExitCode {
-    match run() {
+    let cli = Args::parse();
+    let stats_format = cli.stats;
+    if stats_format.is_some() {
+        stats::enable();
+    }
+    let trace_out = cli.trace_out.clone();
+    if trace_out.is_some() {
+        trace::enable();
+    }
+    let start = Instant::now();
+
+    let result = run(cli);
+    // A trace of a failed run is still worth having
+    let result = match &trace_out {
+        Some(path) => result.and(trace::write(path).map_err(TracyError::from)),
+        None => result,
+    };
+
+    if let Some(format) = stats_format {
+        let stats = stats::snapshot(start.elapsed());
+        match format {
+            StatsFormat::Text => eprint!("{}", stats::format_text(&stats)),
+            StatsFormat::Json => match serde_json::to_string_pretty(&stats) {
+                Ok(json) => eprintln!("{json}"),
+                Err(e) => eprintln!("error: failed to serialize stats: {e}"),
+            },
+        }
+    }
+
+    match result {
         Ok(()) => ExitCode::SUCCESS,
         Err(e) => {
             eprintln!("error: {e}");
@@ -21,13 +68,16 @@ fn main() -> ExitCode {
     }
 }
 
-fn run() -> Result<(), TracyError> {
-    let cli = Args::parse();
-
+fn run(cli: Args) -> Result<(), TracyError> {
     let cwd = std::env::current_dir()?;
+
+    if let Some(Command::Discover(args)) = cli.command {
+        return run_discover(args, &cwd);
+    }
     let search_start = cli
         .root
-        .clone()
+        .first()
+        .cloned()
         .map(|p| if p.is_absolute() { p } else { cwd.join(p) })
         .unwrap_or_else(|| cwd.clone());
 
@@ -43,10 +93,13 @@ fn run() -> Result<(), TracyError> {
         find_config(&search_start).map(|p| if p.is_absolute() { p } else { cwd.join(p) })
     };
 
-    let (config, config_dir) = match config_path {
+    let (config, config_dir) = match &config_path {
         Some(path) => {
-            let config = load_config(&path)?;
-            let dir = path.parent().map(|p| p.to_path_buf()).unwrap_or(cwd);
+            let config = load_config(path)?;
+            let dir = path
+                .parent()
+                .map(|p| p.to_path_buf())
+                .unwrap_or_else(|| cwd.clone());
             (Some(config), Some(dir))
         }
         None => (None, None),
@@ -54,8 +107,59 @@ fn run() -> Result<(), TracyError> {
 
     let args = resolve_args(cli, config, config_dir.as_deref())?;
 
-    let files = collect_files(&args.root, &args.filter)?;
-    let mut matches = scan_files(&args.root, &files, &args.scan)?;
+    if !args.roots.is_empty() {
+        return run_roots(&args);
+    }
+    if let Some(kind) = ArchiveKind::from_path(&args.root) {
+        return run_archive(&args, kind);
+    }
+
+    let (files, nested_configs) = collect_files_and_configs(&args.root, &args.filter)?;
+
+    if !args.profiles.is_empty() {
+        return run_profiles(&args, &files);
+    }
+
+    if let Some(spec) = &args.aggregate {
+        let matrix = aggregate(&args.root, &files, &args.scan, spec, args.include_blame)?;
+        if args.fail_on_empty && matrix.cells.is_empty() {
+            return Err(TracyError::NoResults);
+        }
+        emit(
+            args.quiet,
+            args.output.as_deref(),
+            &format_matrix(args.format, &matrix)?,
+        )?;
+        return write_depfile(&args, config_path.as_deref(), &[], &files, &cwd);
+    }
+
+    let nested_configs = if args.nested_configs {
+        nested_configs
+    } else {
+        Vec::new()
+    };
+
+    // Large catalogs take a while to parse, so load them alongside the scan
+    let (matches, catalog) = thread::scope(|s| {
+        let catalog = args
+            .catalog
+            .as_deref()
+            .map(|path| s.spawn(|| load_catalog(path, &args.scan)));
+        let matches = if !nested_configs.is_empty() {
+            NestedConfigs::load(&args.root, &args.scan, &args.cli_scan, &nested_configs)
+                .and_then(|nested| Ok(nested.scan_paths(&args.root, &files)?))
+        } else {
+            scan_files(&args.root, &files, &args.scan).map_err(TracyError::from)
+        };
+        let catalog = catalog.map(|handle| {
+            handle
+                .join()
+                .unwrap_or_else(|e| std::panic::resume_unwind(e))
+        });
+        (matches, catalog)
+    });
+    let mut matches = matches?;
+    let catalog = catalog.transpose()?;
 
     if args.include_blame {
         add_blame(&args.root, &mut matches)?;
@@ -71,15 +175,221 @@ fn run() -> Result<(), TracyError> {
         None
     };
 
-    let output = format_output(args.format, meta.as_ref(), &matches)?;
+    let coverage = catalog.map(|catalog| Coverage::compute(&catalog, &matches));
+
+    let report = Report {
+        meta: meta.as_ref(),
+        coverage: coverage.as_ref(),
+        ..Report::new(&matches)
+    };
+
+    if args.format == OutputFormat::Html {
+        let dir = args.output.as_deref().ok_or(TracyError::HtmlNeedsOutput)?;
+        write_report(dir, &report)?;
+        if !args.quiet {
+            println!("{}", dir.join("index.html").display());
+        }
+        return write_depfile(&args, config_path.as_deref(), &nested_configs, &files, &cwd);
+    }
+
+    let output = format_output(args.format, &report)?;
+    emit(args.quiet, args.output.as_deref(), &output)?;
+    write_depfile(&args, config_path.as_deref(), &nested_configs, &files, &cwd)
+}
+
+/// Scan once for every `[[profile]]` and write each profile's output.
+fn run_profiles(args: &ResolvedArgs, files: &[PathBuf]) -> Result<(), TracyError> {
+    let results = scan_profiles(&args.root, files, &args.profiles)?;
+
+    if args.fail_on_empty && results.iter().all(|matches| matches.is_empty()) {
+        return Err(TracyError::NoResults);
+    }
+
+    let meta = if args.include_git_meta {
+        Some(collect_git_meta(&args.root)?)
+    } else {
+        None
+    };
+
+    for (profile, mut matches) in args.profiles.iter().zip(results) {
+        if args.include_blame {
+            add_blame(&args.root, &mut matches)?;
+        }
+
+        let report = Report {
+            meta: meta.as_ref(),
+            ..Report::new(&matches)
+        };
+        write_output(
+            args.quiet,
+            profile.format,
+            profile.output.as_deref(),
+            &report,
+        )?;
+    }
 
-    if !args.quiet {
+    Ok(())
+}
+
+/// Scan every root on the shared pool and write each root's report, with
+/// that root's git metadata and paths relative to it.
+fn run_roots(args: &ResolvedArgs) -> Result<(), TracyError> {
+    let results = scan_roots(&args.roots)?;
+
+    if args.fail_on_empty && results.iter().all(|matches| matches.is_empty()) {
+        return Err(TracyError::NoResults);
+    }
+
+    for (root, mut matches) in args.roots.iter().zip(results) {
+        if args.include_blame {
+            add_blame(&root.path, &mut matches)?;
+        }
+        let meta = if args.include_git_meta {
+            Some(collect_git_meta(&root.path)?)
+        } else {
+            None
+        };
+
+        let report = Report {
+            meta: meta.as_ref(),
+            ..Report::new(&matches)
+        };
+        // `--output DIR` need not exist yet
+        if let Some(dir) = root.output.as_deref().and_then(Path::parent) {
+            fs::create_dir_all(dir)?;
+        }
+        write_output(args.quiet, root.format, root.output.as_deref(), &report)?;
+    }
+
+    Ok(())
+}
+
+/// Scan the members of an archive in place and write the report.
+fn run_archive(args: &ResolvedArgs, kind: ArchiveKind) -> Result<(), TracyError> {
+    let filters = GlobFilters::new(&args.filter.include, &args.filter.exclude)?;
+    let scanner = Scanner::new(&args.scan)?;
+
+    let (matches, catalog) = thread::scope(|s| {
+        let catalog = args
+            .catalog
+            .as_deref()
+            .map(|path| s.spawn(|| load_catalog(path, &args.scan)));
+        let matches = scan_archive(&args.root, kind, &filters, &scanner);
+        let catalog = catalog.map(|handle| {
+            handle
+                .join()
+                .unwrap_or_else(|e| std::panic::resume_unwind(e))
+        });
+        (matches, catalog)
+    });
+    let matches = matches?;
+    let catalog = catalog.transpose()?;
+
+    if args.fail_on_empty && matches.is_empty() {
+        return Err(TracyError::NoResults);
+    }
+
+    let coverage = catalog.map(|catalog| Coverage::compute(&catalog, &matches));
+    let report = Report {
+        coverage: coverage.as_ref(),
+        ..Report::new(&matches)
+    };
+    write_output(args.quiet, args.format, args.output.as_deref(), &report)
+}
+
+/// Write one report of a profile, root or archive run.
+fn write_output(
+    quiet: bool,
+    format: OutputFormat,
+    output: Option<&Path>,
+    report: &Report,
+) -> Result<(), TracyError> {
+    if format == OutputFormat::Html {
+        let dir = output.ok_or(TracyError::HtmlNeedsOutput)?;
+        write_report(dir, report)?;
+        if !quiet {
+            println!("{}", dir.join("index.html").display());
+        }
+        return Ok(());
+    }
+
+    emit(quiet, output, &format_output(format, report)?)
+}
+
+fn emit(quiet: bool, path: Option<&Path>, output: &str) -> Result<(), TracyError> {
+    let _timer = stats::time(Phase::Output);
+    if !quiet {
         println!("{output}");
     }
 
-    if let Some(path) = &args.output {
-        fs::write(path, &output)?;
+    // Leave an unchanged output untouched so build systems see it as fresh
+    if let Some(path) = path {
+        write_if_changed(path, output.as_bytes())?;
+    }
+
+    Ok(())
+}
+
+/// Touch the `--stamp` and write the `--depfile`, naming the stamp or the
+/// output and every file the run read.
+fn write_depfile(
+    args: &ResolvedArgs,
+    config_path: Option<&Path>,
+    nested_configs: &[PathBuf],
+    files: &[PathBuf],
+    cwd: &Path,
+) -> Result<(), TracyError> {
+    if let Some(stamp) = &args.stamp {
+        touch(stamp)?;
+    }
+    let (Some(depfile), Some(output)) = (&args.depfile, &args.output) else {
+        return Ok(());
+    };
+    let target = if let Some(stamp) = &args.stamp {
+        stamp.clone()
+    } else if args.format == OutputFormat::Html {
+        report_target(output)
+    } else {
+        output.clone()
+    };
+    // Read by the vendored/generated filter whenever it exists
+    let gitattributes = Some(args.root.join(".gitattributes")).filter(|path| path.is_file());
+
+    // Only files in a supported language are ever read by the scan
+    let deps: Vec<PathBuf> = config_path
+        .into_iter()
+        .chain(nested_configs.iter().map(PathBuf::as_path))
+        .chain(args.scan.slug_file.as_deref())
+        .chain(args.catalog.as_deref())
+        .chain(args.compile_commands.iter().map(PathBuf::as_path))
+        .chain(gitattributes.as_deref())
+        .chain(
+            files
+                .iter()
+                .filter(|path| SupportLang::from_path(path).is_some())
+                .map(PathBuf::as_path),
+        )
+        .map(|path| cwd.join(path))
+        .collect();
+
+    write_if_changed(depfile, render_depfile(&target, &deps).as_bytes())?;
+    Ok(())
+}
+
+fn run_discover(args: DiscoverArgs, cwd: &Path) -> Result<(), TracyError> {
+    let root = match args.root {
+        Some(root) if root.is_absolute() => root,
+        Some(root) => cwd.join(root),
+        None => cwd.to_path_buf(),
+    };
+
+    let files = collect_files(&root, &args.filter)?;
+    let mut slugs = discover_slugs(&files)?;
+    slugs.retain(|s| s.files >= args.min_files);
+    if let Some(top) = args.top {
+        slugs.truncate(top);
     }
 
+    println!("{}", serde_json::to_string_pretty(&slugs)?);
     Ok(())
 }
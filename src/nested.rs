@@ -0,0 +1,266 @@
+//! Nested `tracy.toml` files.
+//!
+//! A `tracy.toml` in a subdirectory of the scan root refines the settings
+//! for the files below it. Its `[scan]` keys override those of the nearest
+//! configured ancestor, and its `[filter]` `include`/`exclude` globs, matched
+//! relative to its directory, narrow the files further. Every configured
+//! directory is resolved and compiled once up front; each file's directory
+//! is then looked up in a cache, so resolving a file is one hash lookup.
+
+use crate::args::{CliScan, overlay_scan};
+use crate::config::load_config;
+use crate::error::TracyError;
+use crate::filter::GlobFilters;
+use crate::pool;
+use crate::scan::{FileHits, ScanArgs, ScanError, ScanResult, Scanner};
+use crate::stats::{self, Skip};
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+/// The effective settings of every configured directory under a root.
+#[derive(Debug)]
+pub struct NestedConfigs {
+    /// Configured directories, parents before children; the root is first
+    layers: Vec<Layer>,
+    /// Distinct effective scan settings, compiled once
+    scanners: Vec<Scanner>,
+    limit: Option<usize>,
+}
+
+#[derive(Debug)]
+struct Layer {
+    dir: PathBuf,
+    parent: Option<usize>,
+    scanner: usize,
+    /// This directory's own globs; ancestors' globs apply as well
+    globs: Option<GlobFilters>,
+}
+
+impl NestedConfigs {
+    /// Resolve the nested `configs` found under `root` on top of `base`;
+    /// the `cli` flags win over every nested config.
+    pub fn load(
+        root: &Path,
+        base: &ScanArgs,
+        cli: &CliScan,
+        configs: &[PathBuf],
+    ) -> Result<Self, TracyError> {
+        let mut configs: Vec<&PathBuf> = configs.iter().collect();
+        configs.sort_by_key(|path| path.components().count());
+
+        let mut layers = vec![Layer {
+            dir: root.to_path_buf(),
+            parent: None,
+            scanner: 0,
+            globs: None,
+        }];
+        let mut settings = vec![base.clone()];
+        let mut scanners = vec![Scanner::new(base)?];
+
+        for path in configs {
+            let dir = path.parent().unwrap_or(root).to_path_buf();
+            // Parents sort first, so the last ancestor is the nearest one
+            let parent = layers
+                .iter()
+                .rposition(|layer| dir.starts_with(&layer.dir))
+                .unwrap_or(0);
+
+            let config = load_config(path)?;
+            let scan = overlay_scan(config.scan, &settings[layers[parent].scanner], cli, &dir)?;
+            let scanner = match settings.iter().position(|s| *s == scan) {
+                Some(index) => index,
+                None => {
+                    scanners.push(Scanner::new(&scan)?);
+                    settings.push(scan);
+                    scanners.len() - 1
+                }
+            };
+
+            let include = config.filter.include.unwrap_or_default();
+            let exclude = config.filter.exclude.unwrap_or_default();
+            let globs = if include.is_empty() && exclude.is_empty() {
+                None
+            } else {
+                Some(GlobFilters::new(&include, &exclude)?)
+            };
+
+            layers.push(Layer {
+                dir,
+                parent: Some(parent),
+                scanner,
+                globs,
+            });
+        }
+
+        Ok(Self {
+            layers,
+            scanners,
+            limit: base.limit,
+        })
+    }
+
+    /// Scan `paths` on the worker pool, each with the settings of its
+    /// nearest configured directory, and merge the hits in path order.
+    ///
+    /// The top-level limit applies as in [`Scanner::scan_paths`].
+    pub fn scan_paths(&self, root: &Path, paths: &[PathBuf]) -> Result<ScanResult, ScanError> {
+        let layer_of = self.resolve(paths);
+        let limit = self.limit.unwrap_or(usize::MAX);
+
+        let stop = AtomicBool::new(false);
+        let found = AtomicUsize::new(0);
+        let per_worker = pool::for_each_index(paths.len(), &stop, Vec::new, |done, index| {
+            let Some(layer) = layer_of[index] else {
+                return;
+            };
+            let scanner = &self.scanners[self.layers[layer].scanner];
+            let result = scanner.scan_file(root, &paths[index]);
+            match &result {
+                Ok(hits) => {
+                    if found.fetch_add(hits.len(), Ordering::Relaxed) + hits.len() >= limit {
+                        stop.store(true, Ordering::Relaxed);
+                    }
+                }
+                Err(_) => stop.store(true, Ordering::Relaxed),
+            }
+            done.push((index, result));
+        });
+
+        let mut per_file: Vec<(usize, Result<FileHits, ScanError>)> =
+            per_worker.into_iter().flatten().collect();
+        per_file.sort_unstable_by_key(|(index, _)| *index);
+
+        let mut results = ScanResult::new();
+        let mut remaining = limit;
+        for (_, hits) in per_file {
+            // As in `Scanner::scan_paths`, errors past the limit are ignored
+            if remaining == 0 {
+                break;
+            }
+            for (slug, entry) in hits? {
+                if remaining == 0 {
+                    break;
+                }
+                remaining -= 1;
+                results.entry(slug).or_default().push(entry);
+            }
+        }
+        Ok(results)
+    }
+
+    /// The layer of each path, or `None` when a nested filter drops it.
+    fn resolve(&self, paths: &[PathBuf]) -> Vec<Option<usize>> {
+        let mut by_dir: HashMap<&Path, usize> = self
+            .layers
+            .iter()
+            .enumerate()
+            .map(|(index, layer)| (layer.dir.as_path(), index))
+            .collect();
+
+        paths
+            .iter()
+            .map(|path| {
+                let layer = path.parent().map_or(0, |dir| layer_of(dir, &mut by_dir));
+                let accepted = self.accepts(layer, path);
+                if !accepted {
+                    stats::skip(Skip::NestedFilter);
+                }
+                accepted.then_some(layer)
+            })
+            .collect()
+    }
+
+    /// Whether `path` passes the globs of `layer` and all its ancestors.
+    fn accepts(&self, layer: usize, path: &Path) -> bool {
+        let mut current = Some(layer);
+        while let Some(index) = current {
+            let layer = &self.layers[index];
+            if let Some(globs) = &layer.globs {
+                let relative = path.strip_prefix(&layer.dir).unwrap_or(path);
+                if !globs.allows(&relative.to_string_lossy()) {
+                    return false;
+                }
+            }
+            current = layer.parent;
+        }
+        true
+    }
+}
+
+/// The layer governing `dir`, filling the cache for `dir` and any of its
+/// ancestors not seen yet.
+fn layer_of<'a>(dir: &'a Path, cache: &mut HashMap<&'a Path, usize>) -> usize {
+    if let Some(&layer) = cache.get(dir) {
+        return layer;
+    }
+    let layer = dir.parent().map_or(0, |parent| layer_of(parent, cache));
+    cache.insert(dir, layer);
+    layer
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::fs;
+    use tempfile::TempDir;
+
+    fn base() -> ScanArgs {
+        ScanArgs {
+            slug: vec!["REQ".to_string()],
+            ..Default::default()
+        }
+    }
+
+    #[test]
+    fn files_use_their_nearest_config() {
+        let dir = TempDir::new().unwrap();
+        let root = dir.path();
+        fs::create_dir_all(root.join("safety/gen")).unwrap();
+        fs::write(
+            root.join("safety/tracy.toml"),
+            "[scan]\nslug = [\"HAZ\"]\n[filter]\nexclude = [\"gen/**\"]\n",
+        )
+        .unwrap();
+        fs::write(
+            root.join("safety/gen/tracy.toml"),
+            "[scan]\nword_boundary = true\n",
+        )
+        .unwrap();
+
+        let configs = vec![
+            root.join("safety/gen/tracy.toml"),
+            root.join("safety/tracy.toml"),
+        ];
+        let nested = NestedConfigs::load(root, &base(), &CliScan::default(), &configs).unwrap();
+        assert_eq!(nested.layers.len(), 3);
+        assert_eq!(nested.layers[1].dir, root.join("safety"));
+        assert_eq!(nested.layers[2].parent, Some(1));
+        assert_eq!(nested.scanners.len(), 3);
+
+        let paths = vec![
+            root.join("src/lib.rs"),
+            root.join("safety/a/b.rs"),
+            root.join("safety/gen/c.rs"),
+        ];
+        assert_eq!(nested.resolve(&paths), vec![Some(0), Some(1), None]);
+    }
+
+    #[test]
+    fn identical_settings_share_a_scanner() {
+        let dir = TempDir::new().unwrap();
+        let root = dir.path();
+        fs::create_dir_all(root.join("docs")).unwrap();
+        fs::write(root.join("docs/tracy.toml"), "[scan]\nslug = [\"REQ\"]\n").unwrap();
+
+        let nested = NestedConfigs::load(
+            root,
+            &base(),
+            &CliScan::default(),
+            &[root.join("docs/tracy.toml")],
+        )
+        .unwrap();
+        assert_eq!(nested.layers.len(), 2);
+        assert_eq!(nested.scanners.len(), 1);
+    }
+}
@@ -1,7 +1,22 @@
+use crate::aggregate::{AggregateError, Matrix};
+use crate::catalog::Coverage;
 use crate::git::GitMeta;
 use crate::scan::{Entry, ScanResult};
+use crate::stats::{self, Phase};
 use clap::ValueEnum;
 use serde::{Deserialize, Serialize};
+use serde_json::{Map, Value};
+use std::collections::HashSet;
+use thiserror::Error;
+
+#[derive(Debug, Error)]
+pub enum OutputError {
+    #[error("the html format writes a report directory; use html::write_report")]
+    HtmlNeedsDirectory,
+
+    #[error("failed to serialize output: {0}")]
+    Serialize(#[from] serde_json::Error),
+}
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize, ValueEnum)]
 #[serde(rename_all = "lowercase")]
@@ -10,35 +25,129 @@ pub enum OutputFormat {
     Jsonl,
     Csv,
     Sarif,
+    /// Static report directory, written by [`crate::html::write_report`]
+    Html,
+}
+
+impl OutputFormat {
+    /// File extension for the format; `None` for `html`, which writes a
+    /// directory.
+    pub fn extension(self) -> Option<&'static str> {
+        match self {
+            OutputFormat::Json => Some("json"),
+            OutputFormat::Jsonl => Some("jsonl"),
+            OutputFormat::Csv => Some("csv"),
+            OutputFormat::Sarif => Some("sarif"),
+            OutputFormat::Html => None,
+        }
+    }
 }
 
-pub fn format_output(
-    format: OutputFormat,
-    meta: Option<&GitMeta>,
-    results: &ScanResult,
-) -> Result<String, serde_json::Error> {
+/// Scan results together with the optional sections reported alongside them.
+#[derive(Debug, Clone, Copy)]
+pub struct Report<'a> {
+    pub results: &'a ScanResult,
+    pub meta: Option<&'a GitMeta>,
+    pub coverage: Option<&'a Coverage>,
+}
+
+impl<'a> Report<'a> {
+    pub fn new(results: &'a ScanResult) -> Self {
+        Self {
+            results,
+            meta: None,
+            coverage: None,
+        }
+    }
+}
+
+/// Format `report` as a string. The HTML report is a directory rather than
+/// a string, so `html` is an error here.
+pub fn format_output(format: OutputFormat, report: &Report) -> Result<String, OutputError> {
+    let _timer = stats::time(Phase::Output);
+    Ok(match format {
+        OutputFormat::Json => format_json(report)?,
+        OutputFormat::Jsonl => format_jsonl(report)?,
+        OutputFormat::Csv => format_csv(report.meta, report.results),
+        OutputFormat::Sarif => format_sarif(report)?,
+        OutputFormat::Html => return Err(OutputError::HtmlNeedsDirectory),
+    })
+}
+
+/// Format an aggregated matrix: one row per group, one column per dimension
+/// followed by `count` and the `first`/`last` blame timestamps.
+pub fn format_matrix(format: OutputFormat, matrix: &Matrix) -> Result<String, AggregateError> {
+    let _timer = stats::time(Phase::Output);
+    let columns: Vec<&str> = matrix.by.iter().map(|d| d.name()).collect();
+
     match format {
-        OutputFormat::Json => format_json(meta, results),
-        OutputFormat::Jsonl => format_jsonl(meta, results),
-        OutputFormat::Csv => Ok(format_csv(meta, results)),
-        OutputFormat::Sarif => format_sarif(meta, results),
+        OutputFormat::Json | OutputFormat::Jsonl => {
+            let rows = matrix.cells.iter().map(|(key, cell)| {
+                let mut row = Map::new();
+                for (column, value) in columns.iter().zip(key) {
+                    row.insert(column.to_string(), Value::from(value.as_str()));
+                }
+                row.insert("count".to_string(), Value::from(cell.count));
+                if let (Some(first), Some(last)) = (cell.first, cell.last) {
+                    row.insert("first".to_string(), Value::from(first));
+                    row.insert("last".to_string(), Value::from(last));
+                }
+                Value::Object(row)
+            });
+
+            if format == OutputFormat::Jsonl {
+                let lines = rows
+                    .map(|row| serde_json::to_string(&row))
+                    .collect::<Result<Vec<_>, _>>()?;
+                return Ok(lines.join("\n"));
+            }
+
+            let mut out = Map::new();
+            out.insert("by".to_string(), Value::from(columns.clone()));
+            out.insert("rows".to_string(), Value::Array(rows.collect()));
+            Ok(serde_json::to_string_pretty(&out)?)
+        }
+        OutputFormat::Csv => {
+            let mut lines = Vec::with_capacity(matrix.cells.len() + 1);
+            let mut header = columns.clone();
+            header.extend(["count", "first", "last"]);
+            lines.push(header.join(","));
+
+            for (key, cell) in &matrix.cells {
+                let mut row: Vec<String> = key.iter().map(|v| csv_escape(v)).collect();
+                row.push(cell.count.to_string());
+                row.push(cell.first.map(|t| t.to_string()).unwrap_or_default());
+                row.push(cell.last.map(|t| t.to_string()).unwrap_or_default());
+                lines.push(row.join(","));
+            }
+            Ok(lines.join("\n"))
+        }
+        OutputFormat::Sarif | OutputFormat::Html => Err(AggregateError::UnsupportedFormat(format)),
     }
 }
 
-fn format_json(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String, serde_json::Error> {
+fn format_json(report: &Report) -> Result<String, serde_json::Error> {
     #[derive(Serialize)]
     struct JsonReport<'a> {
-        meta: &'a GitMeta,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        meta: Option<&'a GitMeta>,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        coverage: Option<&'a Coverage>,
         results: &'a ScanResult,
     }
 
-    match meta {
-        Some(meta) => serde_json::to_string_pretty(&JsonReport { meta, results }),
-        None => serde_json::to_string_pretty(results),
+    if report.meta.is_none() && report.coverage.is_none() {
+        return serde_json::to_string_pretty(report.results);
     }
+
+    serde_json::to_string_pretty(&JsonReport {
+        meta: report.meta,
+        coverage: report.coverage,
+        results: report.results,
+    })
 }
 
-fn format_jsonl(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String, serde_json::Error> {
+fn format_jsonl(report: &Report) -> Result<String, serde_json::Error> {
     #[derive(Serialize)]
     struct JsonlMeta<'a> {
         #[serde(rename = "type")]
@@ -54,13 +163,20 @@ fn format_jsonl(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String,
         entry: &'a Entry,
     }
 
+    #[derive(Serialize)]
+    struct JsonlCoverage<'a> {
+        #[serde(rename = "type")]
+        kind: &'static str,
+        coverage: &'a Coverage,
+    }
+
     let mut lines = Vec::new();
 
-    if let Some(meta) = meta {
+    if let Some(meta) = report.meta {
         lines.push(serde_json::to_string(&JsonlMeta { kind: "meta", meta })?);
     }
 
-    for (requirement_id, entries) in results {
+    for (requirement_id, entries) in report.results {
         for entry in entries {
             lines.push(serde_json::to_string(&JsonlMatch {
                 kind: "match",
@@ -70,6 +186,13 @@ fn format_jsonl(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String,
         }
     }
 
+    if let Some(coverage) = report.coverage {
+        lines.push(serde_json::to_string(&JsonlCoverage {
+            kind: "coverage",
+            coverage,
+        })?);
+    }
+
     Ok(lines.join("\n"))
 }
 
@@ -87,6 +210,11 @@ fn format_csv(meta: Option<&GitMeta>, results: &ScanResult) -> String {
         "scope",
         "blame",
     ];
+    // Only variant scans get the column, so other CSV output is unchanged
+    let with_variants = results.values().flatten().any(|e| e.variants.is_some());
+    if with_variants {
+        header.push("variants");
+    }
     if meta.is_some() {
         header.extend(["repo_root", "head_sha", "head_ref", "is_dirty"]);
     }
@@ -131,6 +259,9 @@ fn format_csv(meta: Option<&GitMeta>, results: &ScanResult) -> String {
                 scope,
                 blame,
             ];
+            if with_variants {
+                row.push(entry.variants.as_deref().unwrap_or_default().join(";"));
+            }
 
             if let Some(meta) = meta {
                 row.push(meta.repo_root.display().to_string());
@@ -159,7 +290,7 @@ fn csv_escape(value: &str) -> String {
     format!("\"{}\"", value.replace('"', "\"\""))
 }
 
-fn format_sarif(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String, serde_json::Error> {
+fn format_sarif(report: &Report) -> Result<String, serde_json::Error> {
     #[derive(Serialize)]
     struct SarifLog<'a> {
         #[serde(rename = "$schema")]
@@ -212,6 +343,8 @@ fn format_sarif(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String,
         comment_text: &'a str,
         #[serde(skip_serializing_if = "Option::is_none")]
         blame: Option<&'a crate::git::BlameInfo>,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        variants: Option<&'a [String]>,
     }
 
     #[derive(Serialize)]
@@ -243,15 +376,32 @@ fn format_sarif(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String,
         text: String,
     }
 
+    let unknown: HashSet<&str> = report
+        .coverage
+        .map(|c| c.unknown.iter().map(String::as_str).collect())
+        .unwrap_or_default();
+
     let mut sarif_results = Vec::new();
-    for (requirement_id, entries) in results {
+    for (requirement_id, entries) in report.results {
+        let is_unknown = unknown.contains(requirement_id.as_str());
         for entry in entries {
+            let (rule_id, level, text) = if is_unknown {
+                (
+                    "traceability.unknown_requirement",
+                    "warning",
+                    format!("Reference to requirement not in catalog: {requirement_id}"),
+                )
+            } else {
+                (
+                    "traceability.requirement_ref",
+                    "note",
+                    format!("Requirement reference: {requirement_id}"),
+                )
+            };
             sarif_results.push(SarifResult {
-                rule_id: "traceability.requirement_ref",
-                level: "note",
-                message: SarifMessage {
-                    text: format!("Requirement reference: {requirement_id}"),
-                },
+                rule_id,
+                level,
+                message: SarifMessage { text },
                 locations: vec![SarifLocation {
                     physical_location: SarifPhysicalLocation {
                         artifact_location: SarifArtifactLocation {
@@ -266,11 +416,29 @@ fn format_sarif(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String,
                     requirement_id,
                     comment_text: &entry.comment_text,
                     blame: entry.blame.as_ref(),
+                    variants: entry.variants.as_deref(),
                 },
             });
         }
     }
 
+    let mut rules = vec![SarifRule {
+        id: "traceability.requirement_ref",
+        name: "Requirement reference",
+        short_description: SarifMessage {
+            text: "Requirement references found in comments".to_string(),
+        },
+    }];
+    if report.coverage.is_some() {
+        rules.push(SarifRule {
+            id: "traceability.unknown_requirement",
+            name: "Unknown requirement",
+            short_description: SarifMessage {
+                text: "References to requirements missing from the catalog".to_string(),
+            },
+        });
+    }
+
     let sarif = SarifLog {
         schema: "https://schemastore.azurewebsites.net/schemas/json/sarif-2.1.0.json",
         version: "2.1.0",
@@ -279,17 +447,11 @@ fn format_sarif(meta: Option<&GitMeta>, results: &ScanResult) -> Result<String,
                 driver: SarifDriver {
                     name: "tracy",
                     version: env!("CARGO_PKG_VERSION"),
-                    rules: vec![SarifRule {
-                        id: "traceability.requirement_ref",
-                        name: "Requirement reference",
-                        short_description: SarifMessage {
-                            text: "Requirement references found in comments".to_string(),
-                        },
-                    }],
+                    rules,
                 },
             },
             results: sarif_results,
-            properties: meta,
+            properties: report.meta,
         }],
     };
 
@@ -314,16 +476,26 @@ mod tests {
                 below: None,
                 inline: None,
                 scope: Vec::new(),
+                variants: None,
                 blame: None,
             }],
         );
         results
     }
 
+    #[test]
+    fn html_is_not_a_string_format() {
+        let results = one_result();
+        assert!(matches!(
+            format_output(OutputFormat::Html, &Report::new(&results)),
+            Err(OutputError::HtmlNeedsDirectory)
+        ));
+    }
+
     #[test]
     fn json_without_meta_is_plain_results() {
         let results = one_result();
-        let out = format_output(OutputFormat::Json, None, &results).unwrap();
+        let out = format_output(OutputFormat::Json, &Report::new(&results)).unwrap();
         let value: serde_json::Value = serde_json::from_str(&out).unwrap();
         assert!(value.get("REQ-1").is_some());
         assert!(value.get("meta").is_none());
@@ -340,7 +512,11 @@ mod tests {
             is_dirty: false,
         };
 
-        let out = format_output(OutputFormat::Json, Some(&meta), &results).unwrap();
+        let report = Report {
+            meta: Some(&meta),
+            ..Report::new(&results)
+        };
+        let out = format_output(OutputFormat::Json, &report).unwrap();
         let value: serde_json::Value = serde_json::from_str(&out).unwrap();
         assert!(value.get("meta").is_some());
         assert!(value.get("results").is_some());
@@ -357,7 +533,11 @@ mod tests {
             is_dirty: true,
         };
 
-        let out = format_output(OutputFormat::Jsonl, Some(&meta), &results).unwrap();
+        let report = Report {
+            meta: Some(&meta),
+            ..Report::new(&results)
+        };
+        let out = format_output(OutputFormat::Jsonl, &report).unwrap();
         let lines: Vec<&str> = out.split('\n').collect();
         assert_eq!(lines.len(), 2);
 
@@ -376,7 +556,7 @@ mod tests {
         let mut results = one_result();
         results.get_mut("REQ-1").unwrap()[0].comment_text = "// REQ-1, \"quoted\"".to_string();
 
-        let out = format_output(OutputFormat::Csv, None, &results).unwrap();
+        let out = format_output(OutputFormat::Csv, &Report::new(&results)).unwrap();
         let lines: Vec<&str> = out.split('\n').collect();
         assert_eq!(
             lines[0],
@@ -392,7 +572,7 @@ mod tests {
     #[test]
     fn sarif_has_basic_structure() {
         let results = one_result();
-        let out = format_output(OutputFormat::Sarif, None, &results).unwrap();
+        let out = format_output(OutputFormat::Sarif, &Report::new(&results)).unwrap();
         let value: serde_json::Value = serde_json::from_str(&out).unwrap();
         assert_eq!(value["version"], "2.1.0");
 
@@ -411,4 +591,80 @@ mod tests {
             1
         );
     }
+
+    #[test]
+    fn coverage_is_reported_in_json_and_sarif() {
+        let results = one_result();
+        let coverage = Coverage {
+            catalog_size: 2,
+            referenced: 0,
+            unknown: vec!["REQ-1".to_string()],
+            unreferenced: vec!["REQ-7".to_string(), "REQ-8".to_string()],
+        };
+        let report = Report {
+            coverage: Some(&coverage),
+            ..Report::new(&results)
+        };
+
+        let out = format_output(OutputFormat::Json, &report).unwrap();
+        let value: serde_json::Value = serde_json::from_str(&out).unwrap();
+        assert!(value.get("meta").is_none());
+        assert_eq!(value["coverage"]["unknown"][0], "REQ-1");
+        assert_eq!(
+            value["coverage"]["unreferenced"].as_array().unwrap().len(),
+            2
+        );
+        assert!(value["results"].get("REQ-1").is_some());
+
+        let out = format_output(OutputFormat::Sarif, &report).unwrap();
+        let value: serde_json::Value = serde_json::from_str(&out).unwrap();
+        let result = &value["runs"][0]["results"][0];
+        assert_eq!(result["ruleId"], "traceability.unknown_requirement");
+        assert_eq!(result["level"], "warning");
+    }
+
+    #[test]
+    fn matrix_rows_in_json_and_csv() {
+        use crate::aggregate::{Cell, Dimension};
+        use std::collections::BTreeMap;
+
+        let mut cells = BTreeMap::new();
+        cells.insert(
+            vec!["REQ-1".to_string(), "src".to_string()],
+            Cell {
+                count: 3,
+                first: Some(10),
+                last: Some(30),
+            },
+        );
+        cells.insert(
+            vec!["REQ-2".to_string(), "a,b".to_string()],
+            Cell {
+                count: 1,
+                first: None,
+                last: None,
+            },
+        );
+        let matrix = Matrix {
+            by: vec![Dimension::Requirement, Dimension::TopDir],
+            cells,
+        };
+
+        let out = format_matrix(OutputFormat::Json, &matrix).unwrap();
+        let value: serde_json::Value = serde_json::from_str(&out).unwrap();
+        assert_eq!(value["by"][1], "top-dir");
+        assert_eq!(value["rows"][0]["requirement"], "REQ-1");
+        assert_eq!(value["rows"][0]["count"], 3);
+        assert_eq!(value["rows"][0]["last"], 30);
+        assert!(value["rows"][1].get("first").is_none());
+
+        let out = format_matrix(OutputFormat::Csv, &matrix).unwrap();
+        let lines: Vec<&str> = out.lines().collect();
+        assert_eq!(lines[0], "requirement,top-dir,count,first,last");
+        assert_eq!(lines[1], "REQ-1,src,3,10,30");
+        assert_eq!(lines[2], "REQ-2,\"a,b\",1,,");
+
+        assert!(format_matrix(OutputFormat::Sarif, &matrix).is_err());
+        assert!(format_matrix(OutputFormat::Html, &matrix).is_err());
+    }
 }
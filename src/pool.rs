@@ -0,0 +1,101 @@
+//! Scoped worker pool shared by the scanning stages.
+//!
+//! Work items are handed out in index order from a shared counter, each
+//! worker folds its items into its own accumulator, and the accumulators are
+//! returned to the caller to merge. Setting the `stop` flag cancels the
+//! remaining items cooperatively: workers finish the item in hand and exit.
+
+use crate::trace;
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::thread;
+
+/// Number of workers to use for `len` items.
+pub(crate) fn worker_count(len: usize) -> usize {
+    thread::available_parallelism()
+        .map(|n| n.get())
+        .unwrap_or(1)
+        .min(len)
+        .max(1)
+}
+
+/// Run `work` for every index in `0..len` across the worker pool.
+///
+/// Indices are claimed in increasing order, so once `stop` is set every index
+/// below the highest claimed one has been (or is being) processed.
+pub(crate) fn for_each_index<S, I, F>(len: usize, stop: &AtomicBool, init: I, work: F) -> Vec<S>
+where
+    S: Send,
+    I: Fn() -> S + Sync,
+    F: Fn(&mut S, usize) + Sync,
+{
+    let next = AtomicUsize::new(0);
+    let run = || {
+        let _span = trace::span("worker");
+        let mut state = init();
+        while !stop.load(Ordering::Relaxed) {
+            let index = next.fetch_add(1, Ordering::Relaxed);
+            if index >= len {
+                break;
+            }
+            work(&mut state, index);
+        }
+        state
+    };
+
+    let workers = worker_count(len);
+    if workers == 1 {
+        return vec![run()];
+    }
+
+    thread::scope(|scope| {
+        let handles: Vec<_> = (0..workers).map(|_| scope.spawn(run)).collect();
+        handles
+            .into_iter()
+            .map(|h| h.join().unwrap_or_else(|e| std::panic::resume_unwind(e)))
+            .collect()
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn visits_every_index_once() {
+        let stop = AtomicBool::new(false);
+        let states = for_each_index(1000, &stop, Vec::new, |seen: &mut Vec<usize>, i| {
+            seen.push(i)
+        });
+
+        let mut all: Vec<usize> = states.into_iter().flatten().collect();
+        all.sort_unstable();
+        assert_eq!(all, (0..1000).collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn stop_cancels_remaining_work() {
+        let stop = AtomicBool::new(false);
+        let states = for_each_index(
+            10_000,
+            &stop,
+            || 0usize,
+            |count, i| {
+                *count += 1;
+                if i == 10 {
+                    stop.store(true, Ordering::Relaxed);
+                }
+            },
+        );
+
+        let total: usize = states.into_iter().sum();
+        assert!(total < 10_000);
+        assert!(total >= 11);
+    }
+
+    #[test]
+    fn empty_input_runs_no_work() {
+        let stop = AtomicBool::new(false);
+        let states = for_each_index(0, &stop, || 0usize, |count, _| *count += 1);
+        assert_eq!(states, vec![0]);
+    }
+}
@@ -0,0 +1,186 @@
+//! Several scan profiles evaluated in one traversal.
+//!
+//! A profile is a set of scan settings limited to some paths, with its own
+//! output, e.g. `REQ` for `src/**` and `TST` for `tests/**`. All profiles
+//! share one file walk, and each file is read and parsed at most once,
+//! however many profiles apply to it.
+
+use crate::filter::{FilterError, GlobFilters};
+use crate::output::OutputFormat;
+use crate::pool;
+use crate::scan::{self, FileHits, ScanArgs, ScanError, ScanResult, Scanner};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use thiserror::Error;
+
+#[derive(Debug, Error)]
+pub enum ProfileError {
+    #[error("profile {profile:?}: {source}")]
+    Filter {
+        profile: String,
+        source: FilterError,
+    },
+
+    #[error("profile {profile:?}: {source}")]
+    Compile { profile: String, source: ScanError },
+
+    #[error(transparent)]
+    Scan(#[from] ScanError),
+}
+
+/// One `[[profile]]` table, resolved against the top-level settings.
+#[derive(Debug)]
+pub struct Profile {
+    pub name: String,
+    pub format: OutputFormat,
+    pub output: Option<PathBuf>,
+    /// Only files matching one of these globs (all files when empty)
+    pub include: Vec<String>,
+    /// Skip files matching one of these globs
+    pub exclude: Vec<String>,
+    pub scan: ScanArgs,
+}
+
+/// Scan `paths` for every profile on the worker pool.
+///
+/// Returns one result per profile, in the order given, each merged in path
+/// order and cut to that profile's limit.
+pub fn scan_profiles(
+    root: &Path,
+    paths: &[PathBuf],
+    profiles: &[Profile],
+) -> Result<Vec<ScanResult>, ProfileError> {
+    let compiled = profiles
+        .iter()
+        .map(|profile| {
+            let scanner = Scanner::new(&profile.scan).map_err(|e| ProfileError::Compile {
+                profile: profile.name.clone(),
+                source: e,
+            })?;
+            let globs = GlobFilters::new(&profile.include, &profile.exclude).map_err(|e| {
+                ProfileError::Filter {
+                    profile: profile.name.clone(),
+                    source: e,
+                }
+            })?;
+            Ok((scanner, globs))
+        })
+        .collect::<Result<Vec<_>, ProfileError>>()?;
+
+    let stop = AtomicBool::new(false);
+    let per_worker = pool::for_each_index(paths.len(), &stop, Vec::new, |done, index| {
+        let path = &paths[index];
+        let relative = path.strip_prefix(root).unwrap_or(path).to_string_lossy();
+        let (active, scanners): (Vec<usize>, Vec<&Scanner>) = compiled
+            .iter()
+            .enumerate()
+            .filter(|(_, (_, globs))| globs.allows(&relative))
+            .map(|(i, (scanner, _))| (i, scanner))
+            .unzip();
+
+        let result = scan::scan_file_shared(&scanners, root, path);
+        if result.is_err() {
+            stop.store(true, Ordering::Relaxed);
+        }
+        done.push((index, active, result));
+    });
+
+    let mut per_file: Vec<(usize, Vec<usize>, Result<Vec<FileHits>, ScanError>)> =
+        per_worker.into_iter().flatten().collect();
+    per_file.sort_unstable_by_key(|(index, _, _)| *index);
+
+    let mut results: Vec<ScanResult> = profiles.iter().map(|_| ScanResult::new()).collect();
+    let mut remaining: Vec<usize> = profiles
+        .iter()
+        .map(|p| p.scan.limit.unwrap_or(usize::MAX))
+        .collect();
+    for (_, active, hits) in per_file {
+        // Errors past every active profile's limit are ignored
+        if active.iter().all(|&profile| remaining[profile] == 0) {
+            continue;
+        }
+        for (profile, hits) in active.into_iter().zip(hits?) {
+            for (slug, entry) in hits {
+                if remaining[profile] == 0 {
+                    break;
+                }
+                remaining[profile] -= 1;
+                results[profile].entry(slug).or_default().push(entry);
+            }
+        }
+    }
+
+    Ok(results)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn profile(name: &str, slug: &str, include: &[&str]) -> Profile {
+        Profile {
+            name: name.to_string(),
+            format: OutputFormat::Json,
+            output: None,
+            include: include.iter().map(|s| s.to_string()).collect(),
+            exclude: Vec::new(),
+            scan: ScanArgs {
+                slug: vec![slug.to_string()],
+                ..Default::default()
+            },
+        }
+    }
+
+    #[test]
+    fn invalid_profiles_name_the_profile() {
+        let bad_glob = profile("safety", "HAZ", &["src/[**"]);
+        let err = scan_profiles(Path::new("."), &[], &[bad_glob]).unwrap_err();
+        assert!(matches!(err, ProfileError::Filter { ref profile, .. } if profile == "safety"));
+
+        let bad_number = Profile {
+            scan: ScanArgs {
+                slug: vec!["REQ".to_string()],
+                id_number: Some("(".to_string()),
+                ..Default::default()
+            },
+            ..profile("src", "REQ", &[])
+        };
+        let err = scan_profiles(Path::new("."), &[], &[bad_number]).unwrap_err();
+        assert!(matches!(err, ProfileError::Compile { ref profile, .. } if profile == "src"));
+    }
+
+    #[test]
+    fn files_outside_every_profile_are_not_read() {
+        let root = Path::new("/nonexistent-tracy-root");
+        let paths = vec![root.join("docs/a.rs")];
+        let profiles = [profile("src", "REQ", &["src/**"])];
+
+        let results = scan_profiles(root, &paths, &profiles).unwrap();
+        assert_eq!(results.len(), 1);
+        assert!(results[0].is_empty());
+    }
+
+    #[test]
+    fn overlapping_profiles_share_one_parse() {
+        let dir = tempfile::TempDir::new().unwrap();
+        let root = dir.path();
+        std::fs::create_dir_all(root.join("src")).unwrap();
+        std::fs::create_dir_all(root.join("tests")).unwrap();
+        let shared = root.join("src/a.rs");
+        std::fs::write(&shared, "// REQ-1\n// TST-2\nfn a() {}\n").unwrap();
+        std::fs::write(root.join("tests/b.rs"), "// TST-3\nfn b() {}\n").unwrap();
+        let paths = vec![shared.clone(), root.join("tests/b.rs")];
+        let profiles = [
+            profile("src", "REQ", &["src/**"]),
+            profile("all", "TST", &[]),
+        ];
+
+        let results = scan_profiles(root, &paths, &profiles).unwrap();
+        let ids = |result: &ScanResult| result.keys().cloned().collect::<Vec<_>>();
+        assert_eq!(ids(&results[0]), ["REQ-1"]);
+        assert_eq!(ids(&results[1]), ["TST-2", "TST-3"]);
+
+        let parses = scan::SHARED_PARSES.lock().unwrap();
+        assert_eq!(parses.iter().filter(|p| **p == shared).count(), 1);
+    }
+}
@@ -0,0 +1,237 @@
+//! Scanning several roots (e.g. repositories) in one process.
+//!
+//! Every root keeps its own filter, scan settings and output. The roots are
+//! walked concurrently on the shared worker pool, then the files of all
+//! roots are scanned as one batch on the same pool, so a root with many
+//! files spreads over every worker instead of leaving the others idle. The
+//! scan starts once the slowest walk is done. Roots with identical scan
+//! settings share one [`Scanner`], and with it the compiled pattern and the
+//! per-language rule and condition caches.
+//!
+//! An archive cannot be one of several roots; it is scanned on its own.
+
+use crate::filter::{FilterArgs, FilterError, collect_files};
+use crate::output::OutputFormat;
+use crate::pool;
+use crate::scan::{FileHits, ScanArgs, ScanError, ScanResult, Scanner};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use thiserror::Error;
+
+#[derive(Debug, Error)]
+pub enum RootsError {
+    #[error("failed to read roots manifest {path}: {source}")]
+    Manifest {
+        path: PathBuf,
+        source: std::io::Error,
+    },
+
+    #[error("two roots are named {0:?}; rename one of the directories")]
+    DuplicateName(String),
+
+    #[error("root {0} is an archive; archives are scanned on their own, as the only --root")]
+    Archive(PathBuf),
+
+    #[error(
+        "root {root:?}: {section} is not supported in a root's tracy.toml; set it in the top-level config"
+    )]
+    UnsupportedSection { root: String, section: &'static str },
+
+    #[error("root {root:?}: {source}")]
+    Filter { root: String, source: FilterError },
+
+    #[error("root {root:?}: {source}")]
+    Compile { root: String, source: ScanError },
+
+    #[error(transparent)]
+    Scan(#[from] ScanError),
+}
+
+/// One root of a multi-root scan, resolved against its own `tracy.toml`.
+#[derive(Debug)]
+pub struct ScanRoot {
+    /// Directory name, used to label the root's report
+    pub name: String,
+    pub path: PathBuf,
+    pub format: OutputFormat,
+    pub output: Option<PathBuf>,
+    pub filter: FilterArgs,
+    pub scan: ScanArgs,
+}
+
+/// The report name for a root: its directory name.
+pub fn root_name(path: &Path) -> String {
+    path.file_name()
+        .map(|name| name.to_string_lossy().into_owned())
+        .unwrap_or_else(|| path.display().to_string())
+}
+
+/// Read a roots manifest: one directory per line, relative to the manifest,
+/// skipping blank lines and `#` comments.
+pub fn read_manifest(path: &Path) -> Result<Vec<PathBuf>, RootsError> {
+    let content = fs::read_to_string(path).map_err(|e| RootsError::Manifest {
+        path: path.to_path_buf(),
+        source: e,
+    })?;
+    let base = path.parent().unwrap_or_else(|| Path::new("."));
+
+    Ok(content
+        .lines()
+        .map(str::trim)
+        .filter(|line| !line.is_empty() && !line.starts_with('#'))
+        .map(|line| base.join(line))
+        .collect())
+}
+
+/// Walk and scan every root on the worker pool.
+///
+/// Returns one result per root, in the order given, each with paths
+/// relative to its own root and cut to its own limit.
+pub fn scan_roots(roots: &[ScanRoot]) -> Result<Vec<ScanResult>, RootsError> {
+    for (i, root) in roots.iter().enumerate() {
+        if roots[..i].iter().any(|other| other.name == root.name) {
+            return Err(RootsError::DuplicateName(root.name.clone()));
+        }
+    }
+
+    // Roots with the same settings share a scanner
+    let mut scanners: Vec<(&ScanArgs, Scanner)> = Vec::new();
+    let mut scanner_of = Vec::with_capacity(roots.len());
+    for root in roots {
+        let index = match scanners.iter().position(|(args, _)| **args == root.scan) {
+            Some(index) => index,
+            None => {
+                let scanner = Scanner::new(&root.scan).map_err(|e| RootsError::Compile {
+                    root: root.name.clone(),
+                    source: e,
+                })?;
+                scanners.push((&root.scan, scanner));
+                scanners.len() - 1
+            }
+        };
+        scanner_of.push(index);
+    }
+
+    let files = walk_roots(roots)?;
+    let work: Vec<(usize, &Path)> = files
+        .iter()
+        .enumerate()
+        .flat_map(|(root, paths)| paths.iter().map(move |path| (root, path.as_path())))
+        .collect();
+
+    let stop = AtomicBool::new(false);
+    let per_worker = pool::for_each_index(work.len(), &stop, Vec::new, |done, index| {
+        let (root, path) = work[index];
+        let result = scanners[scanner_of[root]]
+            .1
+            .scan_file(&roots[root].path, path);
+        if result.is_err() {
+            stop.store(true, Ordering::Relaxed);
+        }
+        done.push((index, result));
+    });
+
+    let mut per_file: Vec<(usize, Result<FileHits, ScanError>)> =
+        per_worker.into_iter().flatten().collect();
+    per_file.sort_unstable_by_key(|(index, _)| *index);
+
+    let mut results: Vec<ScanResult> = roots.iter().map(|_| ScanResult::new()).collect();
+    let mut remaining: Vec<usize> = roots
+        .iter()
+        .map(|root| root.scan.limit.unwrap_or(usize::MAX))
+        .collect();
+    for (index, hits) in per_file {
+        let root = work[index].0;
+        // Errors past the root's limit are ignored
+        if remaining[root] == 0 {
+            continue;
+        }
+        for (slug, entry) in hits? {
+            if remaining[root] == 0 {
+                break;
+            }
+            remaining[root] -= 1;
+            results[root].entry(slug).or_default().push(entry);
+        }
+    }
+
+    Ok(results)
+}
+
+/// Collect each root's files, walking the roots concurrently.
+fn walk_roots(roots: &[ScanRoot]) -> Result<Vec<Vec<PathBuf>>, RootsError> {
+    let stop = AtomicBool::new(false);
+    let per_worker = pool::for_each_index(roots.len(), &stop, Vec::new, |done, index| {
+        let result = collect_files(&roots[index].path, &roots[index].filter);
+        if result.is_err() {
+            stop.store(true, Ordering::Relaxed);
+        }
+        done.push((index, result));
+    });
+
+    let mut per_root: Vec<(usize, Result<Vec<PathBuf>, FilterError>)> =
+        per_worker.into_iter().flatten().collect();
+    per_root.sort_unstable_by_key(|(index, _)| *index);
+    per_root
+        .into_iter()
+        .map(|(index, files)| {
+            files.map_err(|e| RootsError::Filter {
+                root: roots[index].name.clone(),
+                source: e,
+            })
+        })
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::TempDir;
+
+    fn root(name: &str, path: PathBuf) -> ScanRoot {
+        ScanRoot {
+            name: name.to_string(),
+            path,
+            format: OutputFormat::Json,
+            output: None,
+            filter: FilterArgs::default(),
+            scan: ScanArgs {
+                slug: vec!["REQ".to_string()],
+                ..Default::default()
+            },
+        }
+    }
+
+    #[test]
+    fn manifest_paths_are_relative_to_the_manifest() {
+        let dir = TempDir::new().unwrap();
+        let manifest = dir.path().join("roots.txt");
+        fs::write(&manifest, "# product\nfirmware\n\n../shared/lib\n").unwrap();
+
+        assert_eq!(
+            read_manifest(&manifest).unwrap(),
+            vec![
+                dir.path().join("firmware"),
+                dir.path().join("../shared/lib")
+            ]
+        );
+        assert!(matches!(
+            read_manifest(&dir.path().join("missing.txt")),
+            Err(RootsError::Manifest { .. })
+        ));
+    }
+
+    #[test]
+    fn root_names_must_be_unique() {
+        let roots = [
+            root("app", PathBuf::from("/a/app")),
+            root("app", PathBuf::from("/b/app")),
+        ];
+        assert!(matches!(
+            scan_roots(&roots),
+            Err(RootsError::DuplicateName(name)) if name == "app"
+        ));
+        assert_eq!(root_name(Path::new("/src/firmware")), "firmware");
+    }
+}
@@ -1,6 +1,8 @@
+use super::{ContextRule, MarkerSource, Variant};
 use clap::Args;
+use std::path::PathBuf;
 
-#[derive(Debug, Args)]
+#[derive(Debug, Clone, Default, PartialEq, Args)]
 pub struct ScanArgs {
     #[arg(
         long,
@@ -8,4 +10,87 @@ pub struct ScanArgs {
         help = "Slug pattern to search for (e.g., 'REQ' matches 'REQ-123'). Can be repeated."
     )]
     pub slug: Vec<String>,
+
+    #[arg(
+        long,
+        value_name = "PATH",
+        help = "Read additional slugs from a file (one per line, '#' comments)"
+    )]
+    pub slug_file: Option<PathBuf>,
+
+    #[arg(
+        long,
+        value_name = "CHARS",
+        help = "Characters allowed between slug and number (default: '-')"
+    )]
+    pub id_separator: Option<String>,
+
+    #[arg(
+        long,
+        value_name = "REGEX",
+        help = "Grammar for the number part of an id (default: '\\d+')"
+    )]
+    pub id_number: Option<String>,
+
+    #[arg(long, help = "Allow dotted hierarchical numbers (e.g., 'REQ-12.3.1')")]
+    pub hierarchical: bool,
+
+    #[arg(long, help = "Only match ids delimited by word boundaries")]
+    pub word_boundary: bool,
+
+    #[arg(long, help = "Match slugs case-insensitively")]
+    pub ignore_case: bool,
+
+    #[arg(
+        long,
+        value_name = "ID|RANGE",
+        help = "Only report this id or inclusive id range (e.g., 'REQ-1000..REQ-1999'). Can be repeated."
+    )]
+    pub id: Vec<String>,
+
+    #[arg(
+        long,
+        value_name = "KIND",
+        help = "Only report markers inside a scope of this AST kind (e.g., 'function_item'). Can be repeated."
+    )]
+    pub scope_kind: Vec<String>,
+
+    #[arg(
+        long,
+        value_name = "N",
+        help = "Stop scanning once N matches have been collected"
+    )]
+    pub limit: Option<usize>,
+
+    #[arg(
+        long = "marker",
+        value_name = "LANG=PATTERN",
+        help = "Also scan code matching this ast-grep pattern, e.g. 'cpp=TRACE_REQ($ID)'; ids are taken from $ID if bound. Can be repeated."
+    )]
+    pub markers: Vec<MarkerSource>,
+
+    /// Context rules from `[[context_rule]]` config tables
+    #[arg(skip)]
+    pub context_rules: Vec<ContextRule>,
+
+    #[arg(
+        long = "variant",
+        value_name = "NAME=DEFINES",
+        help = "Tag C/C++ matches with the build variants compiling them (e.g., 'board-a=USE_DMA,UARTS=2'). Can be repeated."
+    )]
+    pub variants: Vec<Variant>,
+
+    #[arg(
+        long,
+        value_name = "DIR",
+        help = "Share per-file results with other runs on this host through a content-addressed cache in DIR"
+    )]
+    pub cache_dir: Option<PathBuf>,
+
+    #[arg(
+        long,
+        value_name = "MB",
+        help = "Evict least recently used cache entries beyond this size (default: 512)"
+    )]
+    pub cache_max_mb: Option<u64>,
 }
@@ -0,0 +1,270 @@
+//! Host-wide, content-addressed cache of per-file scan results.
+//!
+//! Results are keyed by the SHA-256 of the scan settings, the language and
+//! the file content, so worktrees and CI jobs on one host share entries for
+//! identical blobs whatever their paths. The file path is not part of the
+//! entry; it is filled in on load.
+//!
+//! Readers take no locks: an entry is written to a temporary file and
+//! renamed into place, so it is either absent or complete. A hit refreshes
+//! the entry's modification time, and once a scanner that wrote entries is
+//! dropped, the least recently used entries are evicted until the cache fits
+//! its size bound. Cache failures never fail a scan; they count as misses.
+
+use super::{Entry, FileHits, ScanArgs, ScanError};
+use ast_grep_language::SupportLang;
+use sha2::{Digest, Sha256};
+use std::fs::{self, File};
+use std::io;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::SystemTime;
+
+/// Bumped whenever the entry format or the scan output changes shape.
+const FORMAT: &str = "v1";
+
+/// Default size bound.
+pub const DEFAULT_MAX_MB: u64 = 512;
+
+/// Evict down to this share of the bound, so pruning is not needed after
+/// every run.
+const PRUNE_TO_PERCENT: u64 = 90;
+
+/// Distinguishes the temporary files of one process's writers.
+static NEXT_TMP: AtomicU64 = AtomicU64::new(0);
+
+/// An opened cache directory for one set of scan settings.
+#[derive(Debug)]
+pub(super) struct ResultCache {
+    dir: PathBuf,
+    max_bytes: u64,
+    /// Digest of everything besides the content that shapes a file's hits
+    settings: [u8; 32],
+    written: AtomicU64,
+}
+
+impl ResultCache {
+    pub fn open(args: &ScanArgs) -> Result<Option<Self>, ScanError> {
+        let Some(root) = &args.cache_dir else {
+            return Ok(None);
+        };
+        let dir = root.join(FORMAT);
+        fs::create_dir_all(&dir).map_err(|e| ScanError::Cache {
+            path: dir.clone(),
+            source: e,
+        })?;
+
+        // Slug files are already read into `slug`, and neither the cache
+        // location nor the limit changes a file's hits
+        let settings = ScanArgs {
+            slug_file: None,
+            cache_dir: None,
+            cache_max_mb: None,
+            limit: None,
+            ..args.clone()
+        };
+        let mut hasher = Sha256::new();
+        hasher.update(env!("CARGO_PKG_VERSION"));
+        hasher.update(format!("{settings:?}"));
+
+        Ok(Some(Self {
+            dir,
+            max_bytes: args.cache_max_mb.unwrap_or(DEFAULT_MAX_MB) * 1024 * 1024,
+            settings: hasher.finalize().into(),
+            written: AtomicU64::new(0),
+        }))
+    }
+
+    /// Cache key for `source` scanned as `lang`.
+    pub fn key(&self, lang: SupportLang, source: &str) -> String {
+        let mut hasher = Sha256::new();
+        hasher.update(self.settings);
+        hasher.update(lang.to_string());
+        hasher.update([0]);
+        hasher.update(source);
+        hasher
+            .finalize()
+            .iter()
+            .map(|byte| format!("{byte:02x}"))
+            .collect()
+    }
+
+    fn path(&self, key: &str) -> PathBuf {
+        self.dir.join(&key[..2]).join(&key[2..])
+    }
+
+    /// The cached hits for `key`, with their file set to `file`.
+    pub fn get(&self, key: &str, file: &Path) -> Option<FileHits> {
+        let path = self.path(key);
+        let bytes = fs::read(&path).ok()?;
+        let mut hits: Vec<(String, Entry)> = serde_json::from_slice(&bytes).ok()?;
+        for (_, entry) in &mut hits {
+            entry.file = file.to_path_buf();
+        }
+
+        // Recency for eviction; a failed touch only makes the entry older
+        if let Ok(f) = File::options().append(true).open(&path) {
+            let _ = f.set_modified(SystemTime::now());
+        }
+        Some(hits)
+    }
+
+    /// Publish the hits for `key`. Concurrent writers of the same key write
+    /// the same bytes, so whichever rename lands last is as good as any.
+    pub fn put(&self, key: &str, hits: &FileHits) {
+        let Ok(bytes) = serde_json::to_vec(hits) else {
+            return;
+        };
+        let path = self.path(key);
+        if self.publish(&path, &bytes).is_ok() {
+            self.written
+                .fetch_add(bytes.len() as u64, Ordering::Relaxed);
+        }
+    }
+
+    fn publish(&self, path: &Path, bytes: &[u8]) -> io::Result<()> {
+        let dir = path.parent().unwrap_or(&self.dir);
+        fs::create_dir_all(dir)?;
+        let tmp = dir.join(format!(
+            ".tmp-{}-{}",
+            std::process::id(),
+            NEXT_TMP.fetch_add(1, Ordering::Relaxed)
+        ));
+        fs::write(&tmp, bytes)?;
+        fs::rename(&tmp, path).inspect_err(|_| {
+            let _ = fs::remove_file(&tmp);
+        })
+    }
+
+    /// Evict the least recently used entries until the cache is below its
+    /// bound. Entries removed by another process meanwhile are skipped.
+    pub fn prune(&self) -> io::Result<()> {
+        let mut entries = Vec::new();
+        let mut total = 0;
+        for shard in fs::read_dir(&self.dir)? {
+            let shard = shard?;
+            if !shard.file_type()?.is_dir() {
+                continue;
+            }
+            for entry in fs::read_dir(shard.path())? {
+                let Ok(entry) = entry else { continue };
+                let Ok(meta) = entry.metadata() else { continue };
+                if !meta.is_file() {
+                    continue;
+                }
+                total += meta.len();
+                let used = meta.modified().unwrap_or(SystemTime::UNIX_EPOCH);
+                entries.push((used, meta.len(), entry.path()));
+            }
+        }
+        if total <= self.max_bytes {
+            return Ok(());
+        }
+
+        entries.sort_unstable_by(|a, b| a.0.cmp(&b.0));
+        let target = self.max_bytes * PRUNE_TO_PERCENT / 100;
+        for (_, len, path) in entries {
+            if total <= target {
+                break;
+            }
+            match fs::remove_file(&path) {
+                Ok(()) => total -= len,
+                Err(e) if e.kind() == io::ErrorKind::NotFound => total -= len,
+                Err(_) => {}
+            }
+        }
+        Ok(())
+    }
+}
+
+impl Drop for ResultCache {
+    fn drop(&mut self) {
+        if self.written.load(Ordering::Relaxed) > 0 {
+            let _ = self.prune();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::TempDir;
+
+    fn open(dir: &Path, slug: &str, max_mb: u64) -> ResultCache {
+        ResultCache::open(&ScanArgs {
+            slug: vec![slug.to_string()],
+            cache_dir: Some(dir.to_path_buf()),
+            cache_max_mb: Some(max_mb),
+            ..Default::default()
+        })
+        .unwrap()
+        .unwrap()
+    }
+
+    fn entry(line: usize) -> Entry {
+        Entry {
+            file: PathBuf::from("a.rs"),
+            line,
+            comment_text: "// REQ-1".to_string(),
+            above: None,
+            below: None,
+            inline: None,
+            scope: Vec::new(),
+            variants: None,
+            blame: None,
+        }
+    }
+
+    #[test]
+    fn keys_depend_on_settings_language_and_content() {
+        let dir = TempDir::new().unwrap();
+        let req = open(dir.path(), "REQ", 1);
+        let lin = open(dir.path(), "LIN", 1);
+
+        let key = req.key(SupportLang::Rust, "// REQ-1");
+        assert_eq!(key.len(), 64);
+        assert_eq!(key, req.key(SupportLang::Rust, "// REQ-1"));
+        assert_ne!(key, req.key(SupportLang::Rust, "// REQ-2"));
+        assert_ne!(key, req.key(SupportLang::C, "// REQ-1"));
+        assert_ne!(key, lin.key(SupportLang::Rust, "// REQ-1"));
+    }
+
+    #[test]
+    fn hits_round_trip_with_the_callers_path() {
+        let dir = TempDir::new().unwrap();
+        let cache = open(dir.path(), "REQ", 1);
+        let key = cache.key(SupportLang::Rust, "// REQ-1");
+
+        assert!(cache.get(&key, Path::new("x.rs")).is_none());
+        cache.put(&key, &vec![("REQ-1".to_string(), entry(3))]);
+
+        let hits = cache.get(&key, Path::new("other/b.rs")).unwrap();
+        assert_eq!(hits.len(), 1);
+        assert_eq!(hits[0].0, "REQ-1");
+        assert_eq!(hits[0].1.line, 3);
+        assert_eq!(hits[0].1.file, Path::new("other/b.rs"));
+    }
+
+    #[test]
+    fn prune_evicts_least_recently_used_first() {
+        let dir = TempDir::new().unwrap();
+        let mut cache = open(dir.path(), "REQ", 1);
+        let old = cache.key(SupportLang::Rust, "old");
+        let new = cache.key(SupportLang::Rust, "new");
+        cache.put(&old, &vec![("REQ-1".to_string(), entry(1))]);
+        cache.put(&new, &vec![("REQ-1".to_string(), entry(2))]);
+        File::options()
+            .append(true)
+            .open(cache.path(&old))
+            .unwrap()
+            .set_modified(SystemTime::UNIX_EPOCH)
+            .unwrap();
+
+        // Room for one entry only
+        let one = fs::metadata(cache.path(&new)).unwrap().len();
+        cache.max_bytes = one * 100 / PRUNE_TO_PERCENT + 1;
+        cache.prune().unwrap();
+        assert!(!cache.path(&old).exists());
+        assert!(cache.path(&new).exists());
+    }
+}
@@ -0,0 +1,393 @@
+//! Evaluation of C preprocessor `#if` conditions against a set of defines.
+//!
+//! Covers integer constant expressions: literals, object-like macros
+//! (expanded recursively), `defined`, and the usual unary, binary and
+//! ternary operators. Anything else, such as function-like macros or
+//! `__has_include`, makes the value unknown rather than guessing, as does a
+//! macro that may or may not be defined at that point.
+
+use std::collections::{BTreeMap, BTreeSet};
+
+/// Macro expansion depth after which a value is considered unknown.
+const MAX_EXPANSION_DEPTH: usize = 32;
+
+/// Evaluate `expr` with `defines` mapping macro names to replacement text.
+/// Macros in `unknown` may or may not be defined, so any use of them is
+/// unknown.
+///
+/// Returns `None` when the condition cannot be decided.
+pub fn evaluate(
+    expr: &str,
+    defines: &BTreeMap<String, String>,
+    unknown: &BTreeSet<String>,
+) -> Option<bool> {
+    eval_value(expr, defines, unknown, 0).map(|value| value != 0)
+}
+
+/// The identifiers in `text`, such as the macros a condition or a macro
+/// body refers to.
+pub fn identifiers(text: &str) -> impl Iterator<Item = &str> {
+    text.split(|c: char| !c.is_ascii_alphanumeric() && c != '_')
+        .filter(|word| word.starts_with(|c: char| c.is_ascii_alphabetic() || c == '_'))
+}
+
+fn eval_value(
+    expr: &str,
+    defines: &BTreeMap<String, String>,
+    unknown: &BTreeSet<String>,
+    depth: usize,
+) -> Option<i64> {
+    if depth > MAX_EXPANSION_DEPTH {
+        return None;
+    }
+    let tokens = tokenize(expr)?;
+    let mut parser = Parser {
+        tokens: &tokens,
+        pos: 0,
+        defines,
+        unknown,
+        depth,
+    };
+    let value = parser.ternary().ok()?;
+    if parser.pos != tokens.len() {
+        return None;
+    }
+    value
+}
+
+#[derive(Debug, Clone, PartialEq)]
+enum Token<'a> {
+    Number(i64),
+    Ident(&'a str),
+    Punct(&'static str),
+    /// Anything else; only valid inside the arguments of a macro call such
+    /// as `__has_include(<stdio.h>)`
+    Other(char),
+}
+
+/// Operators, longest first so that `<<` wins over `<`.
+const PUNCTUATORS: &[&str] = &[
+    "||", "&&", "==", "!=", "<=", ">=", "<<", ">>", "(", ")", "!", "~", "-", "+", "*", "/", "%",
+    "<", ">", "&", "^", "|", "?", ":",
+];
+
+fn tokenize(expr: &str) -> Option<Vec<Token<'_>>> {
+    let bytes = expr.as_bytes();
+    let mut tokens = Vec::new();
+    let mut i = 0;
+
+    while i < bytes.len() {
+        let c = bytes[i];
+        if c.is_ascii_whitespace() {
+            i += 1;
+        } else if c.is_ascii_alphabetic() || c == b'_' {
+            let start = i;
+            while i < bytes.len() && (bytes[i].is_ascii_alphanumeric() || bytes[i] == b'_') {
+                i += 1;
+            }
+            tokens.push(Token::Ident(&expr[start..i]));
+        } else if c.is_ascii_digit() {
+            let start = i;
+            while i < bytes.len() && (bytes[i].is_ascii_alphanumeric() || bytes[i] == b'_') {
+                i += 1;
+            }
+            tokens.push(Token::Number(parse_number(&expr[start..i])?));
+        } else if let Some(punct) = PUNCTUATORS.iter().find(|p| expr[i..].starts_with(**p)) {
+            tokens.push(Token::Punct(punct));
+            i += punct.len();
+        } else {
+            let other = expr[i..].chars().next()?;
+            tokens.push(Token::Other(other));
+            i += other.len_utf8();
+        }
+    }
+
+    Some(tokens)
+}
+
+/// Parse an integer literal, ignoring `u`/`l` suffixes.
+fn parse_number(literal: &str) -> Option<i64> {
+    let digits = literal.trim_end_matches(['u', 'U', 'l', 'L']);
+    let (digits, radix) = if let Some(hex) = digits
+        .strip_prefix("0x")
+        .or_else(|| digits.strip_prefix("0X"))
+    {
+        (hex, 16)
+    } else if let Some(bin) = digits
+        .strip_prefix("0b")
+        .or_else(|| digits.strip_prefix("0B"))
+    {
+        (bin, 2)
+    } else if digits.len() > 1 && digits.starts_with('0') {
+        (&digits[1..], 8)
+    } else {
+        (digits, 10)
+    };
+    // Literals above i64::MAX wrap, as they would in the preprocessor's
+    // unsigned arithmetic
+    u64::from_str_radix(digits, radix).ok().map(|n| n as i64)
+}
+
+/// Recursive-descent parser that evaluates as it goes.
+///
+/// `Err` is a syntax error; `Ok(None)` is a well-formed expression whose
+/// value is unknown.
+struct Parser<'t, 'a> {
+    tokens: &'t [Token<'a>],
+    pos: usize,
+    defines: &'t BTreeMap<String, String>,
+    unknown: &'t BTreeSet<String>,
+    depth: usize,
+}
+
+type Value = Result<Option<i64>, ()>;
+
+/// Binary operators by precedence, loosest first.
+const BINARY_LEVELS: &[&[&str]] = &[
+    &["||"],
+    &["&&"],
+    &["|"],
+    &["^"],
+    &["&"],
+    &["==", "!="],
+    &["<", ">", "<=", ">="],
+    &["<<", ">>"],
+    &["+", "-"],
+    &["*", "/", "%"],
+];
+
+impl<'a> Parser<'_, 'a> {
+    fn peek(&self) -> Option<&Token<'a>> {
+        self.tokens.get(self.pos)
+    }
+
+    fn eat(&mut self, punct: &str) -> bool {
+        if matches!(self.peek(), Some(Token::Punct(p)) if *p == punct) {
+            self.pos += 1;
+            true
+        } else {
+            false
+        }
+    }
+
+    fn expect(&mut self, punct: &str) -> Result<(), ()> {
+        if self.eat(punct) { Ok(()) } else { Err(()) }
+    }
+
+    fn ternary(&mut self) -> Value {
+        let cond = self.binary(0)?;
+        if !self.eat("?") {
+            return Ok(cond);
+        }
+        let then = self.ternary()?;
+        self.expect(":")?;
+        let otherwise = self.ternary()?;
+        Ok(match cond {
+            Some(c) if c != 0 => then,
+            Some(_) => otherwise,
+            None if then == otherwise => then,
+            None => None,
+        })
+    }
+
+    fn binary(&mut self, level: usize) -> Value {
+        let Some(ops) = BINARY_LEVELS.get(level) else {
+            return self.unary();
+        };
+
+        let mut lhs = self.binary(level + 1)?;
+        while let Some(Token::Punct(op)) = self.peek() {
+            let op = *op;
+            if !ops.contains(&op) {
+                break;
+            }
+            self.pos += 1;
+            let rhs = self.binary(level + 1)?;
+            lhs = apply_binary(op, lhs, rhs);
+        }
+        Ok(lhs)
+    }
+
+    fn unary(&mut self) -> Value {
+        for op in ["!", "~", "-", "+"] {
+            if self.eat(op) {
+                let value = self.unary()?;
+                return Ok(value.map(|v| match op {
+                    "!" => i64::from(v == 0),
+                    "~" => !v,
+                    "-" => v.wrapping_neg(),
+                    _ => v,
+                }));
+            }
+        }
+        self.primary()
+    }
+
+    fn primary(&mut self) -> Value {
+        let token = self.peek().cloned().ok_or(())?;
+        self.pos += 1;
+
+        match token {
+            Token::Number(n) => Ok(Some(n)),
+            Token::Punct("(") => {
+                let value = self.ternary()?;
+                self.expect(")")?;
+                Ok(value)
+            }
+            Token::Ident("defined") => {
+                let parenthesized = self.eat("(");
+                let Some(Token::Ident(name)) = self.peek().cloned() else {
+                    return Err(());
+                };
+                self.pos += 1;
+                if parenthesized {
+                    self.expect(")")?;
+                }
+                if self.unknown.contains(name) {
+                    return Ok(None);
+                }
+                Ok(Some(i64::from(self.defines.contains_key(name))))
+            }
+            Token::Ident(name) => {
+                // A function-like macro call; its arguments still need to be
+                // consumed so the rest of the expression parses
+                if self.eat("(") {
+                    self.skip_call_arguments()?;
+                    return Ok(None);
+                }
+                if self.unknown.contains(name) {
+                    return Ok(None);
+                }
+                match self.defines.get(name) {
+                    Some(value) => Ok(eval_value(
+                        value,
+                        self.defines,
+                        self.unknown,
+                        self.depth + 1,
+                    )),
+                    // Undefined identifiers are 0 in `#if`
+                    None => Ok(Some(0)),
+                }
+            }
+            Token::Punct(_) | Token::Other(_) => Err(()),
+        }
+    }
+
+    fn skip_call_arguments(&mut self) -> Result<(), ()> {
+        let mut open = 1;
+        while open > 0 {
+            match self.peek().ok_or(())? {
+                Token::Punct("(") => open += 1,
+                Token::Punct(")") => open -= 1,
+                _ => {}
+            }
+            self.pos += 1;
+        }
+        Ok(())
+    }
+}
+
+fn apply_binary(op: &str, lhs: Option<i64>, rhs: Option<i64>) -> Option<i64> {
+    // Logical operators can be decided by one known side
+    match op {
+        "||" => {
+            return match (lhs, rhs) {
+                (Some(l), _) if l != 0 => Some(1),
+                (_, Some(r)) if r != 0 => Some(1),
+                (Some(_), Some(_)) => Some(0),
+                _ => None,
+            };
+        }
+        "&&" => {
+            return match (lhs, rhs) {
+                (Some(0), _) | (_, Some(0)) => Some(0),
+                (Some(_), Some(_)) => Some(1),
+                _ => None,
+            };
+        }
+        _ => {}
+    }
+
+    let (l, r) = (lhs?, rhs?);
+    Some(match op {
+        "|" => l | r,
+        "^" => l ^ r,
+        "&" => l & r,
+        "==" => i64::from(l == r),
+        "!=" => i64::from(l != r),
+        "<" => i64::from(l < r),
+        ">" => i64::from(l > r),
+        "<=" => i64::from(l <= r),
+        ">=" => i64::from(l >= r),
+        "<<" => l.wrapping_shl(r as u32),
+        ">>" => l.wrapping_shr(r as u32),
+        "+" => l.wrapping_add(r),
+        "-" => l.wrapping_sub(r),
+        "*" => l.wrapping_mul(r),
+        "/" => l.checked_div(r)?,
+        "%" => l.checked_rem(r)?,
+        _ => return None,
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn defines(pairs: &[(&str, &str)]) -> BTreeMap<String, String> {
+        pairs
+            .iter()
+            .map(|(k, v)| (k.to_string(), v.to_string()))
+            .collect()
+    }
+
+    fn eval(expr: &str, defines: &BTreeMap<String, String>) -> Option<bool> {
+        evaluate(expr, defines, &BTreeSet::new())
+    }
+
+    #[test]
+    fn evaluates_defined_and_arithmetic() {
+        let d = defines(&[
+            ("USE_DMA", "1"),
+            ("UART_COUNT", "(BASE + 1)"),
+            ("BASE", "0x2"),
+        ]);
+
+        assert_eq!(eval("defined(USE_DMA)", &d), Some(true));
+        assert_eq!(eval("defined USE_CAN || !defined USE_DMA", &d), Some(false));
+        assert_eq!(
+            eval("UART_COUNT >= 3 && UART_COUNT << 1 == 6", &d),
+            Some(true)
+        );
+        assert_eq!(eval("MISSING", &d), Some(false));
+        assert_eq!(eval("UART_COUNT > 2 ? 1 : 0", &d), Some(true));
+        assert_eq!(eval("010 == 8 && 1UL", &d), Some(true));
+    }
+
+    #[test]
+    fn unknown_parts_stay_unknown_unless_decided() {
+        let d = defines(&[("LOOP", "LOOP"), ("ON", "1")]);
+
+        assert_eq!(eval("__has_include(<stdio.h>)", &d), None);
+        assert_eq!(eval("__has_include(<stdio.h>) || ON", &d), Some(true));
+        assert_eq!(eval("FEATURE(x) && 0", &d), Some(false));
+        assert_eq!(eval("LOOP", &d), None);
+        assert_eq!(eval("1 / 0", &d), None);
+        assert_eq!(eval("1 +", &d), None);
+        assert_eq!(eval("'a'", &d), None);
+    }
+
+    #[test]
+    fn macros_of_unknown_state_are_unknown() {
+        let d = defines(&[("ON", "1"), ("MAYBE", "1")]);
+        let unknown = BTreeSet::from(["MAYBE".to_string()]);
+
+        assert_eq!(evaluate("defined MAYBE", &d, &unknown), None);
+        assert_eq!(evaluate("MAYBE > 0", &d, &unknown), None);
+        assert_eq!(evaluate("MAYBE || ON", &d, &unknown), Some(true));
+        assert_eq!(
+            identifiers("defined(A_1) && B > 0x10").collect::<Vec<_>>(),
+            ["defined", "A_1", "B"]
+        );
+    }
+}
@@ -9,6 +9,39 @@ pub enum ScanError {
         source: std::io::Error,
     },
 
+    #[error("source {path} is not valid UTF-8")]
+    InvalidUtf8 { path: PathBuf },
+
     #[error("invalid slug pattern: {0}")]
     InvalidPattern(#[from] regex::Error),
+
+    #[error("no slugs to match (every slug is empty)")]
+    NoSlugs,
+
+    #[error("invalid id grammar: {0}")]
+    InvalidIdGrammar(String),
+
+    #[error("invalid id filter {0:?} (expected 'REQ-42' or 'REQ-1..REQ-99')")]
+    InvalidIdFilter(String),
+
+    #[error("invalid marker source {marker:?}: {reason}")]
+    InvalidMarker { marker: String, reason: String },
+
+    #[error("invalid context rule for {kind:?}: {reason}")]
+    InvalidContextRule { kind: String, reason: String },
+
+    #[error("invalid variant {0:?} (expected 'NAME=DEFINE,DEFINE=VALUE,...')")]
+    InvalidVariant(String),
+
+    #[error("failed to open cache directory {path}: {source}")]
+    Cache {
+        path: PathBuf,
+        source: std::io::Error,
+    },
+
+    #[error("failed to parse compilation database {path}: {source}")]
+    CompileCommands {
+        path: PathBuf,
+        source: serde_json::Error,
+    },
 }
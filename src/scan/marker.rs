@@ -0,0 +1,123 @@
+//! Marker sources beyond comments.
+//!
+//! A marker source is an ast-grep pattern such as `TRACE_REQ($ID)` or
+//! `@Requirement($ID)`. Patterns are compiled once per scan and tried on
+//! each node during the same traversal that finds comments, so extra
+//! sources never add a pass over the tree. When the pattern binds `$ID`,
+//! ids are only taken from that node's text; otherwise from the whole match.
+
+use super::ScanError;
+use ast_grep_core::{Doc, MatcherExt, Node, Pattern};
+use ast_grep_language::SupportLang;
+use std::str::FromStr;
+
+/// Meta-variable whose text is searched for ids, when the pattern has it.
+const ID_VAR: &str = "ID";
+
+/// An ast-grep pattern whose matches are scanned for ids.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct MarkerSource {
+    pub lang: SupportLang,
+    pub pattern: String,
+}
+
+impl MarkerSource {
+    /// A marker source for the language named `lang`, e.g. `cpp` or `java`.
+    pub fn new(lang: &str, pattern: &str) -> Result<Self, ScanError> {
+        let lang = lang.trim().parse().map_err(|e| ScanError::InvalidMarker {
+            marker: format!("{lang}={pattern}"),
+            reason: format!("{e}"),
+        })?;
+        Ok(Self {
+            lang,
+            pattern: pattern.trim().to_string(),
+        })
+    }
+}
+
+/// `LANG=PATTERN`, as accepted by `--marker`.
+impl FromStr for MarkerSource {
+    type Err = ScanError;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let (lang, pattern) = s.split_once('=').ok_or_else(|| ScanError::InvalidMarker {
+            marker: s.to_string(),
+            reason: "expected LANG=PATTERN".to_string(),
+        })?;
+        Self::new(lang, pattern)
+    }
+}
+
+/// Compiled marker patterns, grouped by language.
+#[derive(Default)]
+pub(super) struct Markers {
+    by_lang: Vec<(SupportLang, Vec<Pattern>)>,
+}
+
+impl std::fmt::Debug for Markers {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_map()
+            .entries(self.by_lang.iter().map(|(lang, p)| (lang, p.len())))
+            .finish()
+    }
+}
+
+impl Markers {
+    pub fn compile(sources: &[MarkerSource]) -> Result<Self, ScanError> {
+        let mut by_lang: Vec<(SupportLang, Vec<Pattern>)> = Vec::new();
+        for source in sources {
+            let pattern = Pattern::try_new(&source.pattern, source.lang).map_err(|e| {
+                ScanError::InvalidMarker {
+                    marker: format!("{}={}", source.lang, source.pattern),
+                    reason: e.to_string(),
+                }
+            })?;
+            match by_lang.iter_mut().find(|(lang, _)| *lang == source.lang) {
+                Some((_, patterns)) => patterns.push(pattern),
+                None => by_lang.push((source.lang, vec![pattern])),
+            }
+        }
+        Ok(Self { by_lang })
+    }
+
+    /// Patterns to try on files in `lang`.
+    pub fn for_lang(&self, lang: SupportLang) -> &[Pattern] {
+        self.by_lang
+            .iter()
+            .find(|(l, _)| *l == lang)
+            .map_or(&[], |(_, patterns)| patterns)
+    }
+}
+
+/// Text to search for ids if `node` matches one of `patterns`.
+pub(super) fn marker_text<D: Doc>(patterns: &[Pattern], node: &Node<'_, D>) -> Option<String> {
+    patterns.iter().find_map(|pattern| {
+        let matched = pattern.match_node(node.clone())?;
+        let text = match matched.get_env().get_match(ID_VAR) {
+            Some(id) => id.text().to_string(),
+            None => matched.text().to_string(),
+        };
+        Some(text)
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parses_marker_specs() {
+        let marker: MarkerSource = "cpp=TRACE_REQ($ID)".parse().unwrap();
+        assert_eq!(marker.lang, SupportLang::Cpp);
+        assert_eq!(marker.pattern, "TRACE_REQ($ID)");
+
+        assert!(matches!(
+            "TRACE_REQ($ID)".parse::<MarkerSource>(),
+            Err(ScanError::InvalidMarker { .. })
+        ));
+        assert!(matches!(
+            "klingon=x($ID)".parse::<MarkerSource>(),
+            Err(ScanError::InvalidMarker { .. })
+        ));
+    }
+}
@@ -1,28 +1,49 @@
 pub mod args;
+mod cache;
+mod condition;
 mod context;
 mod error;
+mod marker;
+mod pattern;
+mod predicate;
+pub(crate) mod rules;
+mod scanner;
+#[cfg(feature = "async")]
+mod stream;
+mod variant;
 
 pub use args::ScanArgs;
 pub use context::{CodeContext, ScopeItem};
 pub use error::ScanError;
+pub use marker::MarkerSource;
+pub use pattern::{SlugSpelling, compile_pattern};
+pub use rules::ContextRule;
+pub use scanner::{Hits, Scanner, Source};
+#[cfg(feature = "async")]
+pub use stream::{OwnedSource, StreamOptions};
+pub use variant::Variant;
 
 use crate::git::BlameInfo;
+use crate::stats::{self, Phase, Skip};
+use crate::trace;
+use ast_grep_core::{Doc, Node};
 use ast_grep_language::{Language, LanguageExt, SupportLang};
 use context::{extract_block_context, extract_hierarchy};
-use regex::Regex;
-use serde::Serialize;
+use marker::marker_text;
+use serde::{Deserialize, Serialize};
 use std::collections::{BTreeMap, HashSet};
 use std::fs;
 use std::path::{Path, PathBuf};
 
 /// A single reference to a requirement marker found in code.
-#[derive(Debug, Serialize)]
+#[derive(Debug, Serialize, Deserialize)]
 pub struct Entry {
     /// Relative file path from the scan root
     pub file: PathBuf,
     /// 1-indexed line number where the marker was found
     pub line: usize,
-    /// Full aggregated comment text (including adjacent comments in the block)
+    /// Full aggregated comment text (including adjacent comments in the block),
+    /// or the matched code for a `--marker` pattern
     pub comment_text: String,
     /// Code context found above the comment block (first non-comment line above)
     #[serde(skip_serializing_if = "Option::is_none")]
@@ -34,8 +55,12 @@ pub struct Entry {
     #[serde(skip_serializing_if = "Option::is_none")]
     pub inline: Option<CodeContext>,
     /// Scope hierarchy from innermost to outermost (fn → impl → mod → file)
-    #[serde(skip_serializing_if = "Vec::is_empty")]
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
     pub scope: Vec<ScopeItem>,
+    /// Build variants whose preprocessor conditions compile the marker line;
+    /// only set for C and C++ when variants are configured
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub variants: Option<Vec<String>>,
 
     /// Git blame metadata for the marker line
     #[serde(skip_serializing_if = "Option::is_none")]
@@ -44,80 +69,272 @@ pub struct Entry {
 
 pub type ScanResult = BTreeMap<String, Vec<Entry>>;
 
+/// Hits found in a single file, in traversal order.
+pub type FileHits = Vec<(String, Entry)>;
+
+/// Scan `paths` on the worker pool and merge the hits in path order.
+///
+/// Shorthand for [`Scanner::scan_paths`] with a one-off scanner.
 pub fn scan_files(
     root: &Path,
     paths: &[PathBuf],
     args: &ScanArgs,
 ) -> Result<ScanResult, ScanError> {
-    let slugs: Vec<String> = args.slug.iter().map(|s| regex::escape(s)).collect();
-    let pattern = Regex::new(&format!(r"(?:{})-\d+", slugs.join("|")))?;
-    let mut results: ScanResult = BTreeMap::new();
-
-    for path in paths {
-        scan_file(root, path, &pattern, &mut results)?;
-    }
+    Scanner::new(args)?.scan_paths(root, paths)
+}
 
-    Ok(results)
+/// Fold each file's hits into per-worker accumulators.
+///
+/// Shorthand for [`Scanner::fold_paths`] with a one-off scanner.
+pub fn fold_files<S, I, F>(
+    root: &Path,
+    paths: &[PathBuf],
+    args: &ScanArgs,
+    init: I,
+    fold: F,
+) -> Result<Vec<S>, ScanError>
+where
+    S: Send,
+    I: Fn() -> S + Sync,
+    F: Fn(&mut S, FileHits) + Sync,
+{
+    Scanner::new(args)?.fold_paths(root, paths, init, fold)
 }
 
 fn scan_file(
+    scanner: &Scanner,
     root: &Path,
     path: &Path,
-    pattern: &Regex,
-    results: &mut ScanResult,
-) -> Result<(), ScanError> {
+    max_hits: usize,
+) -> Result<FileHits, ScanError> {
     let Some(lang) = SupportLang::from_path(path) else {
-        return Ok(());
+        stats::skip(Skip::UnsupportedLanguage);
+        return Ok(FileHits::new());
     };
+    let relative = path.strip_prefix(root).unwrap_or(path);
+    let _span = trace::file(relative);
 
-    let source = fs::read_to_string(path).map_err(|e| ScanError::ReadFile {
-        path: path.to_path_buf(),
-        source: e,
-    })?;
+    let source = read_source(path)?;
+    Ok(scan_source(scanner, relative, &source, lang, max_hits))
+}
 
+/// Paths parsed by [`scan_file_shared`], so tests can check that a file
+/// shared by several scanners is parsed once.
+#[cfg(test)]
+pub(crate) static SHARED_PARSES: std::sync::Mutex<Vec<PathBuf>> = std::sync::Mutex::new(Vec::new());
+
+/// Scan one file with several scanners, reading and parsing it at most once.
+///
+/// Returns one [`FileHits`] per scanner, in the order given. Scanners whose
+/// prefilter rejects the source add no work beyond the prefilter itself.
+pub fn scan_file_shared(
+    scanners: &[&Scanner],
+    root: &Path,
+    path: &Path,
+) -> Result<Vec<FileHits>, ScanError> {
+    let mut hits: Vec<FileHits> = scanners.iter().map(|_| FileHits::new()).collect();
+    let Some(lang) = SupportLang::from_path(path) else {
+        stats::skip(Skip::UnsupportedLanguage);
+        return Ok(hits);
+    };
+    if scanners.is_empty() {
+        return Ok(hits);
+    }
     let relative = path.strip_prefix(root).unwrap_or(path);
-    let ast_root = lang.ast_grep(&source);
+    let _span = trace::file(relative);
+
+    let source = read_source(path)?;
+    let start = stats::start();
+
+    let wanted: Vec<bool> = {
+        let _timer = stats::time(Phase::Prefilter);
+        scanners
+            .iter()
+            .map(|s| s.predicates.prefilter(&s.pattern, &s.spelling, &source))
+            .collect()
+    };
+    if !wanted.contains(&true) {
+        stats::skip(Skip::NoCandidateId);
+        stats::file_done(start, &lang, source.len());
+        return Ok(hits);
+    }
+
+    #[cfg(test)]
+    SHARED_PARSES.lock().unwrap().push(path.to_path_buf());
+    let ast_root = {
+        let _timer = stats::time(Phase::Parse);
+        lang.ast_grep(&source)
+    };
     let ast_root_node = ast_root.root();
+    for ((scanner, hits), wanted) in scanners.iter().zip(&mut hits).zip(wanted) {
+        if wanted {
+            *hits = scan_tree(scanner, relative, &source, lang, &ast_root_node, usize::MAX);
+        }
+    }
+    stats::file_done(start, &lang, source.len());
+    Ok(hits)
+}
+
+fn read_source(path: &Path) -> Result<String, ScanError> {
+    let _timer = stats::time(Phase::Read);
+    fs::read_to_string(path).map_err(|e| ScanError::ReadFile {
+        path: path.to_path_buf(),
+        source: e,
+    })
+}
+
+/// Scan source text that is already in memory; `file` is recorded as-is in
+/// the entries.
+fn scan_source(
+    scanner: &Scanner,
+    file: &Path,
+    source: &str,
+    lang: SupportLang,
+    max_hits: usize,
+) -> FileHits {
+    let start = stats::start();
+    let hits = scan_source_inner(scanner, file, source, lang, max_hits);
+    stats::file_done(start, &lang, source.len());
+    hits
+}
+
+fn scan_source_inner(
+    scanner: &Scanner,
+    file: &Path,
+    source: &str,
+    lang: SupportLang,
+    max_hits: usize,
+) -> FileHits {
+    let candidate = {
+        let _timer = stats::time(Phase::Prefilter);
+        scanner
+            .predicates
+            .prefilter(&scanner.pattern, &scanner.spelling, source)
+    };
+    if !candidate {
+        stats::skip(Skip::NoCandidateId);
+        return FileHits::new();
+    }
+
+    let Some(cache) = &scanner.cache else {
+        let ast_root = {
+            let _timer = stats::time(Phase::Parse);
+            lang.ast_grep(source)
+        };
+        return scan_tree(scanner, file, source, lang, &ast_root.root(), max_hits);
+    };
+
+    // Only complete results are cached; a limited scan takes a prefix
+    let key = cache.key(lang, source);
+    let cached = cache.get(&key, file);
+    stats::cache_lookup(cached.is_some());
+    let mut hits = match cached {
+        Some(hits) => hits,
+        None => {
+            let ast_root = {
+                let _timer = stats::time(Phase::Parse);
+                lang.ast_grep(source)
+            };
+            let hits = scan_tree(scanner, file, source, lang, &ast_root.root(), usize::MAX);
+            cache.put(&key, &hits);
+            hits
+        }
+    };
+    hits.truncate(max_hits);
+    hits
+}
+
+/// Collect the hits in an already parsed source.
+fn scan_tree<D: Doc>(
+    scanner: &Scanner,
+    file: &Path,
+    source: &str,
+    lang: SupportLang,
+    ast_root_node: &Node<'_, D>,
+    max_hits: usize,
+) -> FileHits {
+    let Scanner {
+        pattern,
+        spelling,
+        predicates,
+        markers,
+        context,
+        variants,
+        ..
+    } = scanner;
+    let _timer = stats::time(Phase::Match);
+    let mut hits = FileHits::new();
+
     let source_lines: Vec<&str> = source.lines().collect();
     let mut seen: HashSet<(String, usize)> = HashSet::new();
+    let marker_patterns = markers.for_lang(lang);
+    let rules = context.for_lang(lang);
 
-    for node in ast_root_node.dfs() {
+    // Comments and marker patterns are checked in the same traversal
+    'nodes: for node in ast_root_node.dfs() {
         let kind = node.kind();
         let kind_str: &str = &kind;
-        if !is_comment(kind_str) {
+        // Markers are searched in their `$ID` capture but reported whole
+        let (text, marker) = if is_comment(kind_str) {
+            (node.text().to_string(), None)
+        } else if let Some(id_text) = marker_text(marker_patterns, &node) {
+            (node.text().to_string(), Some(id_text))
+        } else {
             continue;
-        }
+        };
 
         let start_pos = node.start_pos();
         let line_0indexed = start_pos.line();
         let line = line_0indexed + 1; // Convert to 1-indexed for output
-        let text = node.text().to_string();
 
-        for m in pattern.find_iter(&text) {
-            let slug = m.as_str().to_string();
+        for m in pattern.find_iter(marker.as_deref().unwrap_or(&text)) {
+            let slug = spelling.canonical(m.as_str()).into_owned();
+
+            if !predicates.matches_id(&slug) {
+                continue;
+            }
 
             if seen.insert((slug.clone(), line)) {
+                // Extract scope hierarchy first so scope predicates can reject
+                // the hit before the more expensive block context walk
+                let scope = {
+                    let _timer = stats::time(Phase::Scope);
+                    extract_hierarchy(ast_root_node, line_0indexed, &rules)
+                };
+                if !predicates.matches_scope(&scope) {
+                    continue;
+                }
+
                 // Extract block context (above/below/inline code)
-                let block_ctx = extract_block_context(&ast_root_node, line_0indexed, &source_lines);
-
-                // Extract scope hierarchy
-                let scope = extract_hierarchy(&ast_root_node, line_0indexed);
-
-                results.entry(slug).or_default().push(Entry {
-                    file: relative.to_path_buf(),
-                    line,
-                    comment_text: text.clone(),
-                    above: block_ctx.above,
-                    below: block_ctx.below,
-                    inline: block_ctx.inline,
-                    scope,
-                    blame: None,
-                });
+                let block_ctx = {
+                    let _timer = stats::time(Phase::Context);
+                    extract_block_context(ast_root_node, line_0indexed, &source_lines, &rules)
+                };
+
+                hits.push((
+                    slug,
+                    Entry {
+                        file: file.to_path_buf(),
+                        line,
+                        comment_text: text.clone(),
+                        above: block_ctx.above,
+                        below: block_ctx.below,
+                        inline: block_ctx.inline,
+                        scope,
+                        variants: None,
+                        blame: None,
+                    },
+                ));
+
+                if hits.len() >= max_hits {
+                    break 'nodes;
+                }
             }
         }
     }
 
-    Ok(())
+    variants.tag(lang, source, &mut hits);
+    hits
 }
 
 fn is_comment(kind: &str) -> bool {
@@ -139,6 +356,7 @@ mod tests {
     fn scan_args(slug: &str) -> ScanArgs {
         ScanArgs {
             slug: vec![slug.to_string()],
+            ..Default::default()
         }
     }
 
@@ -330,6 +548,26 @@ def foo(): pass"#,
         assert!(results.contains_key("REQ-610"));
     }
 
+    #[test]
+    fn finds_ids_in_marker_patterns() {
+        let file = create_temp_file(
+            ".cpp",
+            "void f() {\n  TRACE_REQ(REQ_12);\n  other(REQ_13);\n}\n// REQ_14\n",
+        );
+        let root = file.path().parent().unwrap();
+        let args = ScanArgs {
+            id_separator: Some("_".to_string()),
+            markers: vec!["cpp=TRACE_REQ($ID)".parse().unwrap()],
+            ..scan_args("REQ")
+        };
+        let results = scan_files(root, &[file.path().to_path_buf()], &args).unwrap();
+
+        assert_eq!(results["REQ_12"][0].line, 2);
+        assert_eq!(results["REQ_12"][0].comment_text, "TRACE_REQ(REQ_12)");
+        assert!(!results.contains_key("REQ_13"));
+        assert!(results.contains_key("REQ_14"));
+    }
+
     // ==================== Edge cases: duplicates ====================
 
     #[test]
@@ -616,6 +854,7 @@ def foo(): pass"#,
         let root = file.path().parent().unwrap();
         let args = ScanArgs {
             slug: vec!["REQ".to_string(), "LIN".to_string(), "FEAT".to_string()],
+            ..Default::default()
         };
         let results = scan_files(root, &[file.path().to_path_buf()], &args).unwrap();
 
@@ -630,6 +869,7 @@ def foo(): pass"#,
         let root = file.path().parent().unwrap();
         let args = ScanArgs {
             slug: vec!["REQ".to_string(), "LIN".to_string()],
+            ..Default::default()
         };
         let results = scan_files(root, &[file.path().to_path_buf()], &args).unwrap();
 
@@ -828,6 +1068,33 @@ def foo(): pass"#,
         assert!(has_outer, "scope should include outer function");
     }
 
+    #[test]
+    fn configured_rule_overrides_builtin() {
+        let file = create_temp_file(".rs", "fn outer() {\n    let x = 1; // REQ-1\n}");
+        let root = file.path().parent().unwrap();
+        let files = [file.path().to_path_buf()];
+        let in_scope = |args: &ScanArgs| {
+            let results = scan_files(root, &files, args).unwrap();
+            results["REQ-1"][0]
+                .scope
+                .iter()
+                .any(|s| s.kind == "function_item")
+        };
+        assert!(in_scope(&scan_args("REQ")));
+
+        let args = ScanArgs {
+            context_rules: vec![ContextRule {
+                scope: false,
+                ..ContextRule::new("function_item")
+            }],
+            ..scan_args("REQ")
+        };
+        assert!(
+            !in_scope(&args),
+            "the configured rule should drop the function from scope"
+        );
+    }
+
     #[test]
     fn extracts_scope_inside_impl() {
         let file = create_temp_file(
@@ -928,6 +1195,89 @@ def foo(): pass"#,
         assert!(entry.comment_text.contains("first line"));
     }
 
+    // ==================== Scan predicates ====================
+
+    #[test]
+    fn id_range_drops_hits_outside_range() {
+        let file = create_temp_file(".rs", "/// REQ-5 REQ-15 REQ-25\nfn x() {}");
+        let root = file.path().parent().unwrap();
+        let args = ScanArgs {
+            slug: vec!["REQ".to_string()],
+            id: vec!["REQ-10..REQ-20".to_string()],
+            ..Default::default()
+        };
+        let results = scan_files(root, &[file.path().to_path_buf()], &args).unwrap();
+
+        assert_eq!(results.len(), 1);
+        assert!(results.contains_key("REQ-15"));
+    }
+
+    #[test]
+    fn scope_kind_keeps_only_nested_hits() {
+        let file = create_temp_file(
+            ".rs",
+            "// REQ-1: top level\nfn run() {\n    // REQ-2: inside\n    let x = 1;\n}",
+        );
+        let root = file.path().parent().unwrap();
+        let args = ScanArgs {
+            slug: vec!["REQ".to_string()],
+            scope_kind: vec!["function_item".to_string()],
+            ..Default::default()
+        };
+        let results = scan_files(root, &[file.path().to_path_buf()], &args).unwrap();
+
+        assert!(!results.contains_key("REQ-1"));
+        assert!(results.contains_key("REQ-2"));
+    }
+
+    #[test]
+    fn limit_keeps_first_hits_in_path_order() {
+        let file1 = create_temp_file(".rs", "/// REQ-1\n/// REQ-2\nfn a() {}");
+        let file2 = create_temp_file(".rs", "/// REQ-3\nfn b() {}");
+        let root = file1.path().parent().unwrap();
+        let args = ScanArgs {
+            slug: vec!["REQ".to_string()],
+            limit: Some(2),
+            ..Default::default()
+        };
+        let paths = [file1.path().to_path_buf(), file2.path().to_path_buf()];
+        let results = scan_files(root, &paths, &args).unwrap();
+
+        assert_eq!(results.len(), 2);
+        assert!(results.contains_key("REQ-1"));
+        assert!(results.contains_key("REQ-2"));
+    }
+
+    #[test]
+    fn limit_ignores_errors_past_the_limit() {
+        let file = create_temp_file(".rs", "/// REQ-1\n/// REQ-2\nfn a() {}");
+        let root = file.path().parent().unwrap();
+        let args = ScanArgs {
+            slug: vec!["REQ".to_string()],
+            limit: Some(2),
+            ..Default::default()
+        };
+        let paths = [file.path().to_path_buf(), root.join("zz-missing.rs")];
+        let results = scan_files(root, &paths, &args).unwrap();
+
+        assert_eq!(results.len(), 2);
+    }
+
+    #[test]
+    fn scans_in_memory_sources_without_files() {
+        let scanner = Scanner::new(&scan_args("REQ")).unwrap();
+        let sources = [
+            Source::new(Path::new("src/a.rs"), b"/// REQ-1\nfn a() {}"),
+            Source::new(Path::new("review/b"), b"# REQ-2\nx = 1\n").with_lang(SupportLang::Python),
+        ];
+        let results = scanner.scan_sources(&sources).unwrap();
+
+        assert_eq!(results["REQ-1"][0].file, PathBuf::from("src/a.rs"));
+        assert!(results["REQ-1"][0].below.is_some());
+        assert_eq!(results["REQ-2"][0].file, PathBuf::from("review/b"));
+        assert_eq!(results["REQ-2"][0].line, 1);
+    }
+
     // ==================== Comment block context ====================
 
     #[test]
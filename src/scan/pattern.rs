@@ -0,0 +1,266 @@
+//! Requirement id pattern compilation.
+//!
+//! All slugs and the id grammar are compiled into a single [`Regex`]. The
+//! regex engine turns the slug alternation into a literal prefilter
+//! (Aho-Corasick/Teddy) in front of a lazy DFA, so matching cost grows with
+//! the input size rather than with the number of slugs.
+
+use super::{ScanArgs, ScanError};
+use regex::{Regex, RegexBuilder};
+use std::borrow::Cow;
+use std::collections::HashMap;
+
+/// Default grammar for the numeric part of an id.
+const DEFAULT_NUMBER: &str = r"\d+";
+
+/// Compiled program size limit; large slug sets need more than the default.
+const SIZE_LIMIT: usize = 64 * 1024 * 1024;
+
+/// Lazy DFA cache size, large enough to keep big slug sets from thrashing.
+const DFA_SIZE_LIMIT: usize = 32 * 1024 * 1024;
+
+/// Build the id matcher for the slugs and id grammar in `args`.
+pub fn compile_pattern(args: &ScanArgs) -> Result<Regex, ScanError> {
+    Ok(RegexBuilder::new(&pattern_source(args)?)
+        .size_limit(SIZE_LIMIT)
+        .dfa_size_limit(DFA_SIZE_LIMIT)
+        .build()?)
+}
+
+/// The configured spelling of each slug, for ids matched with
+/// `ignore_case`: `req-1`, `Req-1` and `REQ-1` are all reported as `REQ-1`,
+/// so result keys, `--id` filters and catalogs agree whatever the source
+/// spells.
+#[derive(Debug, Default)]
+pub struct SlugSpelling {
+    /// Configured slugs by their lowercase spelling
+    by_lowercase: HashMap<String, String>,
+    /// Distinct slug lengths, longest first
+    lengths: Vec<usize>,
+}
+
+impl SlugSpelling {
+    /// The spellings of the slugs in `args`; empty unless `ignore_case` is set.
+    pub fn new(args: &ScanArgs) -> Self {
+        if !args.ignore_case {
+            return Self::default();
+        }
+        let mut by_lowercase = HashMap::new();
+        let mut lengths = Vec::new();
+        for slug in args.slug.iter().map(|s| s.trim()).filter(|s| !s.is_empty()) {
+            by_lowercase
+                .entry(slug.to_lowercase())
+                .or_insert_with(|| slug.to_string());
+            lengths.push(slug.len());
+        }
+        // Same preference as the pattern: the longest slug wins
+        lengths.sort_unstable_by(|a, b| b.cmp(a));
+        lengths.dedup();
+        Self {
+            by_lowercase,
+            lengths,
+        }
+    }
+
+    /// `id` with its slug spelled as configured; unchanged when it starts
+    /// with no configured slug or `ignore_case` is off.
+    pub fn canonical<'a>(&self, id: &'a str) -> Cow<'a, str> {
+        for &len in &self.lengths {
+            let Some((prefix, rest)) = id.split_at_checked(len) else {
+                continue;
+            };
+            if let Some(slug) = self.by_lowercase.get(&prefix.to_lowercase()) {
+                return if slug == prefix {
+                    Cow::Borrowed(id)
+                } else {
+                    Cow::Owned(format!("{slug}{rest}"))
+                };
+            }
+        }
+        Cow::Borrowed(id)
+    }
+}
+
+fn pattern_source(args: &ScanArgs) -> Result<String, ScanError> {
+    let mut slugs: Vec<&str> = args
+        .slug
+        .iter()
+        .map(|s| s.trim())
+        .filter(|s| !s.is_empty())
+        .collect();
+    // Prefer the longest slug when several could start at the same position
+    // (`SWR-ECU` over `SWR`)
+    slugs.sort_unstable_by(|a, b| b.len().cmp(&a.len()).then(a.cmp(b)));
+    slugs.dedup();
+    // An empty alternation would match the separator and number alone
+    if slugs.is_empty() {
+        return Err(ScanError::NoSlugs);
+    }
+
+    let slugs = slugs
+        .iter()
+        .map(|s| regex::escape(s))
+        .collect::<Vec<_>>()
+        .join("|");
+    let slugs = if args.ignore_case {
+        format!("(?i:{slugs})")
+    } else {
+        format!("(?:{slugs})")
+    };
+
+    let separator = separator_source(args.id_separator.as_deref().unwrap_or("-"))?;
+
+    let number = args.id_number.as_deref().unwrap_or(DEFAULT_NUMBER);
+    let number = if args.hierarchical {
+        format!(r"(?:{number})(?:\.(?:{number}))*")
+    } else {
+        format!("(?:{number})")
+    };
+
+    // ASCII word boundaries keep the whole pattern on the DFA fast path
+    let boundary = if args.word_boundary { r"(?-u:\b)" } else { "" };
+
+    Ok(format!("{boundary}{slugs}{separator}{number}{boundary}"))
+}
+
+fn separator_source(chars: &str) -> Result<String, ScanError> {
+    let mut chars: Vec<char> = chars.chars().collect();
+    chars.sort_unstable();
+    chars.dedup();
+
+    match chars.as_slice() {
+        [] => Err(ScanError::InvalidIdGrammar(
+            "id separator must not be empty".to_string(),
+        )),
+        [c] => Ok(regex::escape(&c.to_string())),
+        _ => Ok(format!(
+            "[{}]",
+            chars
+                .iter()
+                .map(|c| regex::escape(&c.to_string()))
+                .collect::<String>()
+        )),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn matches(args: &ScanArgs, text: &str) -> Vec<String> {
+        compile_pattern(args)
+            .unwrap()
+            .find_iter(text)
+            .map(|m| m.as_str().to_string())
+            .collect()
+    }
+
+    fn slugs(slugs: &[&str]) -> ScanArgs {
+        ScanArgs {
+            slug: slugs.iter().map(|s| s.to_string()).collect(),
+            ..Default::default()
+        }
+    }
+
+    #[test]
+    fn default_grammar_matches_slug_hyphen_number() {
+        let args = slugs(&["REQ", "LIN"]);
+        assert_eq!(
+            matches(&args, "REQ-1 LIN-22 REQ-abc req-3 MYREQ-4"),
+            vec!["REQ-1", "LIN-22", "REQ-4"]
+        );
+    }
+
+    #[test]
+    fn hierarchical_numbers_keep_dotted_segments() {
+        let args = ScanArgs {
+            hierarchical: true,
+            ..slugs(&["SWR-ECU", "SWR"])
+        };
+        assert_eq!(
+            matches(&args, "SWR-ECU-0012.3, SWR-7. and SWR-1.2.3"),
+            vec!["SWR-ECU-0012.3", "SWR-7", "SWR-1.2.3"]
+        );
+    }
+
+    #[test]
+    fn custom_separator_and_number_grammar() {
+        let args = ScanArgs {
+            id_separator: Some("_-".to_string()),
+            id_number: Some(r"\d+[a-z]?".to_string()),
+            ..slugs(&["SYS_REQ"])
+        };
+        assert_eq!(
+            matches(&args, "SYS_REQ_12a SYS_REQ-7 SYS_REQ 9"),
+            vec!["SYS_REQ_12a", "SYS_REQ-7"]
+        );
+    }
+
+    #[test]
+    fn word_boundary_rejects_embedded_ids() {
+        let args = ScanArgs {
+            word_boundary: true,
+            ..slugs(&["REQ"])
+        };
+        assert_eq!(
+            matches(&args, "MYREQ-1 REQ-2 REQ-3x (REQ-4)"),
+            vec!["REQ-2", "REQ-4"]
+        );
+    }
+
+    #[test]
+    fn ignore_case_reports_the_configured_slug_spelling() {
+        let args = ScanArgs {
+            ignore_case: true,
+            ..slugs(&["Req", "SWR-ECU"])
+        };
+        let spelling = SlugSpelling::new(&args);
+        let canonical: Vec<String> = matches(&args, "req-1 Req-2 REQ-3 swr-ecu-4 x_1")
+            .iter()
+            .map(|id| spelling.canonical(id).into_owned())
+            .collect();
+        assert_eq!(canonical, vec!["Req-1", "Req-2", "Req-3", "SWR-ECU-4"]);
+    }
+
+    #[test]
+    fn spelling_is_left_alone_without_ignore_case() {
+        let spelling = SlugSpelling::new(&slugs(&["REQ"]));
+        assert_eq!(spelling.canonical("req-1"), "req-1");
+    }
+
+    #[test]
+    fn compiles_thousands_of_slugs_into_one_pattern() {
+        let keys: Vec<String> = (0..2500).map(|i| format!("PRJ{i}")).collect();
+        let args = ScanArgs {
+            slug: keys,
+            word_boundary: true,
+            ..Default::default()
+        };
+        assert_eq!(
+            matches(&args, "see PRJ0-1, PRJ2499-7 and PRJ2500-3"),
+            vec!["PRJ0-1", "PRJ2499-7"]
+        );
+    }
+
+    #[test]
+    fn blank_slug_set_is_rejected() {
+        for set in [&[][..], &["", "  "][..]] {
+            assert!(matches!(
+                compile_pattern(&slugs(set)),
+                Err(ScanError::NoSlugs)
+            ));
+        }
+    }
+
+    #[test]
+    fn empty_separator_is_rejected() {
+        let args = ScanArgs {
+            id_separator: Some(String::new()),
+            ..slugs(&["REQ"])
+        };
+        assert!(matches!(
+            compile_pattern(&args),
+            Err(ScanError::InvalidIdGrammar(_))
+        ));
+    }
+}
@@ -0,0 +1,246 @@
+//! Scan-time predicates.
+//!
+//! Predicates from `--id` and `--scope-kind` are compiled once and applied
+//! while scanning, so non-matching hits are dropped before any context is
+//! extracted and files without a possible match are never parsed.
+
+use super::{ScanArgs, ScanError, ScopeItem, SlugSpelling};
+use regex::Regex;
+
+/// Compiled id and scope predicates for a scan.
+#[derive(Debug, Default)]
+pub struct Predicates {
+    ids: Vec<IdPredicate>,
+    scope_kinds: Vec<String>,
+}
+
+#[derive(Debug)]
+enum IdPredicate {
+    /// A single id, e.g. `REQ-42`
+    Exact(String),
+    /// An inclusive range sharing one prefix, e.g. `REQ-1000..REQ-1999`
+    Range {
+        prefix: String,
+        start: Vec<u64>,
+        end: Vec<u64>,
+    },
+}
+
+impl Predicates {
+    pub fn compile(args: &ScanArgs) -> Result<Self, ScanError> {
+        // Matched ids are compared in their configured slug spelling
+        let spelling = SlugSpelling::new(args);
+        let ids = args
+            .id
+            .iter()
+            .map(|filter| parse_id_predicate(filter, &spelling))
+            .collect::<Result<Vec<_>, _>>()?;
+
+        Ok(Self {
+            ids,
+            scope_kinds: args.scope_kind.clone(),
+        })
+    }
+
+    /// Whether a matched id passes the id predicates.
+    pub fn matches_id(&self, id: &str) -> bool {
+        if self.ids.is_empty() {
+            return true;
+        }
+
+        let parsed = split_id(id);
+        self.ids.iter().any(|p| match p {
+            IdPredicate::Exact(exact) => exact == id,
+            IdPredicate::Range { prefix, start, end } => parsed
+                .as_ref()
+                .is_some_and(|(p, n)| p == prefix && start <= n && n <= end),
+        })
+    }
+
+    /// Whether a scope chain contains one of the requested scope kinds.
+    pub fn matches_scope(&self, scope: &[ScopeItem]) -> bool {
+        self.scope_kinds.is_empty()
+            || scope
+                .iter()
+                .any(|item| self.scope_kinds.iter().any(|k| k == &item.kind))
+    }
+
+    /// Cheap check on the raw source before parsing.
+    ///
+    /// Comment and marker text are substrings of the source, so a file whose
+    /// raw text contains no accepted id cannot produce a hit.
+    pub fn prefilter(&self, pattern: &Regex, spelling: &SlugSpelling, source: &str) -> bool {
+        pattern
+            .find_iter(source)
+            .any(|m| self.matches_id(&spelling.canonical(m.as_str())))
+    }
+}
+
+fn parse_id_predicate(filter: &str, spelling: &SlugSpelling) -> Result<IdPredicate, ScanError> {
+    let invalid = || ScanError::InvalidIdFilter(filter.to_string());
+
+    let Some((lo, hi)) = filter.split_once("..") else {
+        if filter.trim().is_empty() {
+            return Err(invalid());
+        }
+        return Ok(IdPredicate::Exact(
+            spelling.canonical(filter.trim()).into_owned(),
+        ));
+    };
+
+    let (lo, hi) = (spelling.canonical(lo.trim()), spelling.canonical(hi.trim()));
+    let (lo_prefix, start) = split_id(&lo).ok_or_else(invalid)?;
+    let (hi_prefix, end) = split_id(&hi).ok_or_else(invalid)?;
+    if lo_prefix != hi_prefix || start > end {
+        return Err(invalid());
+    }
+
+    Ok(IdPredicate::Range {
+        prefix: lo_prefix.to_string(),
+        start,
+        end,
+    })
+}
+
+/// Split an id into its prefix (slug plus separator) and numeric segments.
+///
+/// `REQ-0012` becomes `("REQ-", [12])` and `SWR-ECU-4.2` becomes
+/// `("SWR-ECU-", [4, 2])`. Trailing non-numeric suffixes are ignored.
+fn split_id(id: &str) -> Option<(&str, Vec<u64>)> {
+    let split = id
+        .char_indices()
+        .filter(|(_, c)| !c.is_ascii_alphanumeric() && *c != '.')
+        .map(|(i, c)| i + c.len_utf8())
+        .last()?;
+    let (prefix, rest) = id.split_at(split);
+
+    let mut segments = Vec::new();
+    for part in rest.split('.') {
+        let digits = part.len() - part.trim_start_matches(|c: char| c.is_ascii_digit()).len();
+        if digits == 0 {
+            break;
+        }
+        segments.push(part[..digits].parse().ok()?);
+        if digits != part.len() {
+            break;
+        }
+    }
+
+    if segments.is_empty() {
+        None
+    } else {
+        Some((prefix, segments))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn predicates(ids: &[&str], scope_kinds: &[&str]) -> Predicates {
+        Predicates::compile(&ScanArgs {
+            slug: vec!["REQ".to_string()],
+            id: ids.iter().map(|s| s.to_string()).collect(),
+            scope_kind: scope_kinds.iter().map(|s| s.to_string()).collect(),
+            ..Default::default()
+        })
+        .unwrap()
+    }
+
+    #[test]
+    fn splits_ids_into_prefix_and_number() {
+        assert_eq!(split_id("REQ-0012"), Some(("REQ-", vec![12])));
+        assert_eq!(split_id("ABC123-456"), Some(("ABC123-", vec![456])));
+        assert_eq!(split_id("SWR-ECU-0012.3"), Some(("SWR-ECU-", vec![12, 3])));
+        assert_eq!(split_id("SYS_REQ_12a"), Some(("SYS_REQ_", vec![12])));
+        assert_eq!(split_id("REQ-abc"), None);
+        assert_eq!(split_id("REQ"), None);
+    }
+
+    #[test]
+    fn empty_predicates_accept_everything() {
+        let preds = predicates(&[], &[]);
+        assert!(preds.matches_id("REQ-1"));
+        assert!(preds.matches_scope(&[]));
+    }
+
+    #[test]
+    fn range_is_inclusive_and_prefix_bound() {
+        let preds = predicates(&["REQ-1000..REQ-1999"], &[]);
+        assert!(preds.matches_id("REQ-1000"));
+        assert!(preds.matches_id("REQ-1500"));
+        assert!(preds.matches_id("REQ-1999"));
+        assert!(!preds.matches_id("REQ-999"));
+        assert!(!preds.matches_id("REQ-2000"));
+        assert!(!preds.matches_id("LIN-1500"));
+    }
+
+    #[test]
+    fn exact_ids_match_verbatim() {
+        let preds = predicates(&["REQ-42", "REQ-7"], &[]);
+        assert!(preds.matches_id("REQ-42"));
+        assert!(preds.matches_id("REQ-7"));
+        assert!(!preds.matches_id("REQ-420"));
+    }
+
+    #[test]
+    fn ignore_case_filters_use_the_configured_spelling() {
+        let args = ScanArgs {
+            slug: vec!["REQ".to_string()],
+            id: vec!["req-7".to_string(), "Req-10..req-20".to_string()],
+            ignore_case: true,
+            ..Default::default()
+        };
+        let preds = Predicates::compile(&args).unwrap();
+        assert!(preds.matches_id("REQ-7"));
+        assert!(preds.matches_id("REQ-15"));
+        assert!(!preds.matches_id("REQ-25"));
+    }
+
+    #[test]
+    fn rejects_malformed_ranges() {
+        for filter in ["REQ-1..LIN-2", "REQ-9..REQ-1", "REQ-a..REQ-2", ""] {
+            let args = ScanArgs {
+                slug: vec!["REQ".to_string()],
+                id: vec![filter.to_string()],
+                ..Default::default()
+            };
+            assert!(
+                matches!(
+                    Predicates::compile(&args),
+                    Err(ScanError::InvalidIdFilter(_))
+                ),
+                "expected {filter:?} to be rejected"
+            );
+        }
+    }
+
+    #[test]
+    fn prefilter_requires_an_accepted_id() {
+        let pattern = Regex::new(r"(?:REQ)-\d+").unwrap();
+        let spelling = SlugSpelling::default();
+        let preds = predicates(&["REQ-10..REQ-20"], &[]);
+        assert!(preds.prefilter(&pattern, &spelling, "// REQ-15\nfn x() {}"));
+        assert!(!preds.prefilter(&pattern, &spelling, "// REQ-25\nfn x() {}"));
+        assert!(!preds.prefilter(&pattern, &spelling, "fn x() {}"));
+    }
+
+    #[test]
+    fn scope_kinds_match_any_level() {
+        let preds = predicates(&[], &["function_item"]);
+        let scope = vec![
+            ScopeItem {
+                kind: "function_item".to_string(),
+                name: Some("run".to_string()),
+                line: 3,
+            },
+            ScopeItem {
+                kind: "impl_item".to_string(),
+                name: Some("Foo".to_string()),
+                line: 1,
+            },
+        ];
+        assert!(preds.matches_scope(&scope));
+        assert!(!preds.matches_scope(&scope[1..]));
+    }
+}
@@ -0,0 +1,368 @@
+//! Declarative rules for context and scope extraction.
+//!
+//! A rule names a node kind, whether it is reported as code context
+//! (`above`/`below`/`inline`) and/or as a scope, its priority when several
+//! context candidates share a line, and how to find its name. The built-in
+//! rules cover the bundled languages; `[[context_rule]]` tables in the
+//! config add to or override them.
+//!
+//! Rules are compiled once per language into a table indexed by node kind
+//! id, with field names resolved to field ids, so extraction never compares
+//! kind or field strings.
+
+use super::ScanError;
+use ast_grep_core::{Doc, Node};
+use ast_grep_language::{Language, SupportLang};
+use std::collections::HashMap;
+use std::sync::{Arc, RwLock};
+
+/// A context rule as written in config.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ContextRule {
+    /// Languages the rule applies to; all languages when empty
+    pub languages: Vec<SupportLang>,
+    /// Node kind, e.g. `function_item`
+    pub kind: String,
+    /// Report the node as `above`/`below`/`inline` context
+    pub context: bool,
+    /// Report the node in the `scope` chain
+    pub scope: bool,
+    /// Preference among context nodes starting on the same line
+    pub priority: i32,
+    /// Where the name is: `|`-separated alternatives of `.`-separated steps,
+    /// each a field name or `@kind` for the first child of that kind, e.g.
+    /// `type|trait` or `@variable_declarator.name`. Empty for no name.
+    pub name: String,
+}
+
+impl ContextRule {
+    pub fn new(kind: impl Into<String>) -> Self {
+        Self {
+            languages: Vec::new(),
+            kind: kind.into(),
+            context: true,
+            scope: false,
+            priority: DEFAULT_PRIORITY,
+            name: String::new(),
+        }
+    }
+}
+
+const DEFAULT_PRIORITY: i32 = 10;
+
+/// Built-in rules: kind, context, scope, priority, name.
+const BUILTIN_RULES: &[(&str, bool, bool, i32, &str)] = &[
+    // Functions
+    ("function_item", true, true, 100, "name"),
+    ("function_definition", true, true, 100, "name"),
+    ("function_declaration", true, true, 100, "name"),
+    ("method_definition", true, true, 100, "name"),
+    ("method_declaration", true, true, 100, "name"),
+    ("arrow_function", true, true, 10, ""),
+    ("function_expression", true, false, 10, ""),
+    ("lambda_expression", true, true, 10, ""),
+    ("closure_expression", false, true, 10, ""),
+    // Variables/Constants
+    ("let_declaration", true, false, 80, "pattern"),
+    ("const_declaration", true, false, 80, ""),
+    ("const_item", true, false, 80, "name"),
+    ("static_item", true, false, 80, "name"),
+    (
+        "variable_declaration",
+        true,
+        false,
+        80,
+        "@variable_declarator.name",
+    ),
+    ("variable_declarator", true, false, 10, "name"),
+    (
+        "lexical_declaration",
+        true,
+        false,
+        80,
+        "@variable_declarator.name",
+    ),
+    ("assignment_expression", true, false, 70, ""),
+    ("assignment_statement", true, false, 70, ""),
+    ("short_var_declaration", true, false, 80, "left"),
+    ("var_declaration", true, false, 80, "left"),
+    // Types/Classes/Structs
+    ("struct_item", true, true, 90, "name"),
+    ("struct_definition", true, false, 90, ""),
+    ("class_declaration", true, true, 90, "name"),
+    ("class_definition", true, true, 90, "name"),
+    ("interface_declaration", true, true, 90, "name"),
+    ("type_alias", true, false, 90, "name"),
+    ("type_declaration", true, false, 10, "@type_spec.name"),
+    ("type_item", true, false, 90, "name"),
+    ("enum_item", true, true, 90, "name"),
+    ("enum_declaration", true, true, 90, ""),
+    ("trait_item", true, true, 90, "name"),
+    ("trait_definition", true, false, 10, ""),
+    // Impl/Methods
+    ("impl_item", true, true, 85, "type|trait"),
+    // Calls
+    ("call_expression", true, false, 60, "function|callee"),
+    ("method_call_expression", true, false, 60, "name"),
+    // Macros
+    ("macro_invocation", true, false, 60, "macro"),
+    ("macro_definition", true, false, 10, "name"),
+    // Statements
+    ("expression_statement", true, false, 30, ""),
+    ("return_statement", true, false, 50, ""),
+    // Module/Package
+    ("mod_item", true, true, 10, "name"),
+    ("module_declaration", true, true, 10, ""),
+    ("package_clause", true, false, 10, ""),
+    ("namespace_definition", true, true, 10, ""),
+    // Use/Import
+    ("use_declaration", true, false, 45, "argument"),
+    ("import_statement", true, false, 45, "source|module_name"),
+    ("import_declaration", true, false, 45, "source|module_name"),
+    // Python
+    ("assignment", true, false, 70, "left"),
+    ("decorated_definition", true, true, 25, "definition.name"),
+    // Java
+    ("field_declaration", true, false, 80, "declarator.name"),
+    (
+        "local_variable_declaration",
+        true,
+        false,
+        80,
+        "declarator.name",
+    ),
+];
+
+fn builtin_rules() -> impl Iterator<Item = ContextRule> {
+    BUILTIN_RULES
+        .iter()
+        .map(|&(kind, context, scope, priority, name)| ContextRule {
+            context,
+            scope,
+            priority,
+            name: name.to_string(),
+            ..ContextRule::new(kind)
+        })
+}
+
+/// One step of a name path.
+#[derive(Debug, Clone, Copy)]
+enum Step {
+    /// Child in this field
+    Field(u16),
+    /// First child of this kind
+    Child(u16),
+}
+
+/// A rule compiled for one language.
+#[derive(Debug)]
+pub struct CompiledRule {
+    pub context: bool,
+    pub scope: bool,
+    pub priority: i32,
+    /// Alternative step paths, tried in order
+    name: Vec<Vec<Step>>,
+}
+
+impl CompiledRule {
+    /// The node's name, first line only.
+    pub fn name<D: Doc>(&self, node: &Node<D>) -> Option<String> {
+        self.name.iter().find_map(|path| {
+            let mut current = node.clone();
+            for step in path {
+                current = match *step {
+                    Step::Field(id) => current.child_by_field_id(id)?,
+                    Step::Child(id) => current.children().find(|c| c.kind_id() == id)?,
+                };
+            }
+            Some(current.text().lines().next().unwrap_or("").to_string())
+        })
+    }
+}
+
+/// Rules for one language, indexed by node kind id.
+#[derive(Debug, Default)]
+pub struct LangRules {
+    by_kind: Vec<Option<CompiledRule>>,
+}
+
+impl LangRules {
+    fn compile<'a>(lang: SupportLang, rules: impl Iterator<Item = &'a ContextRule>) -> Self {
+        let mut by_kind: Vec<Option<CompiledRule>> = Vec::new();
+        for rule in rules {
+            if !rule.languages.is_empty() && !rule.languages.contains(&lang) {
+                continue;
+            }
+            // Kinds from other grammars resolve to 0 and are skipped; `new`
+            // has checked that some grammar has each configured kind
+            let id = usize::from(lang.kind_to_id(&rule.kind));
+            if id == 0 {
+                continue;
+            }
+
+            // A later rule for the same kind replaces the earlier one
+            if by_kind.len() <= id {
+                by_kind.resize_with(id + 1, || None);
+            }
+            by_kind[id] = (rule.context || rule.scope).then(|| CompiledRule {
+                context: rule.context,
+                scope: rule.scope,
+                priority: rule.priority,
+                name: compile_name(lang, &rule.name),
+            });
+        }
+        Self { by_kind }
+    }
+
+    pub fn get(&self, kind_id: u16) -> Option<&CompiledRule> {
+        self.by_kind.get(usize::from(kind_id))?.as_ref()
+    }
+}
+
+/// Resolve a name spec against `lang`, dropping alternatives that name a
+/// field or kind the grammar does not have.
+fn compile_name(lang: SupportLang, spec: &str) -> Vec<Vec<Step>> {
+    spec.split('|')
+        .filter(|alt| !alt.trim().is_empty())
+        .filter_map(|alt| {
+            alt.split('.')
+                .map(|step| match step.trim().strip_prefix('@') {
+                    Some(kind) => match lang.kind_to_id(kind) {
+                        0 => None,
+                        id => Some(Step::Child(id)),
+                    },
+                    None => lang.field_to_id(step.trim()).map(Step::Field),
+                })
+                .collect()
+        })
+        .collect()
+}
+
+/// Check a name spec's syntax, independent of any grammar.
+fn validate_name(spec: &str) -> bool {
+    spec.trim().is_empty()
+        || spec.split('|').all(|alt| {
+            alt.split('.').all(|step| {
+                let step = step.trim();
+                let ident = step.strip_prefix('@').unwrap_or(step);
+                !ident.is_empty() && ident.chars().all(|c| c.is_ascii_alphanumeric() || c == '_')
+            })
+        })
+}
+
+/// Whether any language the rule applies to has its node kind.
+fn has_kind(rule: &ContextRule) -> bool {
+    let langs = match rule.languages.as_slice() {
+        [] => SupportLang::all_langs(),
+        langs => langs,
+    };
+    langs.iter().any(|lang| lang.kind_to_id(&rule.kind) != 0)
+}
+
+/// The built-in rules plus any configured ones, compiled per language on
+/// first use and shared by all files of that language.
+#[derive(Debug)]
+pub(crate) struct ContextRules {
+    rules: Vec<ContextRule>,
+    compiled: RwLock<HashMap<SupportLang, Arc<LangRules>>>,
+}
+
+impl ContextRules {
+    pub fn new(configured: &[ContextRule]) -> Result<Self, ScanError> {
+        if let Some(rule) = configured.iter().find(|r| !validate_name(&r.name)) {
+            return Err(ScanError::InvalidContextRule {
+                kind: rule.kind.clone(),
+                reason: format!("invalid name path {:?}", rule.name),
+            });
+        }
+        // A kind no grammar knows would otherwise compile to nothing
+        if let Some(rule) = configured.iter().find(|r| !has_kind(r)) {
+            return Err(ScanError::InvalidContextRule {
+                kind: rule.kind.clone(),
+                reason: "no grammar the rule applies to has this node kind".to_string(),
+            });
+        }
+        Ok(Self {
+            rules: builtin_rules().chain(configured.iter().cloned()).collect(),
+            compiled: RwLock::default(),
+        })
+    }
+
+    pub fn for_lang(&self, lang: SupportLang) -> Arc<LangRules> {
+        if let Some(rules) = self
+            .compiled
+            .read()
+            .unwrap_or_else(|e| e.into_inner())
+            .get(&lang)
+        {
+            return Arc::clone(rules);
+        }
+        let mut compiled = self.compiled.write().unwrap_or_else(|e| e.into_inner());
+        Arc::clone(
+            compiled
+                .entry(lang)
+                .or_insert_with(|| Arc::new(LangRules::compile(lang, self.rules.iter()))),
+        )
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn builtin_rules_are_well_formed() {
+        assert!(
+            BUILTIN_RULES
+                .iter()
+                .all(|(_, _, _, _, name)| validate_name(name))
+        );
+        assert!(ContextRules::new(&[]).is_ok());
+    }
+
+    #[test]
+    fn builtin_priorities_prefer_definitions() {
+        let priority = |kind: &str| {
+            builtin_rules()
+                .find(|rule| rule.kind == kind)
+                .map_or(DEFAULT_PRIORITY, |rule| rule.priority)
+        };
+        assert!(priority("function_item") > priority("let_declaration"));
+        assert!(priority("let_declaration") > priority("call_expression"));
+    }
+
+    #[test]
+    fn rejects_malformed_name_paths() {
+        for name in ["declarator..name", "@", "type|", "a-b"] {
+            let rule = ContextRule {
+                name: name.to_string(),
+                ..ContextRule::new("function_definition")
+            };
+            assert!(
+                matches!(
+                    ContextRules::new(&[rule]),
+                    Err(ScanError::InvalidContextRule { .. })
+                ),
+                "expected {name:?} to be rejected"
+            );
+        }
+    }
+
+    #[test]
+    fn rejects_kinds_no_grammar_has() {
+        let unknown = ContextRule::new("no_such_kind");
+        let other_language = ContextRule {
+            languages: vec![SupportLang::Python],
+            ..ContextRule::new("function_item")
+        };
+        for rule in [unknown, other_language] {
+            assert!(
+                matches!(
+                    ContextRules::new(std::slice::from_ref(&rule)),
+                    Err(ScanError::InvalidContextRule { ref kind, .. }) if *kind == rule.kind
+                ),
+                "expected {rule:?} to be rejected"
+            );
+        }
+    }
+}
@@ -0,0 +1,375 @@
+//! Reusable scanner for embedding tracy as a library.
+
+use super::{
+    Entry, FileHits, ScanArgs, ScanError, ScanResult, SlugSpelling, cache::ResultCache,
+    compile_pattern, marker::Markers, predicate::Predicates, rules::ContextRules, scan_file,
+    scan_source, variant::VariantSet,
+};
+use crate::pool;
+use crate::stats::{self, Skip};
+use crate::trace;
+use ast_grep_language::{Language, SupportLang};
+use regex::Regex;
+use std::collections::BTreeMap;
+use std::ops::ControlFlow;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+/// Source text held in memory rather than read from disk.
+#[derive(Debug, Clone, Copy)]
+pub struct Source<'a> {
+    /// Path recorded in the entries, and used to detect the language
+    pub path: &'a Path,
+    /// UTF-8 source text
+    pub content: &'a [u8],
+    /// Language to parse as; detected from `path` when `None`
+    pub lang: Option<SupportLang>,
+}
+
+impl<'a> Source<'a> {
+    pub fn new(path: &'a Path, content: &'a [u8]) -> Self {
+        Self {
+            path,
+            content,
+            lang: None,
+        }
+    }
+
+    pub fn with_lang(self, lang: SupportLang) -> Self {
+        Self {
+            lang: Some(lang),
+            ..self
+        }
+    }
+}
+
+/// A compiled scan configuration.
+///
+/// Building a `Scanner` compiles the id matcher and predicates once; it can
+/// then be shared across threads and reused for any number of scans.
+///
+/// ```no_run
+/// use std::ops::ControlFlow;
+/// use std::path::Path;
+/// use tracy::scan::{ScanArgs, Scanner};
+///
+/// let scanner = Scanner::new(&ScanArgs {
+///     slug: vec!["REQ".to_string()],
+///     ..Default::default()
+/// })?;
+///
+/// let root = Path::new(".");
+/// let paths = vec![root.join("src/lib.rs")];
+/// for hit in scanner.iter(root, &paths) {
+///     let (id, entry) = hit?;
+///     println!("{id} {}:{}", entry.file.display(), entry.line);
+/// }
+///
+/// scanner.visit_paths(root, &paths, |id, _entry| {
+///     if id == "REQ-42" {
+///         ControlFlow::Break(())
+///     } else {
+///         ControlFlow::Continue(())
+///     }
+/// })?;
+/// # Ok::<(), tracy::scan::ScanError>(())
+/// ```
+#[derive(Debug)]
+pub struct Scanner {
+    pub(super) pattern: Regex,
+    pub(super) spelling: SlugSpelling,
+    pub(super) predicates: Predicates,
+    pub(super) markers: Markers,
+    pub(super) context: ContextRules,
+    pub(super) variants: VariantSet,
+    pub(super) cache: Option<ResultCache>,
+    limit: Option<usize>,
+}
+
+impl Scanner {
+    pub fn new(args: &ScanArgs) -> Result<Self, ScanError> {
+        Ok(Self {
+            pattern: compile_pattern(args)?,
+            spelling: SlugSpelling::new(args),
+            predicates: Predicates::compile(args)?,
+            markers: Markers::compile(&args.markers)?,
+            context: ContextRules::new(&args.context_rules)?,
+            variants: VariantSet::new(args.variants.clone()),
+            cache: ResultCache::open(args)?,
+            limit: args.limit,
+        })
+    }
+
+    /// The maximum number of hits, if limited.
+    pub fn limit(&self) -> Option<usize> {
+        self.limit
+    }
+
+    /// Scan a single file. `root` is the directory entry paths are made
+    /// relative to. Files in unsupported languages yield no hits.
+    pub fn scan_file(&self, root: &Path, path: &Path) -> Result<FileHits, ScanError> {
+        scan_file(self, root, path, usize::MAX)
+    }
+
+    /// Scan a source held in memory, without touching the filesystem.
+    /// Sources in unsupported languages yield no hits.
+    pub fn scan_source(&self, source: &Source) -> Result<FileHits, ScanError> {
+        self.scan_source_limited(source, usize::MAX)
+    }
+
+    fn scan_source_limited(&self, source: &Source, max_hits: usize) -> Result<FileHits, ScanError> {
+        let Some(lang) = source.lang.or_else(|| SupportLang::from_path(source.path)) else {
+            stats::skip(Skip::UnsupportedLanguage);
+            return Ok(FileHits::new());
+        };
+        let _span = trace::file(source.path);
+        let text = std::str::from_utf8(source.content).map_err(|_| ScanError::InvalidUtf8 {
+            path: source.path.to_path_buf(),
+        })?;
+
+        Ok(scan_source(self, source.path, text, lang, max_hits))
+    }
+
+    /// Scan `paths` on the worker pool and merge the hits in path order.
+    ///
+    /// With a limit set, workers stop picking up files once enough hits
+    /// have been collected. Files are claimed in path order and every claimed
+    /// file is finished, so the result is still the first `limit` hits in
+    /// path order.
+    pub fn scan_paths(&self, root: &Path, paths: &[PathBuf]) -> Result<ScanResult, ScanError> {
+        self.collect_in_order(paths.len(), |index, max_hits| {
+            scan_file(self, root, &paths[index], max_hits)
+        })
+    }
+
+    /// Scan in-memory `sources` on the worker pool and merge the hits in
+    /// input order; the limit applies as in [`Scanner::scan_paths`].
+    pub fn scan_sources(&self, sources: &[Source]) -> Result<ScanResult, ScanError> {
+        self.collect_in_order(sources.len(), |index, max_hits| {
+            self.scan_source_limited(&sources[index], max_hits)
+        })
+    }
+
+    /// Run `scan` for every item index on the worker pool and merge the hits
+    /// in index order, honouring the limit.
+    fn collect_in_order<F>(&self, len: usize, scan: F) -> Result<ScanResult, ScanError>
+    where
+        F: Fn(usize, usize) -> Result<FileHits, ScanError> + Sync,
+    {
+        let limit = self.limit.unwrap_or(usize::MAX);
+
+        let stop = AtomicBool::new(false);
+        let found = AtomicUsize::new(0);
+        let per_worker = pool::for_each_index(len, &stop, Vec::new, |done, index| {
+            let result = scan(index, limit);
+            match &result {
+                Ok(hits) if !hits.is_empty() => {
+                    if found.fetch_add(hits.len(), Ordering::Relaxed) + hits.len() >= limit {
+                        stop.store(true, Ordering::Relaxed);
+                    }
+                }
+                Ok(_) => {}
+                Err(_) => stop.store(true, Ordering::Relaxed),
+            }
+            done.push((index, result));
+        });
+
+        let mut per_file: Vec<(usize, Result<FileHits, ScanError>)> =
+            per_worker.into_iter().flatten().collect();
+        per_file.sort_unstable_by_key(|(index, _)| *index);
+
+        let mut results: ScanResult = BTreeMap::new();
+        let mut remaining = limit;
+        for (_, hits) in per_file {
+            // Files past the limit may still have been claimed; their
+            // errors would not have been reached by a sequential scan
+            if remaining == 0 {
+                break;
+            }
+            for (slug, entry) in hits? {
+                if remaining == 0 {
+                    break;
+                }
+                remaining -= 1;
+                results.entry(slug).or_default().push(entry);
+            }
+        }
+
+        Ok(results)
+    }
+
+    /// Scan `paths` on the worker pool, folding each file's hits into a
+    /// per-worker accumulator as soon as the file is done.
+    ///
+    /// Hits are never collected into a [`ScanResult`], so memory stays
+    /// bounded by the accumulators; the caller merges the returned states.
+    /// The limit is not applied here.
+    pub fn fold_paths<S, I, F>(
+        &self,
+        root: &Path,
+        paths: &[PathBuf],
+        init: I,
+        fold: F,
+    ) -> Result<Vec<S>, ScanError>
+    where
+        S: Send,
+        I: Fn() -> S + Sync,
+        F: Fn(&mut S, FileHits) + Sync,
+    {
+        let stop = AtomicBool::new(false);
+        let per_worker = pool::for_each_index(
+            paths.len(),
+            &stop,
+            || (init(), None),
+            |(state, error), index| match self.scan_file(root, &paths[index]) {
+                Ok(hits) if hits.is_empty() => {}
+                Ok(hits) => fold(state, hits),
+                Err(e) => {
+                    *error = Some(e);
+                    stop.store(true, Ordering::Relaxed);
+                }
+            },
+        );
+
+        per_worker
+            .into_iter()
+            .map(|(state, error)| match error {
+                Some(e) => Err(e),
+                None => Ok(state),
+            })
+            .collect()
+    }
+
+    /// Scan `paths` on the worker pool, calling `visit` with each hit as soon
+    /// as its file is done.
+    ///
+    /// `visit` runs on the worker threads, so hits arrive in no particular
+    /// order across files. Returning [`ControlFlow::Break`] stops all workers
+    /// after the files in hand. The limit is not applied here.
+    pub fn visit_paths<F>(&self, root: &Path, paths: &[PathBuf], visit: F) -> Result<(), ScanError>
+    where
+        F: Fn(String, Entry) -> ControlFlow<()> + Sync,
+    {
+        let stop = AtomicBool::new(false);
+        let per_worker = pool::for_each_index(
+            paths.len(),
+            &stop,
+            || None,
+            |error, index| match self.scan_file(root, &paths[index]) {
+                Ok(hits) => {
+                    for (id, entry) in hits {
+                        if visit(id, entry).is_break() {
+                            stop.store(true, Ordering::Relaxed);
+                            return;
+                        }
+                    }
+                }
+                Err(e) => {
+                    *error = Some(e);
+                    stop.store(true, Ordering::Relaxed);
+                }
+            },
+        );
+
+        match per_worker.into_iter().flatten().next() {
+            Some(e) => Err(e),
+            None => Ok(()),
+        }
+    }
+
+    /// Lazily scan `paths` one file at a time on the calling thread, yielding
+    /// hits in path order. Only one file's hits are held at a time.
+    pub fn iter<'a>(&'a self, root: &'a Path, paths: &'a [PathBuf]) -> Hits<'a> {
+        Hits {
+            scanner: self,
+            root,
+            paths: paths.iter(),
+            pending: Vec::new().into_iter(),
+            failed: false,
+        }
+    }
+}
+
+/// Iterator over hits returned by [`Scanner::iter`].
+///
+/// Stops after the first error.
+#[derive(Debug)]
+pub struct Hits<'a> {
+    scanner: &'a Scanner,
+    root: &'a Path,
+    paths: std::slice::Iter<'a, PathBuf>,
+    pending: std::vec::IntoIter<(String, Entry)>,
+    failed: bool,
+}
+
+impl Iterator for Hits<'_> {
+    type Item = Result<(String, Entry), ScanError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        loop {
+            if let Some(hit) = self.pending.next() {
+                return Some(Ok(hit));
+            }
+            if self.failed {
+                return None;
+            }
+
+            let path = self.paths.next()?;
+            match self.scanner.scan_file(self.root, path) {
+                Ok(hits) => self.pending = hits.into_iter(),
+                Err(e) => {
+                    self.failed = true;
+                    return Some(Err(e));
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn scanner_is_shareable_across_threads() {
+        fn assert_send_sync<T: Send + Sync>() {}
+        assert_send_sync::<Scanner>();
+    }
+
+    #[test]
+    fn in_memory_sources_need_utf8_and_a_language() {
+        let scanner = Scanner::new(&ScanArgs {
+            slug: vec!["REQ".to_string()],
+            ..Default::default()
+        })
+        .unwrap();
+
+        let unknown = Source::new(Path::new("notes.unknown"), b"// REQ-1");
+        assert!(scanner.scan_source(&unknown).unwrap().is_empty());
+
+        let binary = Source::new(Path::new("lib.rs"), b"// REQ-1 \xff");
+        assert!(matches!(
+            scanner.scan_source(&binary),
+            Err(ScanError::InvalidUtf8 { .. })
+        ));
+
+        // Without a possible id the source is never parsed
+        let plain = Source::new(Path::new("lib"), b"fn main() {}").with_lang(SupportLang::Rust);
+        assert!(scanner.scan_source(&plain).unwrap().is_empty());
+    }
+
+    #[test]
+    fn iterator_stops_after_first_error() {
+        let scanner = Scanner::new(&ScanArgs {
+            slug: vec!["REQ".to_string()],
+            ..Default::default()
+        })
+        .unwrap();
+        let root = Path::new("/nonexistent-tracy-root");
+        let paths = vec![root.join("a.rs"), root.join("b.rs")];
+
+        let hits: Vec<_> = scanner.iter(root, &paths).collect();
+        assert_eq!(hits.len(), 1);
+        assert!(matches!(hits[0], Err(ScanError::ReadFile { .. })));
+    }
+}
@@ -0,0 +1,264 @@
+//! Async scanning for services (`async` feature).
+//!
+//! Sources arrive on a `Stream` and hits leave on another. Parsing is CPU
+//! bound, so each source is scanned on Tokio's blocking pool; a semaphore
+//! caps the number of sources in flight and a bounded channel carries the
+//! hits, so a slow consumer stops the driver from pulling more input.
+
+use super::{Entry, ScanError, Scanner, Source};
+use ast_grep_language::SupportLang;
+use std::path::PathBuf;
+use std::sync::Arc;
+use tokio::sync::{Semaphore, mpsc};
+use tokio_stream::wrappers::ReceiverStream;
+use tokio_stream::{Stream, StreamExt};
+
+/// An owned in-memory source, for handing across tasks.
+#[derive(Debug, Clone)]
+pub struct OwnedSource {
+    /// Path recorded in the entries, and used to detect the language
+    pub path: PathBuf,
+    /// UTF-8 source text
+    pub content: Vec<u8>,
+    /// Language to parse as; detected from `path` when `None`
+    pub lang: Option<SupportLang>,
+}
+
+impl OwnedSource {
+    pub fn new(path: impl Into<PathBuf>, content: impl Into<Vec<u8>>) -> Self {
+        Self {
+            path: path.into(),
+            content: content.into(),
+            lang: None,
+        }
+    }
+
+    pub fn with_lang(self, lang: SupportLang) -> Self {
+        Self {
+            lang: Some(lang),
+            ..self
+        }
+    }
+
+    fn as_source(&self) -> Source<'_> {
+        Source {
+            path: &self.path,
+            content: &self.content,
+            lang: self.lang,
+        }
+    }
+}
+
+/// Concurrency and buffering limits for [`Scanner::scan_stream`].
+#[derive(Debug, Clone, Copy)]
+pub struct StreamOptions {
+    /// Maximum number of sources being scanned at once
+    pub max_in_flight: usize,
+    /// Number of hits buffered for the consumer before scanning pauses
+    pub buffer: usize,
+}
+
+impl Default for StreamOptions {
+    fn default() -> Self {
+        Self {
+            max_in_flight: std::thread::available_parallelism().map_or(4, |n| n.get()),
+            buffer: 1024,
+        }
+    }
+}
+
+impl Scanner {
+    /// Scan every source from `sources`, yielding hits as each source is done.
+    ///
+    /// Hits from one source arrive together and in traversal order; sources
+    /// complete in any order. A source that fails yields one error item and
+    /// the remaining sources are still scanned. Dropping the returned stream
+    /// stops pulling input.
+    ///
+    /// Must be called from within a Tokio runtime.
+    pub fn scan_stream<S>(
+        self: &Arc<Self>,
+        sources: S,
+        options: StreamOptions,
+    ) -> impl Stream<Item = Result<(String, Entry), ScanError>> + Send + 'static
+    where
+        S: Stream<Item = OwnedSource> + Send + 'static,
+    {
+        let (tx, rx) = mpsc::channel(options.buffer.max(1));
+        let permits = Arc::new(Semaphore::new(options.max_in_flight.max(1)));
+        let scanner = Arc::clone(self);
+
+        tokio::spawn(async move {
+            let mut sources = std::pin::pin!(sources);
+            // Waiting for input or a permit both end once the consumer is
+            // gone; `biased` checks that first when both are ready
+            loop {
+                let source = tokio::select! {
+                    biased;
+                    _ = tx.closed() => break,
+                    source = sources.next() => match source {
+                        Some(source) => source,
+                        None => break,
+                    },
+                };
+                let permit = tokio::select! {
+                    biased;
+                    _ = tx.closed() => break,
+                    permit = Arc::clone(&permits).acquire_owned() => {
+                        permit.expect("semaphore is never closed")
+                    }
+                };
+
+                let scanner = Arc::clone(&scanner);
+                let tx = tx.clone();
+                tokio::spawn(async move {
+                    // The consumer may have left while this source waited
+                    if tx.is_closed() {
+                        return;
+                    }
+                    let scanned = match tokio::task::spawn_blocking(move || {
+                        scanner.scan_source(&source.as_source())
+                    })
+                    .await
+                    {
+                        Ok(scanned) => scanned,
+                        // Only happens while the runtime shuts down
+                        Err(e) if e.is_cancelled() => return,
+                        Err(e) => std::panic::resume_unwind(e.into_panic()),
+                    };
+
+                    match scanned {
+                        Ok(hits) => {
+                            for hit in hits {
+                                if tx.send(Ok(hit)).await.is_err() {
+                                    break;
+                                }
+                            }
+                        }
+                        Err(e) => {
+                            let _ = tx.send(Err(e)).await;
+                        }
+                    }
+                    drop(permit);
+                });
+            }
+        });
+
+        ReceiverStream::new(rx)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::scan::ScanArgs;
+    use std::sync::atomic::{AtomicBool, Ordering};
+    use std::time::Duration;
+
+    fn scanner() -> Arc<Scanner> {
+        Arc::new(
+            Scanner::new(&ScanArgs {
+                slug: vec!["REQ".to_string()],
+                ..Default::default()
+            })
+            .unwrap(),
+        )
+    }
+
+    #[tokio::test(flavor = "multi_thread")]
+    async fn stream_yields_hits_grouped_per_source() {
+        let sources = tokio_stream::iter(vec![
+            OwnedSource::new("a.rs", "// REQ-1\nfn a() {}\n// REQ-2\nfn b() {}\n"),
+            OwnedSource::new("b.rs", "fn c() {}\n"),
+            OwnedSource::new("c", "# REQ-3\n").with_lang(SupportLang::Python),
+        ]);
+
+        // One source in flight at a time, so sources also finish in order
+        let hits: Vec<(String, PathBuf, usize)> = scanner()
+            .scan_stream(
+                sources,
+                StreamOptions {
+                    max_in_flight: 1,
+                    buffer: 1,
+                },
+            )
+            .map(|item| {
+                let (slug, entry) = item.unwrap();
+                (slug, entry.file, entry.line)
+            })
+            .collect()
+            .await;
+
+        assert_eq!(
+            hits,
+            vec![
+                ("REQ-1".to_string(), PathBuf::from("a.rs"), 1),
+                ("REQ-2".to_string(), PathBuf::from("a.rs"), 3),
+                ("REQ-3".to_string(), PathBuf::from("c"), 1),
+            ]
+        );
+    }
+
+    #[tokio::test(flavor = "multi_thread")]
+    async fn stream_reports_errors_per_source() {
+        let scanner = scanner();
+        let sources = tokio_stream::iter(vec![
+            OwnedSource::new("a.rs", b"// REQ-1 \xff".to_vec()),
+            OwnedSource::new("b.unknown", "// REQ-2"),
+            OwnedSource::new("c.rs", b"\xfe".to_vec()),
+        ]);
+
+        let items: Vec<_> = scanner
+            .scan_stream(
+                sources,
+                StreamOptions {
+                    max_in_flight: 1,
+                    buffer: 1,
+                },
+            )
+            .collect()
+            .await;
+
+        assert_eq!(items.len(), 2);
+        assert!(
+            items
+                .iter()
+                .all(|item| matches!(item, Err(ScanError::InvalidUtf8 { .. })))
+        );
+    }
+
+    /// Sets its flag when dropped.
+    struct DropFlag(Arc<AtomicBool>);
+
+    impl Drop for DropFlag {
+        fn drop(&mut self) {
+            self.0.store(true, Ordering::Relaxed);
+        }
+    }
+
+    #[tokio::test(flavor = "multi_thread")]
+    async fn dropping_the_stream_releases_idle_input() {
+        let dropped = Arc::new(AtomicBool::new(false));
+        let guard = DropFlag(Arc::clone(&dropped));
+        // One source, then input that never arrives
+        let sources = tokio_stream::iter(vec![OwnedSource::new("a.rs", b"\xff".to_vec())])
+            .chain(tokio_stream::pending())
+            .map(move |source| {
+                let _guard = &guard;
+                source
+            });
+
+        let mut hits = scanner().scan_stream(sources, StreamOptions::default());
+        assert!(hits.next().await.unwrap().is_err());
+        drop(hits);
+
+        for _ in 0..1000 {
+            if dropped.load(Ordering::Relaxed) {
+                break;
+            }
+            tokio::task::yield_now().await;
+            std::thread::sleep(Duration::from_millis(1));
+        }
+        assert!(dropped.load(Ordering::Relaxed));
+    }
+}
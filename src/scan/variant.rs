@@ -0,0 +1,747 @@
+//! Build variants for C and C++ sources.
+//!
+//! A variant is a named set of preprocessor defines. Each file is parsed
+//! once; for every hit, the `#if`/`#ifdef` conditions enclosing its line are
+//! evaluated against each variant and the entry is tagged with the variants
+//! the line is compiled in.
+//!
+//! `#define` and `#undef` lines in the file itself are applied on top of the
+//! variant's defines from where they appear. One made under conditions that
+//! do not all hold at a later `#if` leaves that macro unknown there, so both
+//! branches are kept. C++ files have `__cplusplus` predefined.
+//!
+//! Condition results are cached across files by condition text and the
+//! in-file macro state the condition depends on, since the same
+//! configuration checks recur throughout a code base.
+
+use super::condition::{evaluate, identifiers};
+use super::{FileHits, ScanError};
+use ast_grep_language::SupportLang;
+use serde::Deserialize;
+use std::borrow::Cow;
+use std::collections::{BTreeMap, BTreeSet, HashMap};
+use std::fs;
+use std::path::Path;
+use std::str::FromStr;
+use std::sync::{Arc, Mutex};
+
+/// A named set of preprocessor defines.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct Variant {
+    pub name: String,
+    /// Macro name to replacement text; `-DNAME` defines it as `1`
+    pub defines: BTreeMap<String, String>,
+}
+
+impl Variant {
+    pub fn new(name: impl Into<String>) -> Self {
+        Self {
+            name: name.into(),
+            defines: BTreeMap::new(),
+        }
+    }
+
+    /// Add a define in `-D` form: `NAME` or `NAME=VALUE`.
+    pub fn define(mut self, define: &str) -> Self {
+        let (name, value) = define.split_once('=').unwrap_or((define, "1"));
+        self.defines
+            .insert(name.trim().to_string(), value.trim().to_string());
+        self
+    }
+
+    /// Add the defines every translation unit in a `compile_commands.json`
+    /// is built with. Per-file differences are left out, so the variant
+    /// describes the configuration rather than any one file.
+    pub fn with_compile_commands(mut self, path: &Path) -> Result<Self, ScanError> {
+        let content = fs::read_to_string(path).map_err(|e| ScanError::ReadFile {
+            path: path.to_path_buf(),
+            source: e,
+        })?;
+        let commands: Vec<CompileCommand> =
+            serde_json::from_str(&content).map_err(|e| ScanError::CompileCommands {
+                path: path.to_path_buf(),
+                source: e,
+            })?;
+
+        let mut shared: Option<BTreeMap<String, String>> = None;
+        for command in &commands {
+            let defines = command.defines();
+            shared = Some(match shared {
+                None => defines,
+                Some(mut shared) => {
+                    shared.retain(|name, value| defines.get(name) == Some(value));
+                    shared
+                }
+            });
+        }
+
+        self.defines.extend(shared.unwrap_or_default());
+        Ok(self)
+    }
+}
+
+/// `NAME=DEF,DEF=VALUE,...`, as accepted by `--variant`.
+impl FromStr for Variant {
+    type Err = ScanError;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let (name, defines) = s.split_once('=').unwrap_or((s, ""));
+        if name.trim().is_empty() {
+            return Err(ScanError::InvalidVariant(s.to_string()));
+        }
+        Ok(defines
+            .split(',')
+            .filter(|d| !d.trim().is_empty())
+            .fold(Variant::new(name.trim()), |variant, define| {
+                variant.define(define)
+            }))
+    }
+}
+
+/// One entry of a `compile_commands.json` database.
+#[derive(Debug, Deserialize)]
+struct CompileCommand {
+    #[serde(default)]
+    arguments: Option<Vec<String>>,
+    #[serde(default)]
+    command: Option<String>,
+}
+
+impl CompileCommand {
+    /// Defines set by `-D`/`/D` and removed by `-U`/`/U`, in order.
+    fn defines(&self) -> BTreeMap<String, String> {
+        let args = match (&self.arguments, &self.command) {
+            (Some(arguments), _) => arguments.clone(),
+            (None, Some(command)) => split_command(command),
+            (None, None) => Vec::new(),
+        };
+
+        let mut defines = BTreeMap::new();
+        let mut args = args.iter();
+        while let Some(arg) = args.next() {
+            let (flag, inline) = match arg.get(..2) {
+                Some(flag @ ("-D" | "-U")) => (flag, &arg[2..]),
+                // MSVC spelling; a path such as `/Data/a.c` is not a define
+                Some(flag @ ("/D" | "/U")) if !arg[2..].contains('/') => (flag, &arg[2..]),
+                _ => continue,
+            };
+            let value = if inline.is_empty() {
+                match args.next() {
+                    Some(next) => next.as_str(),
+                    None => break,
+                }
+            } else {
+                inline
+            };
+
+            if flag.ends_with('D') {
+                let (name, value) = value.split_once('=').unwrap_or((value, "1"));
+                defines.insert(name.to_string(), value.to_string());
+            } else {
+                defines.remove(value);
+            }
+        }
+        defines
+    }
+}
+
+/// Split a shell command line into arguments, honouring quotes and
+/// backslash escapes.
+fn split_command(command: &str) -> Vec<String> {
+    let mut args = Vec::new();
+    let mut current = String::new();
+    let mut in_arg = false;
+    let mut quote = None;
+    let mut chars = command.chars();
+
+    while let Some(c) = chars.next() {
+        match (quote, c) {
+            (Some(q), c) if c == q => quote = None,
+            (Some('"') | None, '\\') => {
+                if let Some(next) = chars.next() {
+                    current.push(next);
+                }
+                in_arg = true;
+            }
+            (Some(_), c) => current.push(c),
+            (None, '"' | '\'') => {
+                quote = Some(c);
+                in_arg = true;
+            }
+            (None, c) if c.is_whitespace() => {
+                if in_arg {
+                    args.push(std::mem::take(&mut current));
+                    in_arg = false;
+                }
+            }
+            (None, c) => {
+                current.push(c);
+                in_arg = true;
+            }
+        }
+    }
+    if in_arg {
+        args.push(current);
+    }
+    args
+}
+
+/// Value of `__cplusplus` in C++ files.
+const CPLUSPLUS: &str = "201703L";
+
+/// What the file itself has done to a macro before a condition.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+enum Local {
+    /// `#define`d with this replacement text
+    Defined(String),
+    /// `#undef`ined
+    Undefined,
+    /// Defined or undefined under conditions that may not hold
+    Unknown,
+}
+
+/// The in-file macro state at a condition, by macro name.
+type LocalDefines = Vec<(String, Local)>;
+
+/// The variants of a scan, with condition results shared across files.
+#[derive(Debug, Default)]
+pub(super) struct VariantSet {
+    variants: Vec<Variant>,
+    /// Identifiers the variants' define values refer to
+    variant_identifiers: BTreeSet<String>,
+    /// Condition text and the in-file macros it depends on, to its value in
+    /// each variant (`None` when unknown)
+    cache: Mutex<HashMap<(String, LocalDefines), Arc<[Option<bool>]>>>,
+}
+
+impl VariantSet {
+    pub fn new(variants: Vec<Variant>) -> Self {
+        let variant_identifiers = variants
+            .iter()
+            .flat_map(|variant| variant.defines.values())
+            .flat_map(|value| identifiers(value))
+            .map(str::to_string)
+            .collect();
+        Self {
+            variants,
+            variant_identifiers,
+            cache: Mutex::default(),
+        }
+    }
+
+    /// Tag each C or C++ hit with the variants its line is compiled in.
+    ///
+    /// Hits in other languages, or in any file when no variants are
+    /// configured, are left untagged.
+    pub fn tag(&self, lang: SupportLang, source: &str, hits: &mut FileHits) {
+        if self.variants.is_empty()
+            || hits.is_empty()
+            || !matches!(lang, SupportLang::C | SupportLang::Cpp)
+        {
+            return;
+        }
+
+        let predefined: &[(&str, &str)] = match lang {
+            SupportLang::Cpp => &[("__cplusplus", CPLUSPLUS)],
+            _ => &[],
+        };
+        let regions = Conditionals::parse(source, predefined);
+        let mut truth: Vec<Option<Arc<[Option<bool>]>>> = vec![None; regions.conditions.len()];
+
+        for (_, entry) in hits.iter_mut() {
+            let terms = regions.terms_at(entry.line - 1);
+            let active = self
+                .variants
+                .iter()
+                .enumerate()
+                .filter(|(index, _)| {
+                    terms.iter().all(|&(condition, expected)| {
+                        let values = truth[condition].get_or_insert_with(|| {
+                            let (text, local) = &regions.conditions[condition];
+                            self.condition_values(text, local)
+                        });
+                        // A condition that cannot be decided may go either way
+                        values[*index].is_none_or(|value| value == expected)
+                    })
+                })
+                .map(|(_, variant)| variant.name.clone())
+                .collect();
+            entry.variants = Some(active);
+        }
+    }
+
+    fn condition_values(&self, condition: &str, local: &LocalDefines) -> Arc<[Option<bool>]> {
+        let key = (condition.to_string(), self.relevant(condition, local));
+        let mut cache = self.cache.lock().unwrap_or_else(|e| e.into_inner());
+        if let Some(values) = cache.get(&key) {
+            return Arc::clone(values);
+        }
+        let local = &key.1;
+        let values: Arc<[Option<bool>]> = self
+            .variants
+            .iter()
+            .map(|variant| {
+                if local.is_empty() {
+                    return evaluate(condition, &variant.defines, &BTreeSet::new());
+                }
+                let mut defines = Cow::Borrowed(&variant.defines);
+                let mut unknown = BTreeSet::new();
+                for (name, state) in local {
+                    match state {
+                        Local::Defined(value) => {
+                            defines.to_mut().insert(name.clone(), value.clone());
+                        }
+                        Local::Undefined => {
+                            defines.to_mut().remove(name);
+                        }
+                        Local::Unknown => {
+                            unknown.insert(name.clone());
+                        }
+                    }
+                }
+                evaluate(condition, &defines, &unknown)
+            })
+            .collect();
+        cache.insert(key, Arc::clone(&values));
+        values
+    }
+
+    /// The part of `local` that `condition` can reach: the macros it names,
+    /// and those named by the variants' or the file's definitions of them.
+    /// Keying the cache by only these keeps files with unrelated defines on
+    /// the same entries.
+    fn relevant(&self, condition: &str, local: &LocalDefines) -> LocalDefines {
+        if local.is_empty() {
+            return Vec::new();
+        }
+        let mut reachable: BTreeSet<&str> = identifiers(condition).collect();
+        reachable.extend(self.variant_identifiers.iter().map(String::as_str));
+        let mut pending: Vec<&str> = reachable.iter().copied().collect();
+        while let Some(name) = pending.pop() {
+            if let Some((_, Local::Defined(value))) = local.iter().find(|(n, _)| n == name) {
+                for identifier in identifiers(value) {
+                    if reachable.insert(identifier) {
+                        pending.push(identifier);
+                    }
+                }
+            }
+        }
+        local
+            .iter()
+            .filter(|(name, _)| reachable.contains(name.as_str()))
+            .cloned()
+            .collect()
+    }
+}
+
+/// A condition index and the value it must have.
+type Term = (usize, bool);
+
+/// The preprocessor conditional structure of one file.
+#[derive(Debug, Default)]
+struct Conditionals {
+    /// Distinct condition expressions, `#ifdef X` normalized to `defined X`,
+    /// each with the in-file macro state where it is evaluated
+    conditions: Vec<(String, LocalDefines)>,
+    /// Terms that must all hold for a line to be compiled; `chains[0]` is
+    /// the empty chain of unconditional code
+    chains: Vec<Vec<Term>>,
+    /// `(first line, chain)` in line order; a line belongs to the last span
+    /// starting at or before it
+    spans: Vec<(usize, usize)>,
+}
+
+/// A `#define` (with its replacement text) or `#undef` (`None`) in the
+/// file, and the chain in effect where it appears.
+struct MacroChange {
+    name: String,
+    value: Option<String>,
+    chain: usize,
+}
+
+/// An open `#if` group.
+struct Group {
+    /// Chain in effect around the group
+    outer: usize,
+    /// Conditions of the branches seen so far
+    taken: Vec<usize>,
+}
+
+impl Conditionals {
+    /// Parse `source`, with `predefined` macros defined from the start.
+    fn parse(source: &str, predefined: &[(&str, &str)]) -> Self {
+        let mut this = Self {
+            conditions: Vec::new(),
+            chains: vec![Vec::new()],
+            spans: vec![(0, 0)],
+        };
+        let mut interned: HashMap<(String, LocalDefines), usize> = HashMap::new();
+        let mut groups: Vec<Group> = Vec::new();
+        let mut changes: Vec<MacroChange> = predefined
+            .iter()
+            .map(|&(name, value)| MacroChange {
+                name: name.to_string(),
+                value: Some(value.to_string()),
+                chain: 0,
+            })
+            .collect();
+        let mut current = 0;
+        let mut in_comment = false;
+
+        let lines: Vec<&str> = source.lines().collect();
+        let mut index = 0;
+        while index < lines.len() {
+            let first = index;
+            let starts_in_comment = in_comment;
+            let mut code = strip_comments(lines[index], &mut in_comment);
+            index += 1;
+
+            let Some(directive) = code
+                .trim_start()
+                .strip_prefix('#')
+                .filter(|_| !starts_in_comment)
+            else {
+                continue;
+            };
+            let mut directive = directive.to_string();
+            while directive.ends_with('\\') && index < lines.len() {
+                directive.pop();
+                code = strip_comments(lines[index], &mut in_comment);
+                directive.push(' ');
+                directive.push_str(&code);
+                index += 1;
+            }
+
+            let directive = directive.trim_start();
+            let keyword_len = directive
+                .find(|c: char| !c.is_ascii_alphanumeric() && c != '_')
+                .unwrap_or(directive.len());
+            let (keyword, rest) = directive.split_at(keyword_len);
+            let rest = rest.trim();
+
+            if let Some(change) = macro_change(keyword, rest, current) {
+                changes.push(change);
+                continue;
+            }
+
+            // An `#elif` is only evaluated once the earlier branches were
+            // not taken, so what they define does not apply to it
+            let evaluated_in = match keyword {
+                "elif" | "elifdef" | "elifndef" => groups.last().map_or(current, |g| g.outer),
+                _ => current,
+            };
+            let mut local = None;
+            let mut intern = |text: String| {
+                let local = local
+                    .get_or_insert_with(|| this.local_defines(&changes, evaluated_in))
+                    .clone();
+                *interned
+                    .entry((text.clone(), local.clone()))
+                    .or_insert_with(|| {
+                        this.conditions.push((text, local));
+                        this.conditions.len() - 1
+                    })
+            };
+            let condition = match keyword {
+                "if" | "elif" => Some(intern(rest.to_string())),
+                "ifdef" | "elifdef" => Some(intern(format!("defined {rest}"))),
+                "ifndef" | "elifndef" => Some(intern(format!("!defined {rest}"))),
+                _ => None,
+            };
+
+            // `outer` is the chain around the group, which the directive
+            // line itself belongs to; `next` applies from the following line
+            let (outer, next) = match (keyword, condition) {
+                ("if" | "ifdef" | "ifndef", Some(condition)) => {
+                    groups.push(Group {
+                        outer: current,
+                        taken: vec![condition],
+                    });
+                    (current, this.chain(current, &[], Some(condition)))
+                }
+                ("elif" | "elifdef" | "elifndef", Some(condition)) => {
+                    let Some(group) = groups.last_mut() else {
+                        continue;
+                    };
+                    let chain = this.chain(group.outer, &group.taken, Some(condition));
+                    group.taken.push(condition);
+                    (group.outer, chain)
+                }
+                ("else", _) => {
+                    let Some(group) = groups.last() else {
+                        continue;
+                    };
+                    (group.outer, this.chain(group.outer, &group.taken, None))
+                }
+                ("endif", _) => match groups.pop() {
+                    Some(group) => (group.outer, group.outer),
+                    None => continue,
+                },
+                _ => continue,
+            };
+
+            this.spans.push((first, outer));
+            this.spans.push((index, next));
+            current = next;
+        }
+
+        this
+    }
+
+    /// The in-file macro state on `chain` after `changes`. A change made on
+    /// a chain that `chain` extends has certainly happened; any other may
+    /// or may not have.
+    fn local_defines(&self, changes: &[MacroChange], chain: usize) -> LocalDefines {
+        let terms = &self.chains[chain];
+        let mut local: BTreeMap<&str, Local> = BTreeMap::new();
+        for change in changes {
+            let state = if terms.starts_with(&self.chains[change.chain]) {
+                match &change.value {
+                    Some(value) => Local::Defined(value.clone()),
+                    None => Local::Undefined,
+                }
+            } else {
+                Local::Unknown
+            };
+            local.insert(&change.name, state);
+        }
+        local
+            .into_iter()
+            .map(|(name, state)| (name.to_string(), state))
+            .collect()
+    }
+
+    /// Add the chain for a branch of a group around `outer`: the earlier
+    /// branches' conditions are false and `condition`, if any, is true.
+    fn chain(&mut self, outer: usize, earlier: &[usize], condition: Option<usize>) -> usize {
+        let mut terms = self.chains[outer].clone();
+        terms.extend(earlier.iter().map(|&c| (c, false)));
+        terms.extend(condition.map(|c| (c, true)));
+        self.chains.push(terms);
+        self.chains.len() - 1
+    }
+
+    /// Terms that must hold for 0-indexed `line` to be compiled.
+    fn terms_at(&self, line: usize) -> &[Term] {
+        let span = self.spans.partition_point(|&(first, _)| first <= line);
+        &self.chains[self.spans[span - 1].1]
+    }
+}
+
+/// The macro change made by a `#define` or `#undef` directive on `chain`.
+fn macro_change(keyword: &str, rest: &str, chain: usize) -> Option<MacroChange> {
+    if keyword != "define" && keyword != "undef" {
+        return None;
+    }
+    let name_len = rest
+        .find(|c: char| !c.is_ascii_alphanumeric() && c != '_')
+        .unwrap_or(rest.len());
+    let (name, body) = rest.split_at(name_len);
+    if name.is_empty() {
+        return None;
+    }
+    let value = (keyword == "define").then(|| {
+        // A function-like macro has no value of its own in `#if`
+        if body.starts_with('(') {
+            String::new()
+        } else {
+            body.trim().to_string()
+        }
+    });
+    Some(MacroChange {
+        name: name.to_string(),
+        value,
+        chain,
+    })
+}
+
+/// Remove comments from one line of C, tracking block comments that span
+/// lines. String and character literals are kept as they are.
+fn strip_comments(line: &str, in_comment: &mut bool) -> String {
+    let mut code = String::with_capacity(line.len());
+    let mut chars = line.chars().peekable();
+    let mut quote: Option<char> = None;
+
+    while let Some(c) = chars.next() {
+        if *in_comment {
+            if c == '*' && chars.peek() == Some(&'/') {
+                chars.next();
+                *in_comment = false;
+                code.push(' ');
+            }
+            continue;
+        }
+        match quote {
+            Some(q) => {
+                code.push(c);
+                if c == '\\' {
+                    code.extend(chars.next());
+                } else if c == q {
+                    quote = None;
+                }
+            }
+            None => match (c, chars.peek()) {
+                ('/', Some('/')) => break,
+                ('/', Some('*')) => {
+                    chars.next();
+                    *in_comment = true;
+                }
+                ('"' | '\'', _) => {
+                    quote = Some(c);
+                    code.push(c);
+                }
+                _ => code.push(c),
+            },
+        }
+    }
+
+    code
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn variant_set(variants: &[&str]) -> VariantSet {
+        VariantSet::new(variants.iter().map(|v| v.parse().unwrap()).collect())
+    }
+
+    fn active(source: &str, line: usize, variants: &[&str]) -> Vec<String> {
+        tagged(&variant_set(variants), SupportLang::C, source, line)
+    }
+
+    fn tagged(set: &VariantSet, lang: SupportLang, source: &str, line: usize) -> Vec<String> {
+        let mut hits = vec![(
+            "REQ-1".to_string(),
+            crate::scan::Entry {
+                file: "a.c".into(),
+                line,
+                comment_text: String::new(),
+                above: None,
+                below: None,
+                inline: None,
+                scope: Vec::new(),
+                variants: None,
+                blame: None,
+            },
+        )];
+        set.tag(lang, source, &mut hits);
+        hits.pop().unwrap().1.variants.unwrap()
+    }
+
+    const SOURCE: &str = "\
+// REQ-1 everywhere
+#ifdef USE_DMA
+/* REQ-2 dma */
+#  if UART_COUNT > 1 /* two or more
+                       uarts */
+// REQ-3 dma, several uarts
+#  endif
+#elif defined(USE_IRQ) \\
+    && !defined(LOW_POWER)
+// REQ-4 irq
+#else
+// REQ-5 polling
+#endif
+// REQ-6 everywhere
+";
+
+    #[test]
+    fn tags_hits_with_the_variants_compiling_them() {
+        let variants = [
+            "dma1=USE_DMA",
+            "dma2=USE_DMA,UART_COUNT=2",
+            "irq=USE_IRQ",
+            "poll=",
+        ];
+
+        assert_eq!(active(SOURCE, 1, &variants).len(), 4);
+        assert_eq!(active(SOURCE, 3, &variants), ["dma1", "dma2"]);
+        assert_eq!(active(SOURCE, 6, &variants), ["dma2"]);
+        assert_eq!(active(SOURCE, 10, &variants), ["irq"]);
+        assert_eq!(active(SOURCE, 12, &variants), ["poll"]);
+        assert_eq!(active(SOURCE, 14, &variants).len(), 4);
+    }
+
+    #[test]
+    fn undecidable_conditions_keep_both_branches() {
+        let source = "#if __has_include(<dma.h>)\n// REQ-1\n#else\n// REQ-1\n#endif\n";
+        assert_eq!(active(source, 2, &["a="]), ["a"]);
+        assert_eq!(active(source, 4, &["a="]), ["a"]);
+    }
+
+    #[test]
+    fn defines_in_the_file_apply_from_where_they_appear() {
+        let source = "#define FEATURE\n#ifdef FEATURE\n// REQ-1\n#endif\n";
+        assert_eq!(active(source, 3, &["a=", "b=OTHER"]), ["a", "b"]);
+
+        let source = "#undef USE_DMA\n#ifdef USE_DMA\n// REQ-1\n#endif\n";
+        assert!(active(source, 3, &["dma=USE_DMA"]).is_empty());
+
+        // Under an include guard the define is certain wherever the guard holds
+        let source = "\
+#ifndef CONFIG_H
+#define CONFIG_H
+#define UART_COUNT 2
+#if UART_COUNT > 1
+// REQ-1
+#endif
+#endif
+";
+        assert_eq!(active(source, 5, &["a=", "b=UART_COUNT=1"]), ["a", "b"]);
+    }
+
+    #[test]
+    fn conditional_defines_leave_the_macro_unknown() {
+        let source =
+            "#ifdef BOARD_A\n#define FAST 1\n#endif\n#if FAST\n// REQ-1\n#else\n// REQ-2\n#endif\n";
+        let variants = ["a=BOARD_A", "b="];
+        assert_eq!(active(source, 5, &variants), ["a", "b"]);
+        assert_eq!(active(source, 7, &variants), ["a", "b"]);
+    }
+
+    #[test]
+    fn cplusplus_is_defined_only_for_cpp() {
+        let set = variant_set(&["a="]);
+        let source = "#ifdef __cplusplus\n// REQ-1\n#endif\n";
+        assert_eq!(tagged(&set, SupportLang::Cpp, source, 2), ["a"]);
+        assert!(tagged(&set, SupportLang::C, source, 2).is_empty());
+    }
+
+    #[test]
+    fn cached_conditions_respect_each_files_defines() {
+        let set = variant_set(&["a=", "b=LEVEL=0"]);
+        let defining = "#define LEVEL 2\n#if LEVEL > 1\n// REQ-1\n#endif\n";
+        let plain = "#if LEVEL > 1\n// REQ-1\n#endif\n";
+        assert_eq!(tagged(&set, SupportLang::C, defining, 3), ["a", "b"]);
+        assert!(tagged(&set, SupportLang::C, plain, 2).is_empty());
+        assert_eq!(tagged(&set, SupportLang::C, defining, 3), ["a", "b"]);
+    }
+
+    #[test]
+    fn parses_variant_specs_and_compile_commands() {
+        let variant: Variant = "board-a=USE_DMA,UART_COUNT=2".parse().unwrap();
+        assert_eq!(variant.name, "board-a");
+        assert_eq!(variant.defines["USE_DMA"], "1");
+        assert_eq!(variant.defines["UART_COUNT"], "2");
+        assert!("=X".parse::<Variant>().is_err());
+
+        let dir = tempfile::TempDir::new().unwrap();
+        let path = dir.path().join("compile_commands.json");
+        fs::write(
+            &path,
+            r#"[
+                {"directory": "/b", "file": "a.c",
+                 "command": "cc -DBOARD_A -D UART_COUNT=2 '-DGREETING=hi there' -DONLY_A -c a.c"},
+                {"directory": "/b", "file": "b.c",
+                 "arguments": ["cc", "-DBOARD_A", "-DUART_COUNT=2", "-DGREETING=hi there", "-c", "b.c"]}
+            ]"#,
+        )
+        .unwrap();
+        let variant = Variant::new("a").with_compile_commands(&path).unwrap();
+        assert_eq!(
+            variant.defines.keys().collect::<Vec<_>>(),
+            ["BOARD_A", "GREETING", "UART_COUNT"]
+        );
+    }
+}
@@ -0,0 +1,410 @@
+//! Per-phase timing and throughput counters for `--stats`.
+//!
+//! Counters are process-wide so that every stage, from the walk to the
+//! output, can report into them without threading a collector through the
+//! library API. Collection is off unless [`enable`] is called. Phase timers
+//! also record [`crate::trace`] spans; while both are off, a probe is two
+//! relaxed atomic loads.
+//!
+//! Phase times are summed over all threads, so for the phases that run on
+//! the worker pool (read to scope) they are CPU time rather than wall time
+//! and can add up to more than the run's wall time.
+
+use crate::trace;
+use clap::ValueEnum;
+use serde::Serialize;
+use std::collections::BTreeMap;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// How `--stats` prints the statistics.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum)]
+pub enum StatsFormat {
+    Text,
+    Json,
+}
+
+/// A stage of the pipeline.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize)]
+#[serde(rename_all = "kebab-case")]
+pub enum Phase {
+    /// Directory walk, including `.gitattributes` and glob filtering
+    Walk,
+    /// Reading source files
+    Read,
+    /// The raw-text id check that skips files before parsing
+    Prefilter,
+    /// Building the syntax tree
+    Parse,
+    /// Walking the tree and matching ids in comments and markers, excluding
+    /// the scope and context extraction for each hit
+    Match,
+    /// Block context (above/below/inline code) for each hit
+    Context,
+    /// Scope hierarchy for each hit
+    Scope,
+    /// `git blame`
+    Blame,
+    /// Formatting and writing the report
+    Output,
+}
+
+/// Every phase, in discriminant order.
+const PHASES: [Phase; 9] = [
+    Phase::Walk,
+    Phase::Read,
+    Phase::Prefilter,
+    Phase::Parse,
+    Phase::Match,
+    Phase::Context,
+    Phase::Scope,
+    Phase::Blame,
+    Phase::Output,
+];
+
+/// Why a file was not scanned.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize)]
+#[serde(rename_all = "kebab-case")]
+pub enum Skip {
+    /// Dropped by an `--include`/`--exclude` glob
+    Glob,
+    /// Marked `linguist-vendored` in `.gitattributes`
+    Vendored,
+    /// Marked `linguist-generated` in `.gitattributes`
+    Generated,
+    /// Dropped by the globs of a nested `tracy.toml`
+    NestedFilter,
+    /// Not in a language tracy can parse
+    UnsupportedLanguage,
+    /// Contains no accepted id, so it was never parsed
+    NoCandidateId,
+}
+
+/// Every skip reason, in discriminant order.
+const SKIPS: [Skip; 6] = [
+    Skip::Glob,
+    Skip::Vendored,
+    Skip::Generated,
+    Skip::NestedFilter,
+    Skip::UnsupportedLanguage,
+    Skip::NoCandidateId,
+];
+
+#[derive(Debug, Default)]
+struct Language {
+    files: u64,
+    bytes: u64,
+    nanos: u64,
+}
+
+struct Counters {
+    phase_nanos: [AtomicU64; PHASES.len()],
+    skipped: [AtomicU64; SKIPS.len()],
+    cache_hits: AtomicU64,
+    cache_misses: AtomicU64,
+    /// Updated once per scanned file
+    languages: Mutex<BTreeMap<String, Language>>,
+}
+
+static COUNTERS: Counters = Counters {
+    phase_nanos: [const { AtomicU64::new(0) }; PHASES.len()],
+    skipped: [const { AtomicU64::new(0) }; SKIPS.len()],
+    cache_hits: AtomicU64::new(0),
+    cache_misses: AtomicU64::new(0),
+    languages: Mutex::new(BTreeMap::new()),
+};
+
+/// Start collecting.
+pub fn enable() {
+    ENABLED.store(true, Ordering::Relaxed);
+}
+
+/// Whether collection is on.
+#[inline]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// Times a phase until dropped.
+#[must_use = "the phase is timed until the timer is dropped"]
+pub struct Timer(Option<(Phase, Instant)>);
+
+impl Drop for Timer {
+    fn drop(&mut self) {
+        if let Some((phase, start)) = self.0 {
+            let elapsed = start.elapsed();
+            if enabled() {
+                add_time(phase, elapsed);
+            }
+            trace::record(phase_name(phase), start, elapsed);
+        }
+    }
+}
+
+/// Time `phase` from now until the returned timer is dropped.
+#[inline]
+pub fn time(phase: Phase) -> Timer {
+    Timer((enabled() || trace::enabled()).then(|| (phase, Instant::now())))
+}
+
+/// The start of a per-file measurement, if collecting.
+#[inline]
+pub fn start() -> Option<Instant> {
+    enabled().then(Instant::now)
+}
+
+fn add_time(phase: Phase, elapsed: Duration) {
+    COUNTERS.phase_nanos[phase as usize].fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
+}
+
+/// Count a skipped file.
+#[inline]
+pub fn skip(reason: Skip) {
+    if enabled() {
+        COUNTERS.skipped[reason as usize].fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Count a result cache lookup.
+#[inline]
+pub fn cache_lookup(hit: bool) {
+    if enabled() {
+        let counter = if hit {
+            &COUNTERS.cache_hits
+        } else {
+            &COUNTERS.cache_misses
+        };
+        counter.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Count a scanned file of `bytes` in `language`, which took since `start`.
+pub fn file_done(start: Option<Instant>, language: &dyn std::fmt::Display, bytes: usize) {
+    let Some(start) = start else {
+        return;
+    };
+    let nanos = start.elapsed().as_nanos() as u64;
+    let mut languages = COUNTERS.languages.lock().unwrap_or_else(|e| e.into_inner());
+    let entry = languages.entry(language.to_string()).or_default();
+    entry.files += 1;
+    entry.bytes += bytes as u64;
+    entry.nanos += nanos;
+}
+
+/// Collected statistics, as reported by `--stats`.
+#[derive(Debug, Serialize)]
+pub struct Stats {
+    pub wall_ms: f64,
+    pub phases: Vec<PhaseStats>,
+    pub languages: Vec<LanguageStats>,
+    pub skipped: BTreeMap<String, u64>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub cache: Option<CacheStats>,
+}
+
+#[derive(Debug, Serialize)]
+pub struct PhaseStats {
+    pub phase: Phase,
+    pub ms: f64,
+}
+
+/// Throughput for one language, over the time its files spent from the
+/// prefilter to the end of the scan (reads excluded).
+#[derive(Debug, Serialize)]
+pub struct LanguageStats {
+    pub language: String,
+    pub files: u64,
+    pub bytes: u64,
+    pub files_per_sec: f64,
+    pub mib_per_sec: f64,
+}
+
+#[derive(Debug, Serialize)]
+pub struct CacheStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub hit_rate: f64,
+}
+
+/// The statistics collected so far, for a run that took `wall`.
+pub fn snapshot(wall: Duration) -> Stats {
+    let mut nanos: Vec<u64> = COUNTERS
+        .phase_nanos
+        .iter()
+        .map(|n| n.load(Ordering::Relaxed))
+        .collect();
+    // Scope and context are timed inside the match walk; report them apart
+    let nested = nanos[Phase::Scope as usize] + nanos[Phase::Context as usize];
+    nanos[Phase::Match as usize] = nanos[Phase::Match as usize].saturating_sub(nested);
+
+    let phases = PHASES
+        .iter()
+        .zip(nanos)
+        .map(|(phase, nanos)| PhaseStats {
+            phase: *phase,
+            ms: nanos as f64 / 1e6,
+        })
+        .collect();
+
+    let languages = COUNTERS
+        .languages
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .iter()
+        .map(|(language, counts)| {
+            let secs = (counts.nanos as f64 / 1e9).max(f64::MIN_POSITIVE);
+            LanguageStats {
+                language: language.clone(),
+                files: counts.files,
+                bytes: counts.bytes,
+                files_per_sec: counts.files as f64 / secs,
+                mib_per_sec: counts.bytes as f64 / (1 << 20) as f64 / secs,
+            }
+        })
+        .collect();
+
+    let skipped = SKIPS
+        .iter()
+        .zip(&COUNTERS.skipped)
+        .map(|(skip, count)| (skip_name(*skip).to_string(), count.load(Ordering::Relaxed)))
+        .filter(|(_, count)| *count > 0)
+        .collect();
+
+    let hits = COUNTERS.cache_hits.load(Ordering::Relaxed);
+    let misses = COUNTERS.cache_misses.load(Ordering::Relaxed);
+    let cache = (hits + misses > 0).then(|| CacheStats {
+        hits,
+        misses,
+        hit_rate: hits as f64 / (hits + misses) as f64,
+    });
+
+    Stats {
+        wall_ms: wall.as_secs_f64() * 1e3,
+        phases,
+        languages,
+        skipped,
+        cache,
+    }
+}
+
+fn phase_name(phase: Phase) -> &'static str {
+    match phase {
+        Phase::Walk => "walk",
+        Phase::Read => "read",
+        Phase::Prefilter => "prefilter",
+        Phase::Parse => "parse",
+        Phase::Match => "match",
+        Phase::Context => "context",
+        Phase::Scope => "scope",
+        Phase::Blame => "blame",
+        Phase::Output => "output",
+    }
+}
+
+fn skip_name(skip: Skip) -> &'static str {
+    match skip {
+        Skip::Glob => "glob",
+        Skip::Vendored => "vendored",
+        Skip::Generated => "generated",
+        Skip::NestedFilter => "nested-filter",
+        Skip::UnsupportedLanguage => "unsupported-language",
+        Skip::NoCandidateId => "no-candidate-id",
+    }
+}
+
+/// Render `stats` as a plain-text table.
+pub fn format_text(stats: &Stats) -> String {
+    let mut out = format!(
+        "wall time {:.1} ms\n\nphase         time (ms)\n",
+        stats.wall_ms
+    );
+    for phase in &stats.phases {
+        out.push_str(&format!(
+            "{:<12} {:>10.1}\n",
+            phase_name(phase.phase),
+            phase.ms
+        ));
+    }
+
+    if !stats.languages.is_empty() {
+        out.push_str("\nlanguage       files      bytes    files/s    MiB/s\n");
+        for lang in &stats.languages {
+            out.push_str(&format!(
+                "{:<12} {:>7} {:>10} {:>10.0} {:>8.1}\n",
+                lang.language, lang.files, lang.bytes, lang.files_per_sec, lang.mib_per_sec
+            ));
+        }
+    }
+
+    if !stats.skipped.is_empty() {
+        out.push_str("\nskipped\n");
+        for (reason, count) in &stats.skipped {
+            out.push_str(&format!("{reason:<21} {count:>7}\n"));
+        }
+    }
+
+    if let Some(cache) = &stats.cache {
+        out.push_str(&format!(
+            "\ncache: {} hits, {} misses ({:.1}% hit rate)\n",
+            cache.hits,
+            cache.misses,
+            cache.hit_rate * 100.0
+        ));
+    }
+    out
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn text_report_lists_every_phase_and_what_was_seen() {
+        let stats = Stats {
+            wall_ms: 12.5,
+            phases: PHASES
+                .iter()
+                .map(|phase| PhaseStats {
+                    phase: *phase,
+                    ms: 1.0,
+                })
+                .collect(),
+            languages: vec![LanguageStats {
+                language: "Rust".to_string(),
+                files: 3,
+                bytes: 300,
+                files_per_sec: 1000.0,
+                mib_per_sec: 0.1,
+            }],
+            skipped: BTreeMap::from([("no-candidate-id".to_string(), 2)]),
+            cache: None,
+        };
+
+        let text = format_text(&stats);
+        for phase in PHASES {
+            assert!(text.contains(phase_name(phase)));
+        }
+        assert!(text.contains("Rust"));
+        assert!(text.contains("no-candidate-id"));
+        assert!(!text.contains("cache"));
+
+        let json = serde_json::to_value(&stats).unwrap();
+        assert_eq!(json["phases"][0]["phase"], "walk");
+        assert_eq!(json["skipped"]["no-candidate-id"], 2);
+    }
+
+    #[test]
+    fn disabled_probes_record_nothing() {
+        // Tests share the process-wide counters, so only check what a
+        // disabled probe hands back
+        if !enabled() {
+            assert!(start().is_none());
+            if !trace::enabled() {
+                assert!(time(Phase::Parse).0.is_none());
+            }
+        }
+    }
+}
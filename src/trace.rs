@@ -0,0 +1,304 @@
+//! Chrome trace-event export for `--trace-out`.
+//!
+//! Spans are recorded per thread: the per-file work (read, prefilter, parse,
+//! match, context, scope), `git blame`, the walk, the output and the lifetime
+//! of each pool worker. The file is loaded by Perfetto or `chrome://tracing`,
+//! where stalls, stragglers and idle workers show up as gaps and long bars
+//! on the worker tracks.
+//!
+//! The phase spans come from the [`crate::stats`] timers, so the two share
+//! their probe points. Recording is off unless [`enable`] is called; while
+//! off, a probe is one relaxed atomic load. While on, each thread appends to
+//! its own buffer, so workers do not contend on a shared lock.
+
+use serde::Serialize;
+use std::borrow::Cow;
+use std::cell::OnceCell;
+use std::fs::File;
+use std::io::{self, BufWriter, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::thread;
+use std::time::{Duration, Instant};
+use thiserror::Error;
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// Timestamps are relative to this instant, set by [`enable`].
+static EPOCH: OnceLock<Instant> = OnceLock::new();
+
+/// Every thread that has recorded a span, in order of its first span.
+static THREADS: Mutex<Vec<Arc<ThreadEvents>>> = Mutex::new(Vec::new());
+
+static NEXT_TID: AtomicU64 = AtomicU64::new(1);
+
+thread_local! {
+    static LOCAL: OnceCell<Arc<ThreadEvents>> = const { OnceCell::new() };
+}
+
+#[derive(Debug, Error)]
+pub enum TraceError {
+    #[error("failed to write trace file {path}: {source}")]
+    Write { path: PathBuf, source: io::Error },
+}
+
+/// Start recording.
+pub fn enable() {
+    EPOCH.get_or_init(Instant::now);
+    ENABLED.store(true, Ordering::Relaxed);
+}
+
+/// Whether recording is on.
+#[inline]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// A finished span.
+struct Event {
+    name: Cow<'static, str>,
+    cat: &'static str,
+    start: Instant,
+    dur: Duration,
+}
+
+/// The spans of one thread. Only that thread appends, so the lock is
+/// uncontended until the trace is written.
+struct ThreadEvents {
+    tid: u64,
+    name: String,
+    events: Mutex<Vec<Event>>,
+}
+
+fn push(event: Event) {
+    // Fails only while the thread's locals are being destroyed
+    let _ = LOCAL.try_with(|local| {
+        let events = local.get_or_init(|| {
+            let tid = NEXT_TID.fetch_add(1, Ordering::Relaxed);
+            let name = match thread::current().name() {
+                Some(name) => name.to_string(),
+                None => format!("worker {tid}"),
+            };
+            let events = Arc::new(ThreadEvents {
+                tid,
+                name,
+                events: Mutex::new(Vec::new()),
+            });
+            lock(&THREADS).push(Arc::clone(&events));
+            events
+        });
+        lock(&events.events).push(event);
+    });
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> std::sync::MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+/// Record a finished phase span that started at `start`.
+pub(crate) fn record(name: &'static str, start: Instant, dur: Duration) {
+    if enabled() {
+        push(Event {
+            name: Cow::Borrowed(name),
+            cat: "phase",
+            start,
+            dur,
+        });
+    }
+}
+
+/// A span recorded when dropped.
+#[must_use = "the span ends when it is dropped"]
+pub struct Span(Option<(Cow<'static, str>, &'static str, Instant)>);
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        if let Some((name, cat, start)) = self.0.take() {
+            push(Event {
+                name,
+                cat,
+                start,
+                dur: start.elapsed(),
+            });
+        }
+    }
+}
+
+/// A span named `name` from now until the returned guard is dropped.
+#[inline]
+pub fn span(name: &'static str) -> Span {
+    Span(enabled().then(|| (Cow::Borrowed(name), "pipeline", Instant::now())))
+}
+
+/// A span named after `file`, covering all the work on one file.
+#[inline]
+pub fn file(file: &Path) -> Span {
+    Span(enabled().then(|| {
+        (
+            Cow::Owned(file.to_string_lossy().into_owned()),
+            "file",
+            Instant::now(),
+        )
+    }))
+}
+
+/// One record of the trace-event format; `ts` and `dur` are microseconds.
+#[derive(Serialize)]
+struct TraceEvent<'a> {
+    name: &'a str,
+    cat: &'a str,
+    ph: &'static str,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    ts: Option<f64>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    dur: Option<f64>,
+    pid: u32,
+    tid: u64,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    args: Option<MetadataArgs<'a>>,
+}
+
+#[derive(Serialize)]
+struct MetadataArgs<'a> {
+    name: &'a str,
+}
+
+#[derive(Serialize)]
+#[serde(rename_all = "camelCase")]
+struct Trace<'a> {
+    trace_events: Vec<TraceEvent<'a>>,
+    display_time_unit: &'static str,
+}
+
+/// Write every span recorded so far to `path` as a Chrome trace.
+pub fn write(path: &Path) -> Result<(), TraceError> {
+    let epoch = EPOCH.get().copied().unwrap_or_else(Instant::now);
+    let threads = lock(&THREADS).clone();
+    write_threads(path, &threads, epoch)
+}
+
+/// Write the spans of `threads` to `path`, timed from `epoch`.
+fn write_threads(
+    path: &Path,
+    threads: &[Arc<ThreadEvents>],
+    epoch: Instant,
+) -> Result<(), TraceError> {
+    let write_error = |source| TraceError::Write {
+        path: path.to_path_buf(),
+        source,
+    };
+    let pid = std::process::id();
+
+    let events: Vec<_> = threads.iter().map(|thread| lock(&thread.events)).collect();
+
+    let mut trace_events = vec![TraceEvent {
+        name: "process_name",
+        cat: "__metadata",
+        ph: "M",
+        ts: None,
+        dur: None,
+        pid,
+        tid: 0,
+        args: Some(MetadataArgs { name: "tracy" }),
+    }];
+    for (thread, events) in threads.iter().zip(&events) {
+        trace_events.push(TraceEvent {
+            name: "thread_name",
+            cat: "__metadata",
+            ph: "M",
+            ts: None,
+            dur: None,
+            pid,
+            tid: thread.tid,
+            args: Some(MetadataArgs { name: &thread.name }),
+        });
+        trace_events.extend(events.iter().map(|event| TraceEvent {
+            name: &event.name,
+            cat: event.cat,
+            ph: "X",
+            ts: Some(micros(event.start.saturating_duration_since(epoch))),
+            dur: Some(micros(event.dur)),
+            pid,
+            tid: thread.tid,
+            args: None,
+        }));
+    }
+
+    let trace = Trace {
+        trace_events,
+        display_time_unit: "ms",
+    };
+    let mut out = BufWriter::new(File::create(path).map_err(write_error)?);
+    serde_json::to_writer(&mut out, &trace).map_err(|e| write_error(e.into()))?;
+    out.flush().map_err(write_error)
+}
+
+fn micros(duration: Duration) -> f64 {
+    duration.as_nanos() as f64 / 1e3
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::TempDir;
+
+    // Built by hand: recording through `enable` would switch tracing on for
+    // every other test in the process
+    fn thread(tid: u64, name: &str, events: Vec<Event>) -> Arc<ThreadEvents> {
+        Arc::new(ThreadEvents {
+            tid,
+            name: name.to_string(),
+            events: Mutex::new(events),
+        })
+    }
+
+    #[test]
+    fn spans_are_written_per_thread() {
+        let epoch = Instant::now();
+        let event = |name: &'static str, cat, start_us| Event {
+            name: Cow::Borrowed(name),
+            cat,
+            start: epoch + Duration::from_micros(start_us),
+            dur: Duration::from_micros(5),
+        };
+        let threads = [
+            thread(
+                1,
+                "main",
+                vec![event("src/a.rs", "file", 10), event("parse", "phase", 12)],
+            ),
+            thread(2, "worker 2", vec![event("worker", "pipeline", 0)]),
+        ];
+
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join("trace.json");
+        write_threads(&path, &threads, epoch).unwrap();
+
+        let trace: serde_json::Value =
+            serde_json::from_slice(&std::fs::read(&path).unwrap()).unwrap();
+        let events = trace["traceEvents"].as_array().unwrap();
+        let span = |name: &str| {
+            events
+                .iter()
+                .find(|e| e["ph"] == "X" && e["name"] == name)
+                .unwrap()
+        };
+        assert_eq!(span("src/a.rs")["tid"], 1);
+        assert_eq!(span("src/a.rs")["ts"], 10.0);
+        assert_eq!(span("src/a.rs")["dur"], 5.0);
+        assert_eq!(span("parse")["tid"], 1);
+        assert_eq!(span("parse")["cat"], "phase");
+        assert_eq!(span("worker")["tid"], 2);
+        assert!(
+            events
+                .iter()
+                .any(|e| e["ph"] == "M" && e["tid"] == 2 && e["args"]["name"] == "worker 2")
+        );
+        assert!(
+            events
+                .iter()
+                .any(|e| e["ph"] == "M" && e["args"]["name"] == "tracy")
+        );
+    }
+}
@@ -250,6 +250,83 @@ slug = ["REQ"]
     assert!(value.get("REQ-1").is_none());
 }
 
+#[test]
+fn nested_configs_are_opt_in_and_yield_to_flags() {
+    let repo = init_repo();
+    write_file(repo.path(), "tracy.toml", "[scan]\nslug = [\"REQ\"]\n");
+    write_file(
+        repo.path(),
+        "safety/tracy.toml",
+        "[scan]\nslug = [\"HAZ\"]\nid = [\"HAZ-1\"]\n",
+    );
+    write_file(repo.path(), "src/lib.rs", "// REQ-1\n");
+    write_file(repo.path(), "safety/a.rs", "// HAZ-1 HAZ-2 REQ-2\n");
+
+    let keys = |args: &[&str]| -> Vec<String> {
+        let out = run_tracy(repo.path(), args);
+        assert!(
+            out.status.success(),
+            "stderr: {}",
+            String::from_utf8_lossy(&out.stderr)
+        );
+        let value: serde_json::Value = serde_json::from_slice(&out.stdout).unwrap();
+        let mut keys: Vec<String> = value.as_object().unwrap().keys().cloned().collect();
+        keys.sort();
+        keys
+    };
+
+    assert_eq!(keys(&[]), ["REQ-1", "REQ-2"]);
+    assert_eq!(keys(&["--nested-configs"]), ["HAZ-1", "REQ-1"]);
+    assert_eq!(
+        keys(&["--nested-configs", "--id", "HAZ-2", "--id", "REQ-1"]),
+        ["HAZ-2", "REQ-1"]
+    );
+}
+
+#[test]
+fn exists_reports_presence_via_exit_code() {
+    let repo = init_repo();
+    write_file(repo.path(), "src/a.rs", "// REQ-1: one\n");
+    write_file(repo.path(), "src/b.rs", "// REQ-42: answer\n");
+    commit_all(repo.path(), "init");
+    let root = repo.path().to_str().unwrap();
+
+    let out = run_tracy(
+        repo.path(),
+        &[
+            "--no-config",
+            "--root",
+            root,
+            "-s",
+            "REQ",
+            "--exists",
+            "REQ-42",
+        ],
+    );
+    assert!(
+        out.status.success(),
+        "stderr: {}",
+        String::from_utf8_lossy(&out.stderr)
+    );
+    let value: serde_json::Value = serde_json::from_slice(&out.stdout).unwrap();
+    assert_eq!(value.as_object().unwrap().len(), 1);
+    assert_eq!(value["REQ-42"][0]["file"], "src/b.rs");
+
+    let out = run_tracy(
+        repo.path(),
+        &[
+            "--no-config",
+            "--root",
+            root,
+            "-s",
+            "REQ",
+            "--exists",
+            "REQ-7",
+        ],
+    );
+    assert!(!out.status.success());
+}
+
 #[test]
 fn include_blame_populates_commit_ids() {
     let repo = init_repo();
@@ -306,3 +383,305 @@ fn include_blame_populates_commit_ids() {
     assert_eq!(blame_1, first_sha);
     assert_eq!(blame_2, second_sha);
 }
+
+#[test]
+fn stats_json_reports_phases_and_skipped_files() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "src/lib.rs", "// REQ-1: one\nfn one() {}\n");
+    write_file(dir.path(), "src/plain.rs", "fn two() {}\n");
+    write_file(dir.path(), "notes.txt", "REQ-2\n");
+
+    let out = run_tracy(
+        dir.path(),
+        &["--slug", "REQ", "--root", ".", "--quiet", "--stats=json"],
+    );
+    assert!(out.status.success());
+
+    let stats: serde_json::Value = serde_json::from_slice(&out.stderr).unwrap();
+    let phases: Vec<&str> = stats["phases"]
+        .as_array()
+        .unwrap()
+        .iter()
+        .map(|p| p["phase"].as_str().unwrap())
+        .collect();
+    assert_eq!(
+        phases,
+        [
+            "walk",
+            "read",
+            "prefilter",
+            "parse",
+            "match",
+            "context",
+            "scope",
+            "blame",
+            "output"
+        ]
+    );
+    assert_eq!(stats["skipped"]["unsupported-language"], 1);
+    assert_eq!(stats["skipped"]["no-candidate-id"], 1);
+    assert_eq!(stats["languages"][0]["files"], 2);
+}
+
+#[test]
+fn trace_out_writes_per_file_and_per_phase_spans() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "src/plain.rs", "fn two() {}\n");
+    let trace_path = dir.path().join("trace.json");
+
+    let out = run_tracy(
+        dir.path(),
+        &[
+            "--slug",
+            "REQ",
+            "--root",
+            ".",
+            "--quiet",
+            "--trace-out",
+            trace_path.to_str().unwrap(),
+        ],
+    );
+    assert!(out.status.success());
+
+    let trace: serde_json::Value =
+        serde_json::from_slice(&std::fs::read(&trace_path).unwrap()).unwrap();
+    let spans: Vec<(&str, &str)> = trace["traceEvents"]
+        .as_array()
+        .unwrap()
+        .iter()
+        .filter(|e| e["ph"] == "X")
+        .map(|e| (e["cat"].as_str().unwrap(), e["name"].as_str().unwrap()))
+        .collect();
+    assert!(spans.contains(&("file", "src/plain.rs")));
+    assert!(spans.contains(&("phase", "walk")));
+    assert!(spans.contains(&("phase", "read")));
+    assert!(spans.contains(&("phase", "prefilter")));
+    assert!(spans.contains(&("pipeline", "worker")));
+}
+
+#[test]
+fn discover_ranks_prefixes_by_file_spread() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "src/a.rs", "// REQ-1 HAZ-1\nfn a() {}\n");
+    write_file(dir.path(), "src/b.rs", "// REQ-2\nlet s = \"LIN-3\";\n");
+    write_file(dir.path(), "src/c.py", "# REQ-3 HAZ-2 HAZ-3\n");
+    write_file(dir.path(), "vendor/d.rs", "// VEN-1\n");
+
+    let out = run_tracy(
+        dir.path(),
+        &["discover", "--root", ".", "--exclude", "vendor/**"],
+    );
+    assert!(
+        out.status.success(),
+        "stderr: {}",
+        String::from_utf8_lossy(&out.stderr)
+    );
+
+    let slugs: serde_json::Value = serde_json::from_slice(&out.stdout).unwrap();
+    assert_eq!(
+        slugs,
+        serde_json::json!([
+            { "slug": "REQ", "count": 3, "files": 3 },
+            { "slug": "HAZ", "count": 3, "files": 2 },
+        ])
+    );
+
+    let out = run_tracy(dir.path(), &["discover", "--min-files", "3"]);
+    let slugs: serde_json::Value = serde_json::from_slice(&out.stdout).unwrap();
+    assert_eq!(slugs.as_array().unwrap().len(), 1);
+}
+
+#[test]
+fn catalog_refuses_filters_that_drop_matches() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "src/lib.rs", "// REQ-1\n");
+    write_file(dir.path(), "reqs.csv", "id\nREQ-1\nREQ-2\n");
+
+    for filter in [
+        &["--limit", "1"][..],
+        &["--id", "REQ-1"],
+        &["--exists", "REQ-1"],
+    ] {
+        let mut args = vec!["--slug", "REQ", "--catalog", "reqs.csv"];
+        args.extend_from_slice(filter);
+        let out = run_tracy(dir.path(), &args);
+        assert!(!out.status.success());
+        let stderr = String::from_utf8_lossy(&out.stderr);
+        assert!(
+            stderr.contains("cannot be combined with --catalog"),
+            "stderr: {stderr}"
+        );
+    }
+}
+
+#[test]
+fn aggregate_refuses_options_it_would_drop() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "src/lib.rs", "// REQ-1\n");
+    write_file(dir.path(), "reqs.csv", "id\nREQ-1\n");
+
+    for option in [
+        &["--limit", "1"][..],
+        &["--exists", "REQ-1"],
+        &["--catalog", "reqs.csv"],
+        &["--include-git-meta"],
+        &["--nested-configs"],
+    ] {
+        let mut args = vec!["--slug", "REQ", "--aggregate", "by=requirement"];
+        args.extend_from_slice(option);
+        let out = run_tracy(dir.path(), &args);
+        assert!(!out.status.success());
+        let stderr = String::from_utf8_lossy(&out.stderr);
+        assert!(
+            stderr.contains("cannot be combined with --aggregate"),
+            "stderr: {stderr}"
+        );
+    }
+}
+
+#[test]
+fn depfile_targets_the_stamp_or_the_html_data_index() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "src/lib.rs", "fn one() {}\n");
+    write_file(
+        dir.path(),
+        ".gitattributes",
+        "vendor/** linguist-vendored\n",
+    );
+
+    let base = [
+        "--slug",
+        "REQ",
+        "--root",
+        ".",
+        "--quiet",
+        "--depfile",
+        "out.d",
+    ];
+    let depfile = || std::fs::read_to_string(dir.path().join("out.d")).unwrap();
+
+    let mut args = base.to_vec();
+    args.extend(["--format", "html", "--output", "report"]);
+    let out = run_tracy(dir.path(), &args);
+    assert!(out.status.success());
+    let html = depfile();
+    assert!(html.starts_with("report/data/index.js:"), "{html}");
+    assert!(html.contains(".gitattributes"));
+    assert!(html.contains("lib.rs"));
+
+    let mut args = base.to_vec();
+    args.extend(["--output", "out.json", "--stamp", "out.stamp"]);
+    let out = run_tracy(dir.path(), &args);
+    assert!(out.status.success());
+    assert!(depfile().starts_with("out.stamp:"));
+    assert!(dir.path().join("out.stamp").is_file());
+}
+
+#[test]
+fn roots_write_one_report_per_root() {
+    let dir = TempDir::new().unwrap();
+    write_file(
+        dir.path(),
+        "fw/src/main.c",
+        "// REQ-1\nint main(void) { return 0; }\n",
+    );
+    write_file(
+        dir.path(),
+        "app/src/lib.rs",
+        "// REQ_2 APP_1\nfn run() {}\n",
+    );
+    // The root's separator applies, but --slug wins over its slug
+    write_file(
+        dir.path(),
+        "app/tracy.toml",
+        "[scan]\nslug = [\"APP\"]\nid_separator = \"_\"\n",
+    );
+
+    let out = run_tracy(
+        dir.path(),
+        &[
+            "--no-config",
+            "--slug",
+            "REQ",
+            "--root",
+            "fw",
+            "--root",
+            "app",
+            "--output",
+            "reports/trace",
+            "--quiet",
+        ],
+    );
+    assert!(
+        out.status.success(),
+        "stderr: {}",
+        String::from_utf8_lossy(&out.stderr)
+    );
+
+    let report = |name: &str| -> serde_json::Value {
+        let path = dir.path().join("reports/trace").join(name);
+        serde_json::from_slice(&std::fs::read(path).unwrap()).unwrap()
+    };
+    let fw = report("fw.json");
+    assert_eq!(fw["REQ-1"][0]["file"], "src/main.c");
+    let app = report("app.json");
+    assert_eq!(app["REQ_2"][0]["file"], "src/lib.rs");
+    assert!(app.get("APP_1").is_none());
+}
+
+#[test]
+fn root_configs_reject_sections_resolved_once() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "fw/src/main.c", "// REQ-1\n");
+    write_file(dir.path(), "app/src/lib.rs", "// REQ-2\n");
+    write_file(
+        dir.path(),
+        "app/tracy.toml",
+        "[[marker]]\nlanguage = \"rust\"\npattern = \"trace!($ID)\"\n",
+    );
+
+    let out = run_tracy(
+        dir.path(),
+        &[
+            "--no-config",
+            "--slug",
+            "REQ",
+            "--root",
+            "fw",
+            "--root",
+            "app",
+        ],
+    );
+    assert!(!out.status.success());
+    let stderr = String::from_utf8_lossy(&out.stderr);
+    assert!(
+        stderr.contains("root \"app\": [[marker]] is not supported"),
+        "stderr: {stderr}"
+    );
+}
+
+#[test]
+fn archive_cannot_be_one_of_several_roots() {
+    let dir = TempDir::new().unwrap();
+    write_file(dir.path(), "fw/src/main.c", "// REQ-1\n");
+    write_file(dir.path(), "vendor.tar.gz", "");
+
+    let out = run_tracy(
+        dir.path(),
+        &[
+            "--no-config",
+            "--slug",
+            "REQ",
+            "--root",
+            "fw",
+            "--root",
+            "vendor.tar.gz",
+        ],
+    );
+    assert!(!out.status.success());
+    let stderr = String::from_utf8_lossy(&out.stderr);
+    assert!(
+        stderr.contains("vendor.tar.gz is an archive"),
+        "stderr: {stderr}"
+    );
+}
@@ -19,6 +19,7 @@ fn run_scan(
     };
     let scan_args = tracy::scan::ScanArgs {
         slug: vec!["REQ".to_string()],
+        ..Default::default()
     };
 
     let files = tracy::filter::collect_files(&root, &filter_args).unwrap();
@@ -250,3 +251,38 @@ fn skips_unsupported_file_types() {
         "json not supported for comments"
     );
 }
+
+#[test]
+fn scanner_iter_yields_same_hits_as_scan_files() {
+    let root = fixture_root();
+    let files = tracy::filter::collect_files(&root, &Default::default()).unwrap();
+    let scanner = tracy::scan::Scanner::new(&tracy::scan::ScanArgs {
+        slug: vec!["REQ".to_string()],
+        ..Default::default()
+    })
+    .unwrap();
+
+    let mut streamed: Vec<(String, PathBuf, usize)> = scanner
+        .iter(&root, &files)
+        .map(|hit| {
+            let (id, entry) = hit.unwrap();
+            (id, entry.file, entry.line)
+        })
+        .collect();
+    streamed.sort();
+
+    let mut collected: Vec<(String, PathBuf, usize)> = scanner
+        .scan_paths(&root, &files)
+        .unwrap()
+        .into_iter()
+        .flat_map(|(id, entries)| {
+            entries
+                .into_iter()
+                .map(move |e| (id.clone(), e.file, e.line))
+        })
+        .collect();
+    collected.sort();
+
+    assert!(!streamed.is_empty());
+    assert_eq!(streamed, collected);
+}